@@ -62,6 +62,38 @@ int ASIC_set_max_baud(GlobalState * GLOBAL_STATE)
     return 0;
 }
 
+int ASIC_set_baud(GlobalState * GLOBAL_STATE, int baud)
+{
+    switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
+        case BM1397:
+            return BM1397_set_baud(baud);
+        // Only the 1M fast UART setting is known for these chips,
+        // going back to the default baud requires an ASIC reset
+        case BM1366:
+            return baud == 1000000 ? BM1366_set_max_baud() : 0;
+        case BM1368:
+            return baud == 1000000 ? BM1368_set_max_baud() : 0;
+        case BM1370:
+            return baud == 1000000 ? BM1370_set_max_baud() : 0;
+    }
+    return 0;
+}
+
+int ASIC_probe_chips(GlobalState * GLOBAL_STATE)
+{
+    switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
+        case BM1397:
+            return probe_asic_chips(0x1397, 9);
+        case BM1366:
+            return probe_asic_chips(0x1366, 11);
+        case BM1368:
+            return probe_asic_chips(0x1368, 11);
+        case BM1370:
+            return probe_asic_chips(0x1370, 11);
+    }
+    return -1;
+}
+
 void ASIC_send_work(GlobalState * GLOBAL_STATE, void * next_job)
 {
     switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
@@ -117,6 +149,44 @@ bool ASIC_set_frequency(GlobalState * GLOBAL_STATE, float frequency)
     return false;
 }
 
+bool ASIC_set_frequency_step(GlobalState * GLOBAL_STATE, float frequency)
+{
+    switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
+        case BM1397:
+            ESP_LOGE(TAG, "Frequency transition not implemented for BM1397");
+            return false;
+        case BM1366:
+            do_frequency_step(frequency, BM1366_send_hash_frequency);
+            return true;
+        case BM1368:
+            do_frequency_step(frequency, BM1368_send_hash_frequency);
+            return true;
+        case BM1370:
+            do_frequency_step(frequency, BM1370_send_hash_frequency);
+            return true;
+    }
+    return false;
+}
+
+bool ASIC_set_chip_frequency(GlobalState * GLOBAL_STATE, uint8_t asic_nr, float frequency)
+{
+    switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
+        case BM1397:
+            ESP_LOGE(TAG, "Per chip frequency not implemented for BM1397");
+            return false;
+        case BM1366:
+            BM1366_send_chip_hash_frequency(asic_nr, frequency);
+            return true;
+        case BM1368:
+            BM1368_send_chip_hash_frequency(asic_nr, frequency);
+            return true;
+        case BM1370:
+            BM1370_send_chip_hash_frequency(asic_nr, frequency);
+            return true;
+    }
+    return false;
+}
+
 double ASIC_get_asic_job_frequency_ms(GlobalState * GLOBAL_STATE)
 {
     switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
@@ -136,8 +206,12 @@ void ASIC_read_registers(GlobalState * GLOBAL_STATE)
 {
     switch (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id) {
         case BM1397:
+            break;
         case BM1366:
+            BM1366_read_registers();
+            break;
         case BM1368:
+            BM1368_read_registers();
             break;
         case BM1370:
             BM1370_read_registers();
@@ -6,6 +6,7 @@
 #include "utils.h"
 
 #include "esp_log.h"
+#include "event_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "frequency_transition_bmXX.h"
@@ -34,20 +35,52 @@
 
 #define MISC_CONTROL 0x18
 
+static const register_type_t REGISTER_MAP[256] = {
+    [0x4C] = REGISTER_ERROR_COUNT,
+    [0x88] = REGISTER_DOMAIN_0_COUNT,
+    [0x89] = REGISTER_DOMAIN_1_COUNT,
+    [0x8A] = REGISTER_DOMAIN_2_COUNT,
+    [0x8B] = REGISTER_DOMAIN_3_COUNT,
+    [0x8C] = REGISTER_TOTAL_COUNT,
+    [0xB4] = REGISTER_TEMPERATURE
+};
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t nonce;                   // 2-5
+    uint8_t midstate_num;             // 6
+    uint8_t job_id;                   // 7
+    uint16_t version;                 // 8-9
+} bm1368_asic_result_job_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t value;                   // 2-5
+    uint8_t                   : 1;    // 6:0
+    uint8_t asic_nr           : 7;    // 6:1-7
+    uint8_t register_address;         // 7
+    uint16_t                  : 16;   // 8-9
+} bm1368_asic_result_cmd_t;
+
 typedef struct __attribute__((__packed__))
 {
-    uint16_t preamble;
-    uint32_t nonce;
-    uint8_t midstate_num;
-    uint8_t job_id;
-    uint16_t version;
-    uint8_t crc;
+    uint16_t preamble;                // 0-1
+    union {
+        bm1368_asic_result_job_t job; // 2-9
+        bm1368_asic_result_cmd_t cmd; // 2-9
+    };
+    uint8_t crc             : 5;      // 10:0-5
+    uint8_t                 : 2;      // 10:6-7
+    uint8_t is_job_response : 1;      // 10:8
 } bm1368_asic_result_t;
 
 static const char * TAG = "bm1368";
 
 static task_result result;
 
+static uint8_t address_interval;
+static uint16_t chip_count;
+
 static void _send_BM1368(uint8_t header, uint8_t * data, uint8_t data_len, bool debug)
 {
     packet_type_t packet_type = (header & TYPE_JOB) ? JOB_PACKET : CMD_PACKET;
@@ -104,7 +137,7 @@ void BM1368_set_version_mask(uint32_t version_mask)
     _send_BM1368(TYPE_CMD | GROUP_ALL | CMD_WRITE, version_cmd, 6, BM1368_SERIALTX_DEBUG);
 }
 
-void BM1368_send_hash_frequency(float target_freq) 
+static void _send_hash_frequency(uint8_t group, uint8_t chip_address, float target_freq)
 {
     uint8_t fb_divider, refdiv, postdiv1, postdiv2;
     float new_freq;
@@ -113,11 +146,25 @@ void BM1368_send_hash_frequency(float target_freq)
 
     uint8_t vdo_scale = (fb_divider * FREQ_MULT / refdiv >= 2400) ? 0x50 : 0x40;
     uint8_t postdiv = (((postdiv1 - 1) & 0xf) << 4) | ((postdiv2 - 1) & 0xf);
-    uint8_t freqbuf[6] = {0x00, 0x08, vdo_scale, fb_divider, refdiv, postdiv};
+    uint8_t freqbuf[6] = {chip_address, 0x08, vdo_scale, fb_divider, refdiv, postdiv};
 
-    _send_BM1368(TYPE_CMD | GROUP_ALL | CMD_WRITE, freqbuf, sizeof(freqbuf), BM1368_SERIALTX_DEBUG);
+    _send_BM1368(TYPE_CMD | group | CMD_WRITE, freqbuf, sizeof(freqbuf), BM1368_SERIALTX_DEBUG);
 
-    ESP_LOGI(TAG, "Setting Frequency to %g MHz (%g)", target_freq, new_freq);
+    if (group == GROUP_ALL) {
+        ESP_LOGI(TAG, "Setting Frequency to %g MHz (%g)", target_freq, new_freq);
+    } else {
+        ESP_LOGI(TAG, "Setting Frequency of chip %02x to %g MHz (%g)", chip_address, target_freq, new_freq);
+    }
+}
+
+void BM1368_send_hash_frequency(float target_freq)
+{
+    _send_hash_frequency(GROUP_ALL, 0x00, target_freq);
+}
+
+void BM1368_send_chip_hash_frequency(uint8_t asic_nr, float target_freq)
+{
+    _send_hash_frequency(GROUP_SINGLE, asic_nr * address_interval, target_freq);
 }
 
 uint8_t BM1368_init(float frequency, uint16_t asic_count, uint16_t difficulty)
@@ -151,7 +198,8 @@ uint8_t BM1368_init(float frequency, uint16_t asic_count, uint16_t difficulty)
         _send_BM1368(TYPE_CMD | GROUP_ALL | CMD_WRITE, init_cmds[i], 6, false);
     }
 
-    uint8_t address_interval = (uint8_t) (256 / chip_counter);
+    chip_count = chip_counter;
+    address_interval = (uint8_t) (256 / chip_counter);
     for (int i = 0; i < chip_counter; i++) {
         _set_chip_address(i * address_interval);
     }
@@ -227,7 +275,7 @@ void BM1368_send_work(void * pvParameters, bm_job * next_bm_job)
     pthread_mutex_unlock(&GLOBAL_STATE->valid_jobs_lock);
 
     #if BM1368_DEBUG_JOBS
-    ESP_LOGI(TAG, "Send Job: %02X", job.job_id);
+    ESP_LOGI(TAG, "Send Job: %02X, pool job %s", job.job_id, next_bm_job->jobid);
     #endif
 
     _send_BM1368((TYPE_JOB | GROUP_SINGLE | CMD_WRITE), (uint8_t *)&job, sizeof(BM1368_job), BM1368_DEBUG_WORK);
@@ -237,15 +285,31 @@ task_result * BM1368_process_work(void * pvParameters)
 {
     bm1368_asic_result_t asic_result = {0};
 
+    memset(&result, 0, sizeof(task_result));
+
     if (receive_work((uint8_t *)&asic_result, sizeof(asic_result)) == ESP_FAIL) {
         return NULL;
     }
 
-    uint8_t job_id = (asic_result.job_id & 0xf0) >> 1;
-    uint8_t core_id = (uint8_t)((ntohl(asic_result.nonce) >> 25) & 0x7f);
-    uint8_t small_core_id = asic_result.job_id & 0x0f;
-    uint32_t version_bits = (ntohs(asic_result.version) << 13);
-    ESP_LOGI(TAG, "Job ID: %02X, Core: %d/%d, Ver: %08" PRIX32, job_id, core_id, small_core_id, version_bits);
+    if (!asic_result.is_job_response) {
+        result.register_type = REGISTER_MAP[asic_result.cmd.register_address];
+        if (result.register_type == REGISTER_INVALID) {
+            ESP_LOGW(TAG, "Unknown register read: %02x", asic_result.cmd.register_address);
+            return NULL;
+        }
+        // the response holds the chip address without its lowest bit, which an odd address interval
+        // needs, so step over the missing bit before converting it to the chip index
+        result.asic_nr = address_interval == 0 ? 0 : ((asic_result.cmd.asic_nr << 1) + 1) / address_interval;
+        result.value = ntohl(asic_result.cmd.value);
+
+        return &result;
+    }
+
+    uint8_t job_id = (asic_result.job.job_id & 0xf0) >> 1;
+    uint8_t core_id = (uint8_t)((ntohl(asic_result.job.nonce) >> 25) & 0x7f);
+    uint8_t small_core_id = asic_result.job.job_id & 0x0f;
+    uint32_t version_bits = (ntohs(asic_result.job.version) << 13);
+    EVENT_LOG(EVENT_ASIC_NONCE, job_id, core_id, small_core_id, version_bits);
 
     GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
 
@@ -257,8 +321,21 @@ task_result * BM1368_process_work(void * pvParameters)
     uint32_t rolled_version = GLOBAL_STATE->ASIC_TASK_MODULE.active_jobs[job_id]->version | version_bits;
 
     result.job_id = job_id;
-    result.nonce = asic_result.nonce;
+    result.nonce = asic_result.job.nonce;
     result.rolled_version = rolled_version;
 
     return &result;
 }
+
+void BM1368_read_registers(void)
+{
+    int size = sizeof(REGISTER_MAP) / sizeof(REGISTER_MAP[0]);
+    for (int asic_nr = 0; asic_nr < chip_count; asic_nr++) {
+        for (int reg = 0; reg < size; reg++) {
+            if (REGISTER_MAP[reg] != REGISTER_INVALID) {
+                _send_BM1368((TYPE_CMD | GROUP_SINGLE | CMD_READ), (uint8_t[]){asic_nr * address_interval, reg}, 2, false);
+                vTaskDelay(1 / portTICK_PERIOD_MS);
+            }
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #include "utils.h"
 
 #include "esp_log.h"
+#include "event_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "frequency_transition_bmXX.h"
@@ -34,13 +35,14 @@
 
 #define MISC_CONTROL 0x18
 
-static const register_type_t REGISTER_MAP[] = {
+static const register_type_t REGISTER_MAP[256] = {
     [0x4C] = REGISTER_ERROR_COUNT,
     [0x88] = REGISTER_DOMAIN_0_COUNT,
     [0x89] = REGISTER_DOMAIN_1_COUNT,
     [0x8A] = REGISTER_DOMAIN_2_COUNT,
     [0x8B] = REGISTER_DOMAIN_3_COUNT,
-    [0x8C] = REGISTER_TOTAL_COUNT
+    [0x8C] = REGISTER_TOTAL_COUNT,
+    [0xB4] = REGISTER_TEMPERATURE
 };
 
 typedef struct __attribute__((__packed__))
@@ -76,6 +78,9 @@ static const char * TAG = "bm1370";
 
 static task_result result;
 
+static uint8_t address_interval;
+static uint16_t chip_count;
+
 /// @brief
 /// @param ftdi
 /// @param header
@@ -151,7 +156,7 @@ void BM1370_set_version_mask(uint32_t version_mask)
     _send_BM1370(TYPE_CMD | GROUP_ALL | CMD_WRITE, version_cmd, 6, BM1370_SERIALTX_DEBUG);
 }
 
-void BM1370_send_hash_frequency(float target_freq) 
+static void _send_hash_frequency(uint8_t group, uint8_t chip_address, float target_freq)
 {
     uint8_t fb_divider, refdiv, postdiv1, postdiv2;
     float frequency;
@@ -160,11 +165,25 @@ void BM1370_send_hash_frequency(float target_freq)
     
     uint8_t vdo_scale = (fb_divider * FREQ_MULT / refdiv >= 2400) ? 0x50 : 0x40;
     uint8_t postdiv = (((postdiv1 - 1) & 0xf) << 4) | ((postdiv2 - 1) & 0xf);
-    uint8_t freqbuf[6] = {0x00, 0x08, vdo_scale, fb_divider, refdiv, postdiv};
+    uint8_t freqbuf[6] = {chip_address, 0x08, vdo_scale, fb_divider, refdiv, postdiv};
+
+    _send_BM1370(TYPE_CMD | group | CMD_WRITE, freqbuf, 6, BM1370_SERIALTX_DEBUG);
 
-    _send_BM1370(TYPE_CMD | GROUP_ALL | CMD_WRITE, freqbuf, 6, BM1370_SERIALTX_DEBUG);
+    if (group == GROUP_ALL) {
+        ESP_LOGI(TAG, "Setting Frequency to %g MHz (%g)", target_freq, frequency);
+    } else {
+        ESP_LOGI(TAG, "Setting Frequency of chip %02x to %g MHz (%g)", chip_address, target_freq, frequency);
+    }
+}
 
-    ESP_LOGI(TAG, "Setting Frequency to %g MHz (%g)", target_freq, frequency);
+void BM1370_send_hash_frequency(float target_freq)
+{
+    _send_hash_frequency(GROUP_ALL, 0x00, target_freq);
+}
+
+void BM1370_send_chip_hash_frequency(uint8_t asic_nr, float target_freq)
+{
+    _send_hash_frequency(GROUP_SINGLE, asic_nr * address_interval, target_freq);
 }
 
 uint8_t BM1370_init(float frequency, uint16_t asic_count, uint16_t difficulty)
@@ -202,7 +221,8 @@ uint8_t BM1370_init(float frequency, uint16_t asic_count, uint16_t difficulty)
     // _send_simple(init7, 7);
 
     // split the chip address space evenly
-    uint8_t address_interval = (uint8_t) (256 / chip_counter);
+    chip_count = chip_counter;
+    address_interval = (uint8_t) (256 / chip_counter);
     for (uint8_t i = 0; i < chip_counter; i++) {
         _set_chip_address(i * address_interval);
         // unsigned char init8[7] = {0x55, 0xAA, 0x40, 0x05, 0x00, 0x00, 0x1C};
@@ -334,7 +354,7 @@ void BM1370_send_work(void * pvParameters, bm_job * next_bm_job)
 
     //debug sent jobs - this can get crazy if the interval is short
     #if BM1370_DEBUG_JOBS
-    ESP_LOGI(TAG, "Send Job: %02X", job.job_id);
+    ESP_LOGI(TAG, "Send Job: %02X, pool job %s", job.job_id, next_bm_job->jobid);
     #endif
 
     _send_BM1370((TYPE_JOB | GROUP_SINGLE | CMD_WRITE), (uint8_t *)&job, sizeof(BM1370_job), BM1370_DEBUG_WORK);
@@ -356,17 +376,21 @@ task_result * BM1370_process_work(void * pvParameters)
             ESP_LOGW(TAG, "Unknown register read: %02x", asic_result.cmd.register_address);
             return NULL;
         }
-        result.asic_nr = asic_result.cmd.asic_nr;
+        // the response holds the chip address without its lowest bit, which an odd address interval
+        // needs, so step over the missing bit before converting it to the chip index
+        result.asic_nr = address_interval == 0 ? 0 : ((asic_result.cmd.asic_nr << 1) + 1) / address_interval;
         result.value = ntohl(asic_result.cmd.value);
         
         return &result;
     }
 
     uint8_t job_id = (asic_result.job.id & 0xf0) >> 1;
-    uint8_t core_id = (uint8_t)((ntohl(asic_result.job.nonce) >> 25) & 0x7f); // BM1370 has 80 cores, so it should be coded on 7 bits
+    uint8_t core_id = (uint8_t)((ntohl(asic_result.job.nonce) >> 25) & 0x7f); // BM1370 has 128 cores, so it should be coded on 7 bits
     uint8_t small_core_id = asic_result.job.id & 0x0f; // BM1370 has 16 small cores, so it should be coded on 4 bits
     uint32_t version_bits = (ntohs(asic_result.job.version) << 13); // shift the 16 bit value left 13
-    ESP_LOGI(TAG, "Job ID: %02X, Core: %d/%d, Ver: %08" PRIX32, job_id, core_id, small_core_id, version_bits);
+    // the nonce space is split over the chip addresses below the core id, so bits 17-24 of the nonce hold the chip address
+    uint8_t asic_nr = address_interval == 0 ? 0 : (uint8_t)((ntohl(asic_result.job.nonce) >> 17) & 0xff) / address_interval;
+    EVENT_LOG(EVENT_ASIC_CHIP_NONCE, job_id, asic_nr, core_id, small_core_id, version_bits);
 
     GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
 
@@ -380,6 +404,9 @@ task_result * BM1370_process_work(void * pvParameters)
     result.job_id = job_id;
     result.nonce = asic_result.job.nonce;
     result.rolled_version = rolled_version;
+    result.asic_nr = asic_nr;
+    result.core_id = core_id;
+    result.small_core_id = small_core_id;
 
     return &result;
 }
@@ -387,10 +414,12 @@ task_result * BM1370_process_work(void * pvParameters)
 void BM1370_read_registers(void) 
 {
     int size = sizeof(REGISTER_MAP) / sizeof(REGISTER_MAP[0]);
-    for (int reg = 0; reg < size; reg++) {
-        if (REGISTER_MAP[reg] != REGISTER_INVALID) {
-            _send_BM1370((TYPE_CMD | GROUP_SINGLE | CMD_READ), (uint8_t[]){0x00, reg}, 2, false);
-            vTaskDelay(1 / portTICK_PERIOD_MS);
+    for (int asic_nr = 0; asic_nr < chip_count; asic_nr++) {
+        for (int reg = 0; reg < size; reg++) {
+            if (REGISTER_MAP[reg] != REGISTER_INVALID) {
+                _send_BM1370((TYPE_CMD | GROUP_SINGLE | CMD_READ), (uint8_t[]){asic_nr * address_interval, reg}, 2, false);
+                vTaskDelay(1 / portTICK_PERIOD_MS);
+            }
         }
     }
 }
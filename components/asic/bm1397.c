@@ -293,6 +293,18 @@ int BM1397_set_max_baud(void)
     return 3125000;
 }
 
+int BM1397_set_baud(int baud)
+{
+    // round to the nearest 5 bit divider
+    int divider = (25000000 + baud * 4) / (baud * 8) - 1;
+    if (divider < 0) divider = 0;
+    if (divider > 0x1F) divider = 0x1F;
+
+    unsigned char baudrate[9] = {0x00, MISC_CONTROL, 0x00, 0x00, 0b01100000 | divider, 0b00110001}; // baudrate - misc_control
+    _send_BM1397((TYPE_CMD | GROUP_ALL | CMD_WRITE), baudrate, 6, BM1397_SERIALTX_DEBUG);
+    return 25000000 / ((divider + 1) * 8);
+}
+
 static uint8_t id = 0;
 
 void BM1397_send_work(void *pvParameters, bm_job *next_bm_job)
@@ -332,7 +344,7 @@ void BM1397_send_work(void *pvParameters, bm_job *next_bm_job)
     pthread_mutex_unlock(&GLOBAL_STATE->valid_jobs_lock);
 
     #if BM1397_DEBUG_JOBS
-    ESP_LOGI(TAG, "Send Job: %02X", job.job_id);
+    ESP_LOGI(TAG, "Send Job: %02X, pool job %s", job.job_id, next_bm_job->jobid);
     #endif
 
     _send_BM1397((TYPE_JOB | GROUP_SINGLE | CMD_WRITE), (uint8_t *)&job, sizeof(job_packet), BM1397_DEBUG_WORK);
@@ -10,6 +10,9 @@
 
 static const char * TAG = "common";
 
+static uint32_t rx_frames;
+static uint32_t rx_errors;
+
 unsigned char _reverse_bits(unsigned char num)
 {
     unsigned char reversed = 0;
@@ -102,7 +105,10 @@ esp_err_t receive_work(uint8_t * buffer, int buffer_size)
         return ESP_FAIL;
     }
 
+    rx_frames++;
+
     if (received != buffer_size) {
+        rx_errors++;
         ESP_LOGE(TAG, "Invalid response length %i", received);
         ESP_LOG_BUFFER_HEX(TAG, buffer, received);
         SERIAL_clear_buffer();
@@ -111,6 +117,7 @@ esp_err_t receive_work(uint8_t * buffer, int buffer_size)
 
     uint16_t received_preamble = (buffer[0] << 8) | buffer[1];
     if (received_preamble != PREAMBLE) {
+        rx_errors++;
         ESP_LOGE(TAG, "Preamble mismatch: got 0x%04x, expected 0x%04x", received_preamble, PREAMBLE);
         ESP_LOG_BUFFER_HEX(TAG, buffer, received);
         SERIAL_clear_buffer();
@@ -118,6 +125,7 @@ esp_err_t receive_work(uint8_t * buffer, int buffer_size)
     }
 
     if (crc5(buffer + 2, buffer_size - 2) != 0) {
+        rx_errors++;
         ESP_LOGE(TAG, "Checksum failed on response");        
         ESP_LOG_BUFFER_HEX(TAG, buffer, received);
         SERIAL_clear_buffer();
@@ -127,6 +135,39 @@ esp_err_t receive_work(uint8_t * buffer, int buffer_size)
     return ESP_OK;
 }
 
+void get_receive_work_stats(uint32_t * frames, uint32_t * errors)
+{
+    *frames = rx_frames;
+    *errors = rx_errors;
+}
+
+int probe_asic_chips(uint16_t chip_id, int chip_id_response_length)
+{
+    // Read register 0x00 (CHIP_ID) from all chips on the chain
+    uint8_t read_chip_id[7] = {0x55, 0xAA, 0x52, 0x05, 0x00, 0x00, 0x0A};
+    uint8_t buffer[11] = {0};
+
+    SERIAL_clear_buffer();
+    SERIAL_send(read_chip_id, sizeof(read_chip_id), false);
+
+    int chip_counter = 0;
+    while (true) {
+        int received = SERIAL_rx(buffer, chip_id_response_length, 50);
+        if (received <= 0) break;
+
+        if (received != chip_id_response_length
+            || ((buffer[0] << 8) | buffer[1]) != PREAMBLE
+            || ((buffer[2] << 8) | buffer[3]) != chip_id
+            || crc5(buffer + 2, received - 2) != 0) {
+            return -1;
+        }
+
+        chip_counter++;
+    }
+
+    return chip_counter;
+}
+
 void get_difficulty_mask(uint16_t difficulty, uint8_t *job_difficulty_mask)
 {
     // The mask must be a power of 2 so there are no holes
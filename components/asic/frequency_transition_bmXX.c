@@ -6,10 +6,11 @@
 
 #define EPSILON 0.0001f
 #define STEP_SIZE 6.25 // MHz step size
+#define DEFAULT_FREQUENCY 50 // MHz
 
 static const char * TAG = "frequency_transition";
 
-static float current_frequency = 50; // Mhz
+static float current_frequency = DEFAULT_FREQUENCY; // Mhz
 
 void do_frequency_transition(float target_frequency, set_hash_frequency_fn set_frequency_fn)
 {
@@ -49,3 +50,14 @@ void do_frequency_transition(float target_frequency, set_hash_frequency_fn set_f
     
     ESP_LOGI(TAG, "Successfully transitioned to %g MHz", target_frequency);
 }
+
+void do_frequency_step(float frequency, set_hash_frequency_fn set_frequency_fn)
+{
+    current_frequency = frequency;
+    set_frequency_fn(current_frequency);
+}
+
+void reset_frequency_transition(void)
+{
+    current_frequency = DEFAULT_FREQUENCY;
+}
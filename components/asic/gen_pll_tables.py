@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+gen_pll_tables.py
+=================
+Generate the PLL divider tables used by ``pll_get_parameters``.
+
+For every chip driver (``bm*.c``) the feedback divider range is taken from its
+``pll_get_parameters`` call, and the frequency options from
+``main/device_config.h``. The search of ``pll.c`` is run for every 6.25 MHz
+grid point and every frequency option, using the same single precision float
+arithmetic, and the results are written as constant tables to a C header.
+
+Usage
+-----
+    $ python3 gen_pll_tables.py <component dir> <device_config.h> <output header>
+"""
+from __future__ import annotations
+
+import math
+import pathlib
+import re
+import struct
+import sys
+
+FREQ_MULT = 25.0
+GRID_STEP = 6.25
+GRID_MIN = 50.0
+GRID_MAX = 1000.0
+
+
+def f32(value: float) -> float:
+    """Round a double to the nearest single precision float."""
+    return struct.unpack("f", struct.pack("f", value))[0]
+
+
+EPSILON = f32(0.0001)
+FLT_MAX = f32(3.4028234663852886e38)
+
+
+def c_round(value: float) -> int:
+    """round() from C: halfway cases away from zero."""
+    result = math.floor(value)
+    if value - result >= 0.5:
+        result += 1
+    return int(result)
+
+
+def pll_search(target_freq: float, fb_divider_min: int, fb_divider_max: int):
+    """Port of the search in pll.c, float operations are rounded to float."""
+    target_freq = f32(target_freq)
+    best = (0, 0, 0, 0, 0.0)
+    min_diff = FLT_MAX
+    min_vco_freq = FLT_MAX
+    min_postdiv = 0xFFFF
+
+    for refdiv in range(2, 0, -1):
+        for postdiv1 in range(7, 0, -1):
+            for postdiv2 in range(7, 0, -1):
+                divider = refdiv * postdiv1 * postdiv2
+                fb_divider = c_round(target_freq / FREQ_MULT * divider) & 0xFFFF
+                if postdiv1 > postdiv2 and fb_divider_min <= fb_divider <= fb_divider_max:
+                    new_freq = f32(FREQ_MULT * fb_divider / divider)
+                    curr_diff = abs(f32(target_freq - new_freq))
+                    vco_freq = f32(FREQ_MULT * fb_divider / refdiv)
+                    if (curr_diff < min_diff or
+                       (abs(f32(curr_diff - min_diff)) < EPSILON and vco_freq < min_vco_freq) or
+                       (abs(f32(curr_diff - min_diff)) < EPSILON and abs(f32(vco_freq - min_vco_freq)) < EPSILON and postdiv1 * postdiv2 < min_postdiv)):
+                        min_diff = curr_diff
+                        min_vco_freq = vco_freq
+                        min_postdiv = postdiv1 * postdiv2
+                        best = (fb_divider, refdiv, postdiv1, postdiv2, new_freq)
+
+    return best
+
+
+def read_fb_divider_ranges(component_dir: pathlib.Path) -> dict[str, tuple[int, int]]:
+    ranges = {}
+    for source in sorted(component_dir.glob("bm*.c")):
+        match = re.search(r"pll_get_parameters\([^,]+,\s*(\d+),\s*(\d+)", source.read_text())
+        if match:
+            ranges[source.stem.upper()] = (int(match.group(1)), int(match.group(2)))
+    return ranges
+
+
+def read_frequency_options(device_config: pathlib.Path) -> dict[str, list[int]]:
+    options = {}
+    for match in re.finditer(r"(BM\d+)_FREQUENCY_OPTIONS\[\]\s*=\s*\{([^}]*)\}", device_config.read_text()):
+        values = [int(value) for value in match.group(2).replace(" ", "").split(",") if value]
+        options[match.group(1)] = [value for value in values if value != 0]
+    return options
+
+
+def c_float(value: float) -> str:
+    text = f"{value:.9g}"
+    if "." not in text and "e" not in text:
+        text += ".0"
+    return text + "f"
+
+
+def main() -> int:
+    if len(sys.argv) != 4:
+        print(__doc__, file=sys.stderr)
+        return 1
+
+    component_dir = pathlib.Path(sys.argv[1])
+    device_config = pathlib.Path(sys.argv[2])
+    output = pathlib.Path(sys.argv[3])
+
+    ranges = read_fb_divider_ranges(component_dir)
+    options = read_frequency_options(device_config)
+
+    grid = [GRID_MIN + i * GRID_STEP for i in range(int((GRID_MAX - GRID_MIN) / GRID_STEP) + 1)]
+
+    lines = [
+        "// Generated by components/asic/gen_pll_tables.py, do not edit.",
+        "",
+        "#ifndef PLL_TABLES_H_",
+        "#define PLL_TABLES_H_",
+        "",
+    ]
+    tables = []
+    for chip, (fb_divider_min, fb_divider_max) in ranges.items():
+        frequencies = sorted(set(f32(frequency) for frequency in grid + options.get(chip, [])))
+        lines.append(f"static const pll_parameters_t PLL_TABLE_{chip}[] = {{")
+        for frequency in frequencies:
+            fb_divider, refdiv, postdiv1, postdiv2, actual_freq = pll_search(frequency, fb_divider_min, fb_divider_max)
+            lines.append(f"    {{ {c_float(frequency)}, {c_float(actual_freq)}, {fb_divider}, {refdiv}, {postdiv1}, {postdiv2} }},")
+        lines.append("};")
+        lines.append("")
+        tables.append(f"    {{ {fb_divider_min}, {fb_divider_max}, PLL_TABLE_{chip}, sizeof(PLL_TABLE_{chip}) / sizeof(PLL_TABLE_{chip}[0]) }},")
+
+    lines.append("static const pll_table_t PLL_TABLES[] = {")
+    lines.extend(tables)
+    lines.append("};")
+    lines.append("")
+    lines.append("#endif /* PLL_TABLES_H_ */")
+
+    content = "\n".join(lines) + "\n"
+    if not output.exists() or output.read_text() != content:
+        output.write_text(content)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -27,6 +27,8 @@ void BM1366_set_version_mask(uint32_t version_mask);
 int BM1366_set_max_baud(void);
 int BM1366_set_default_baud(void);
 void BM1366_send_hash_frequency(float frequency);
+void BM1366_send_chip_hash_frequency(uint8_t asic_nr, float frequency);
 task_result * BM1366_process_work(void * GLOBAL_STATE);
+void BM1366_read_registers(void);
 
 #endif /* BM1366_H_ */
@@ -27,6 +27,8 @@ void BM1368_set_version_mask(uint32_t version_mask);
 int BM1368_set_max_baud(void);
 int BM1368_set_default_baud(void);
 void BM1368_send_hash_frequency(float frequency);
+void BM1368_send_chip_hash_frequency(uint8_t asic_nr, float frequency);
 task_result * BM1368_process_work(void * GLOBAL_STATE);
+void BM1368_read_registers(void);
 
 #endif /* BM1368_H_ */
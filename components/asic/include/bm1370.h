@@ -27,6 +27,7 @@ void BM1370_set_version_mask(uint32_t version_mask);
 int BM1370_set_max_baud(void);
 int BM1370_set_default_baud(void);
 void BM1370_send_hash_frequency(float frequency);
+void BM1370_send_chip_hash_frequency(uint8_t asic_nr, float frequency);
 task_result * BM1370_process_work(void * GLOBAL_STATE);
 void BM1370_read_registers(void);
 
@@ -14,6 +14,7 @@ typedef enum
     REGISTER_DOMAIN_2_COUNT,
     REGISTER_DOMAIN_3_COUNT,
     REGISTER_TOTAL_COUNT,
+    REGISTER_TEMPERATURE,
 } register_type_t;
 
 typedef struct
@@ -22,9 +23,11 @@ typedef struct
     uint8_t job_id;
     uint32_t nonce;
     uint32_t rolled_version;
+    uint8_t core_id;
+    uint8_t small_core_id;
     // ---- register response
     register_type_t register_type;
-    uint8_t asic_nr;
+    uint8_t asic_nr; // also set on job results when the chip is known
     uint32_t value;
 } task_result;
 
@@ -34,6 +37,8 @@ int _largest_power_of_two(int num);
 
 int count_asic_chips(uint16_t asic_count, uint16_t chip_id, int chip_id_response_length);
 esp_err_t receive_work(uint8_t * buffer, int buffer_size);
+void get_receive_work_stats(uint32_t * frames, uint32_t * errors);
+int probe_asic_chips(uint16_t chip_id, int chip_id_response_length);
 void get_difficulty_mask(uint16_t difficulty, uint8_t *job_difficulty_mask);
 
 #endif /* COMMON_H_ */
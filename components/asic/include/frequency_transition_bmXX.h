@@ -27,4 +27,22 @@ typedef void (*set_hash_frequency_fn)(float frequency);
  */
 void do_frequency_transition(float target_frequency, set_hash_frequency_fn set_frequency_fn);
 
+/**
+ * @brief Set the ASIC frequency in a single step, without ramping
+ * 
+ * The caller is responsible for keeping the steps small enough.
+ * 
+ * @param frequency The frequency in MHz
+ * @param set_frequency_fn Function pointer to the appropriate ASIC's set_hash_frequency function
+ */
+void do_frequency_step(float frequency, set_hash_frequency_fn set_frequency_fn);
+
+/**
+ * @brief Reset the tracked frequency to the power-on default
+ * 
+ * Must be called after an ASIC reset, so the next transition ramps up
+ * from the default frequency again.
+ */
+void reset_frequency_transition(void);
+
 #endif // FREQUENCY_TRANSITION_H
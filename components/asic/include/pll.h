@@ -1,13 +1,42 @@
 #ifndef PLL_H_
 #define PLL_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 #define FREQ_MULT 25.0 // MHz
 
+typedef struct {
+    float frequency;
+    float actual_freq;
+    uint8_t fb_divider;
+    uint8_t refdiv;
+    uint8_t postdiv1;
+    uint8_t postdiv2;
+} pll_parameters_t;
+
+// Precomputed search results for one feedback divider range, sorted by frequency
+typedef struct {
+    uint16_t fb_divider_min;
+    uint16_t fb_divider_max;
+    const pll_parameters_t * entries;
+    size_t count;
+} pll_table_t;
+
 void pll_get_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_divider_max, 
                         uint8_t *fb_divider, uint8_t *refdiv, uint8_t *postdiv1, uint8_t *postdiv2,
                         float *actual_freq);
 
+/**
+ * @brief Search the PLL dividers closest to the target frequency.
+ *
+ * pll_get_parameters only falls back to this for frequencies that are not
+ * in the tables generated at build time by gen_pll_tables.py.
+ */
+void pll_search_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_divider_max,
+                           pll_parameters_t * parameters);
+
+const pll_table_t * pll_get_tables(size_t * count);
+
 #endif /* PLL_H_ */
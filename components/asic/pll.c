@@ -3,6 +3,7 @@
 #include <math.h>
 
 #include "pll.h"
+#include "pll_tables.h"
 
 #include "esp_log.h"
 
@@ -10,9 +11,8 @@
 
 static const char * TAG = "pll";
 
-void pll_get_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_divider_max, 
-                        uint8_t *fb_divider, uint8_t *refdiv, uint8_t *postdiv1, uint8_t *postdiv2,
-                        float *actual_freq) 
+void pll_search_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_divider_max,
+                           pll_parameters_t * parameters)
 {
     float best_freq = 0;
     uint8_t best_refdiv = 0, best_fb_divider = 0, best_postdiv1 = 0, best_postdiv2 = 0;
@@ -51,11 +51,63 @@ void pll_get_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_
         }
     }
 
-    ESP_LOGI(TAG, "Frequency: %g MHz (fb_divider: %d, refdiv: %d, postdiv1: %d, postdiv2: %d)", best_freq, best_fb_divider, best_refdiv, best_postdiv1, best_postdiv2);
+    parameters->frequency = target_freq;
+    parameters->actual_freq = best_freq;
+    parameters->fb_divider = best_fb_divider;
+    parameters->refdiv = best_refdiv;
+    parameters->postdiv1 = best_postdiv1;
+    parameters->postdiv2 = best_postdiv2;
+}
+
+static const pll_parameters_t * lookup_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_divider_max)
+{
+    for (size_t i = 0; i < sizeof(PLL_TABLES) / sizeof(PLL_TABLES[0]); i++) {
+        const pll_table_t * table = &PLL_TABLES[i];
+        if (table->fb_divider_min != fb_divider_min || table->fb_divider_max != fb_divider_max) {
+            continue;
+        }
+
+        size_t low = 0, high = table->count;
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (table->entries[mid].frequency < target_freq) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low < table->count && table->entries[low].frequency == target_freq) {
+            return &table->entries[low];
+        }
+    }
+    return NULL;
+}
+
+void pll_get_parameters(float target_freq, uint16_t fb_divider_min, uint16_t fb_divider_max, 
+                        uint8_t *fb_divider, uint8_t *refdiv, uint8_t *postdiv1, uint8_t *postdiv2,
+                        float *actual_freq) 
+{
+    pll_parameters_t parameters;
+
+    const pll_parameters_t * table_parameters = lookup_parameters(target_freq, fb_divider_min, fb_divider_max);
+    if (table_parameters != NULL) {
+        parameters = *table_parameters;
+    } else {
+        // Custom frequency off the precomputed grid
+        pll_search_parameters(target_freq, fb_divider_min, fb_divider_max, &parameters);
+    }
+
+    ESP_LOGI(TAG, "Frequency: %g MHz (fb_divider: %d, refdiv: %d, postdiv1: %d, postdiv2: %d)", parameters.actual_freq, parameters.fb_divider, parameters.refdiv, parameters.postdiv1, parameters.postdiv2);
 
-    *actual_freq = best_freq;
-    *fb_divider = best_fb_divider;
-    *refdiv = best_refdiv;
-    *postdiv1 = best_postdiv1;
-    *postdiv2 = best_postdiv2;
+    *actual_freq = parameters.actual_freq;
+    *fb_divider = parameters.fb_divider;
+    *refdiv = parameters.refdiv;
+    *postdiv1 = parameters.postdiv1;
+    *postdiv2 = parameters.postdiv2;
+}
+
+const pll_table_t * pll_get_tables(size_t * count)
+{
+    *count = sizeof(PLL_TABLES) / sizeof(PLL_TABLES[0]);
+    return PLL_TABLES;
 }
@@ -16,3 +16,43 @@ TEST_CASE("Check PLL frequency calculation", "[pll]")
     TEST_ASSERT_EQUAL_UINT8(1, postdiv2);
     TEST_ASSERT_FLOAT_WITHIN(0.01, 450.0, actual_freq);
 }
+
+TEST_CASE("Check PLL tables match the search", "[pll]")
+{
+    size_t table_count;
+    const pll_table_t * tables = pll_get_tables(&table_count);
+
+    TEST_ASSERT_GREATER_THAN(0, table_count);
+
+    for (size_t i = 0; i < table_count; i++) {
+        for (size_t j = 0; j < tables[i].count; j++) {
+            const pll_parameters_t * expected = &tables[i].entries[j];
+            pll_parameters_t actual;
+
+            pll_search_parameters(expected->frequency, tables[i].fb_divider_min, tables[i].fb_divider_max, &actual);
+
+            TEST_ASSERT_EQUAL_UINT8(expected->fb_divider, actual.fb_divider);
+            TEST_ASSERT_EQUAL_UINT8(expected->refdiv, actual.refdiv);
+            TEST_ASSERT_EQUAL_UINT8(expected->postdiv1, actual.postdiv1);
+            TEST_ASSERT_EQUAL_UINT8(expected->postdiv2, actual.postdiv2);
+            TEST_ASSERT_EQUAL_FLOAT(expected->actual_freq, actual.actual_freq);
+        }
+    }
+}
+
+TEST_CASE("Check PLL off-grid frequency falls back to the search", "[pll]")
+{
+    float frequency = 451.3; // MHz, not in the tables
+    uint8_t fb_divider, refdiv, postdiv1, postdiv2;
+    float actual_freq;
+    pll_parameters_t expected;
+
+    pll_search_parameters(frequency, 144, 235, &expected);
+    pll_get_parameters(frequency, 144, 235, &fb_divider, &refdiv, &postdiv1, &postdiv2, &actual_freq);
+
+    TEST_ASSERT_EQUAL_UINT8(expected.fb_divider, fb_divider);
+    TEST_ASSERT_EQUAL_UINT8(expected.refdiv, refdiv);
+    TEST_ASSERT_EQUAL_UINT8(expected.postdiv1, postdiv1);
+    TEST_ASSERT_EQUAL_UINT8(expected.postdiv2, postdiv2);
+    TEST_ASSERT_EQUAL_FLOAT(expected.actual_freq, actual_freq);
+}
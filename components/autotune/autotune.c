@@ -0,0 +1,167 @@
+#include <string.h>
+
+#include "autotune.h"
+
+float autotune_efficiency(float power, float hashrate)
+{
+    if (hashrate <= 0) {
+        return 0;
+    }
+    return power / (hashrate / 1000.0f);
+}
+
+static bool is_better(const autotune_t * autotune, const autotune_measurement_t * measurement)
+{
+    const autotune_progress_t * progress = &autotune->progress;
+
+    if (!progress->has_best) {
+        return true;
+    }
+
+    switch (autotune->config.goal) {
+        case AUTOTUNE_GOAL_HASHRATE:
+            return measurement->hashrate > progress->best_hashrate;
+        case AUTOTUNE_GOAL_EFFICIENCY:
+        default:
+            return autotune_efficiency(measurement->power, measurement->hashrate)
+                 < autotune_efficiency(progress->best_power, progress->best_hashrate);
+    }
+}
+
+static bool is_over_power_cap(const autotune_t * autotune, float power)
+{
+    return autotune->config.power_cap > 0 && power > autotune->config.power_cap;
+}
+
+static bool is_stable(const autotune_t * autotune, const autotune_measurement_t * measurement)
+{
+    float expected_hashrate = autotune->progress.point.frequency * autotune->config.ghs_per_mhz;
+
+    if (measurement->error_percent > autotune->config.max_error_percent) {
+        return false;
+    }
+    return measurement->hashrate >= expected_hashrate * autotune->config.min_hashrate_ratio;
+}
+
+void autotune_start(autotune_t * autotune, const autotune_config_t * config)
+{
+    autotune_progress_t progress = {
+        .point = {
+            .frequency = config->frequency_min,
+            .voltage = config->voltage_min,
+        },
+    };
+
+    autotune_resume(autotune, config, &progress);
+}
+
+void autotune_resume(autotune_t * autotune, const autotune_config_t * config, const autotune_progress_t * progress)
+{
+    memset(autotune, 0, sizeof(autotune_t));
+    autotune->config = *config;
+    autotune->progress = *progress;
+    autotune->state = AUTOTUNE_STATE_RUNNING;
+
+    // Never measure a point again that the board did not survive
+    if (autotune->progress.in_measurement) {
+        autotune->progress.in_measurement = false;
+        if (autotune->progress.has_best) {
+            autotune->state = AUTOTUNE_STATE_DONE;
+        } else {
+            autotune_abort(autotune, AUTOTUNE_ABORT_RESET);
+        }
+        return;
+    }
+
+    // Bounds may have been tightened since the progress was saved
+    if (autotune->progress.point.frequency < config->frequency_min) {
+        autotune->progress.point.frequency = config->frequency_min;
+    }
+    if (autotune->progress.point.voltage < config->voltage_min) {
+        autotune->progress.point.voltage = config->voltage_min;
+    }
+    if (autotune->progress.point.frequency > config->frequency_max || autotune->progress.point.voltage > config->voltage_max) {
+        autotune->state = AUTOTUNE_STATE_DONE;
+    }
+}
+
+bool autotune_next(const autotune_t * autotune, autotune_point_t * point)
+{
+    if (autotune->state != AUTOTUNE_STATE_RUNNING) {
+        return false;
+    }
+
+    *point = autotune->progress.point;
+    return true;
+}
+
+void autotune_report(autotune_t * autotune, const autotune_measurement_t * measurement)
+{
+    autotune_progress_t * progress = &autotune->progress;
+
+    if (autotune->state != AUTOTUNE_STATE_RUNNING) {
+        return;
+    }
+
+    autotune->points_measured++;
+
+    if (measurement->fault) {
+        autotune_abort(autotune, AUTOTUNE_ABORT_FAULT);
+        return;
+    }
+    if (measurement->chip_temp > autotune->config.max_chip_temp) {
+        autotune_abort(autotune, AUTOTUNE_ABORT_CHIP_TEMP);
+        return;
+    }
+    if (measurement->vr_temp > autotune->config.max_vr_temp) {
+        autotune_abort(autotune, AUTOTUNE_ABORT_VR_TEMP);
+        return;
+    }
+
+    // More voltage or frequency only draws more power
+    if (is_over_power_cap(autotune, measurement->power)) {
+        autotune->state = AUTOTUNE_STATE_DONE;
+        return;
+    }
+
+    if (is_stable(autotune, measurement)) {
+        if (is_better(autotune, measurement)) {
+            progress->best = progress->point;
+            progress->best_hashrate = measurement->hashrate;
+            progress->best_power = measurement->power;
+            progress->has_best = true;
+        }
+
+        progress->point.frequency += autotune->config.frequency_step;
+        if (progress->point.frequency > autotune->config.frequency_max) {
+            autotune->state = AUTOTUNE_STATE_DONE;
+        }
+        return;
+    }
+
+    // Unstable: try the same frequency again with more voltage
+    progress->point.voltage += autotune->config.voltage_step;
+    if (progress->point.voltage > autotune->config.voltage_max) {
+        autotune->state = AUTOTUNE_STATE_DONE;
+    }
+}
+
+void autotune_abort(autotune_t * autotune, autotune_abort_reason_t reason)
+{
+    if (autotune->state != AUTOTUNE_STATE_RUNNING) {
+        return;
+    }
+
+    autotune->state = AUTOTUNE_STATE_ABORTED;
+    autotune->abort_reason = reason;
+}
+
+bool autotune_get_best(const autotune_t * autotune, autotune_point_t * point)
+{
+    if (!autotune->progress.has_best) {
+        return false;
+    }
+
+    *point = autotune->progress.best;
+    return true;
+}
@@ -0,0 +1,122 @@
+#ifndef AUTOTUNE_H_
+#define AUTOTUNE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    AUTOTUNE_GOAL_EFFICIENCY = 0, // lowest J/TH
+    AUTOTUNE_GOAL_HASHRATE,       // highest hashrate under the power cap
+} autotune_goal_t;
+
+typedef enum {
+    AUTOTUNE_STATE_IDLE = 0,
+    AUTOTUNE_STATE_RUNNING,
+    AUTOTUNE_STATE_DONE,
+    AUTOTUNE_STATE_ABORTED,
+} autotune_state_t;
+
+typedef enum {
+    AUTOTUNE_ABORT_NONE = 0,
+    AUTOTUNE_ABORT_CHIP_TEMP,
+    AUTOTUNE_ABORT_VR_TEMP,
+    AUTOTUNE_ABORT_FAULT,
+    AUTOTUNE_ABORT_USER,
+    AUTOTUNE_ABORT_RESET,      // the board reset while measuring a point
+} autotune_abort_reason_t;
+
+// Safe bounds and limits of the search
+typedef struct {
+    autotune_goal_t goal;
+    float frequency_min;       // MHz
+    float frequency_max;       // MHz
+    float frequency_step;      // MHz
+    uint16_t voltage_min;      // mV
+    uint16_t voltage_max;      // mV
+    uint16_t voltage_step;     // mV
+    float power_cap;           // W, 0 for no cap
+    float max_error_percent;   // hardware errors per expected hashrate
+    float min_hashrate_ratio;  // measured over expected hashrate
+    float max_chip_temp;       // °C
+    float max_vr_temp;         // °C
+    float ghs_per_mhz;         // expected hashrate per MHz of the whole chain
+} autotune_config_t;
+
+typedef struct {
+    float frequency;           // MHz
+    uint16_t voltage;          // mV
+} autotune_point_t;
+
+// Averaged measurement of one frequency/voltage pair
+typedef struct {
+    float hashrate;            // GH/s, from the hash counter registers
+    float error_percent;       // hardware errors per expected hashrate
+    float power;               // W
+    float chip_temp;           // °C
+    float vr_temp;             // °C
+    bool fault;                // voltage regulator or power fault
+} autotune_measurement_t;
+
+// Everything needed to resume a search, small enough to persist
+typedef struct {
+    autotune_point_t point;    // next point to measure
+    autotune_point_t best;
+    float best_hashrate;       // GH/s
+    float best_power;          // W
+    bool has_best;
+    bool in_measurement;       // set while the point is measured, still set after a crash or reset
+} autotune_progress_t;
+
+typedef struct {
+    autotune_config_t config;
+    autotune_state_t state;
+    autotune_abort_reason_t abort_reason;
+    autotune_progress_t progress;
+    uint16_t points_measured;
+} autotune_t;
+
+/**
+ * @brief Start a new search at the lowest frequency and voltage.
+ *
+ * The search walks the stability frontier: the frequency goes up while
+ * the chips stay stable, and the voltage goes up when they do not. Every
+ * stable point under the power cap is scored for the goal.
+ */
+void autotune_start(autotune_t * autotune, const autotune_config_t * config);
+
+/**
+ * @brief Continue an interrupted search from its persisted progress.
+ *
+ * A point that was still being measured may have crashed the board, so it
+ * counts as failed: the search ends at the best point found so far, or
+ * aborts when there is none.
+ */
+void autotune_resume(autotune_t * autotune, const autotune_config_t * config, const autotune_progress_t * progress);
+
+/**
+ * @brief Get the next frequency/voltage pair to measure.
+ *
+ * @return false when the search is not running anymore
+ */
+bool autotune_next(const autotune_t * autotune, autotune_point_t * point);
+
+/**
+ * @brief Report the measurement of the pair returned by autotune_next.
+ *
+ * Aborts the search when the thermal or fault limits are exceeded.
+ */
+void autotune_report(autotune_t * autotune, const autotune_measurement_t * measurement);
+
+void autotune_abort(autotune_t * autotune, autotune_abort_reason_t reason);
+
+/**
+ * @brief Get the best pair found so far.
+ *
+ * @return false when no stable pair was found
+ */
+bool autotune_get_best(const autotune_t * autotune, autotune_point_t * point);
+
+// Efficiency in J/TH
+float autotune_efficiency(float power, float hashrate);
+
+#endif /* AUTOTUNE_H_ */
@@ -0,0 +1,218 @@
+#include "unity.h"
+#include "autotune.h"
+
+// Simulated chain: stable up to a frequency that rises with the voltage,
+// power with a static part and a dynamic part growing with f * V^2.
+#define SIM_GHS_PER_MHZ 2.04f
+#define SIM_STATIC_POWER 10.0f
+
+static bool sim_is_stable(float frequency, uint16_t voltage)
+{
+    float max_frequency = 300.0f + (voltage - 1000) * 2.0f;
+    return frequency <= max_frequency;
+}
+
+static float sim_power(float frequency, uint16_t voltage)
+{
+    float volts = voltage / 1000.0f;
+    return SIM_STATIC_POWER + 0.04f * frequency * volts * volts;
+}
+
+static autotune_measurement_t sim_measure(autotune_point_t point)
+{
+    bool stable = sim_is_stable(point.frequency, point.voltage);
+    float power = sim_power(point.frequency, point.voltage);
+
+    autotune_measurement_t measurement = {
+        .hashrate = point.frequency * SIM_GHS_PER_MHZ * (stable ? 0.99f : 0.7f),
+        .error_percent = stable ? 0.1f : 5.0f,
+        .power = power,
+        .chip_temp = 30.0f + power * 1.5f,
+        .vr_temp = 40.0f,
+        .fault = false,
+    };
+    return measurement;
+}
+
+static autotune_config_t sim_config(autotune_goal_t goal, float power_cap)
+{
+    autotune_config_t config = {
+        .goal = goal,
+        .frequency_min = 400,
+        .frequency_max = 700,
+        .frequency_step = 25,
+        .voltage_min = 1000,
+        .voltage_max = 1300,
+        .voltage_step = 50,
+        .power_cap = power_cap,
+        .max_error_percent = 1.0f,
+        .min_hashrate_ratio = 0.9f,
+        .max_chip_temp = 120.0f,
+        .max_vr_temp = 100.0f,
+        .ghs_per_mhz = SIM_GHS_PER_MHZ,
+    };
+    return config;
+}
+
+static void sim_run(autotune_t * autotune, int max_points)
+{
+    autotune_point_t point;
+    for (int i = 0; i < max_points && autotune_next(autotune, &point); i++) {
+        autotune_measurement_t measurement = sim_measure(point);
+        autotune_report(autotune, &measurement);
+    }
+}
+
+// Exhaustive search over the whole grid of the simulated chain
+static autotune_point_t sim_brute_force(const autotune_config_t * config)
+{
+    autotune_point_t best = { 0 };
+    float best_score = 0;
+
+    for (uint16_t voltage = config->voltage_min; voltage <= config->voltage_max; voltage += config->voltage_step) {
+        for (float frequency = config->frequency_min; frequency <= config->frequency_max; frequency += config->frequency_step) {
+            autotune_point_t point = { .frequency = frequency, .voltage = voltage };
+            autotune_measurement_t measurement = sim_measure(point);
+            if (!sim_is_stable(frequency, voltage)) continue;
+            if (config->power_cap > 0 && measurement.power > config->power_cap) continue;
+
+            float score = config->goal == AUTOTUNE_GOAL_HASHRATE
+                ? measurement.hashrate
+                : -autotune_efficiency(measurement.power, measurement.hashrate);
+            if (best.frequency == 0 || score > best_score) {
+                best = point;
+                best_score = score;
+            }
+        }
+    }
+    return best;
+}
+
+TEST_CASE("Autotune finds the best efficiency of the simulated chain", "[autotune]")
+{
+    autotune_config_t config = sim_config(AUTOTUNE_GOAL_EFFICIENCY, 0);
+    autotune_t autotune;
+    autotune_point_t best;
+
+    autotune_start(&autotune, &config);
+    sim_run(&autotune, 100);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_DONE, autotune.state);
+    TEST_ASSERT_TRUE(autotune_get_best(&autotune, &best));
+
+    autotune_point_t expected = sim_brute_force(&config);
+    TEST_ASSERT_EQUAL_FLOAT(expected.frequency, best.frequency);
+    TEST_ASSERT_EQUAL_UINT16(expected.voltage, best.voltage);
+
+    // The frontier walk measures far fewer points than the whole grid
+    TEST_ASSERT_LESS_THAN(7 * 13, autotune.points_measured);
+}
+
+TEST_CASE("Autotune finds the best hashrate under the power cap", "[autotune]")
+{
+    autotune_config_t config = sim_config(AUTOTUNE_GOAL_HASHRATE, 40.0f);
+    autotune_t autotune;
+    autotune_point_t best;
+
+    autotune_start(&autotune, &config);
+    sim_run(&autotune, 100);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_DONE, autotune.state);
+    TEST_ASSERT_TRUE(autotune_get_best(&autotune, &best));
+
+    autotune_point_t expected = sim_brute_force(&config);
+    TEST_ASSERT_EQUAL_FLOAT(expected.frequency, best.frequency);
+    TEST_ASSERT_EQUAL_UINT16(expected.voltage, best.voltage);
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(40.0f, sim_power(best.frequency, best.voltage));
+}
+
+TEST_CASE("Autotune resumes an interrupted search", "[autotune]")
+{
+    autotune_config_t config = sim_config(AUTOTUNE_GOAL_EFFICIENCY, 0);
+    autotune_t uninterrupted, interrupted, resumed;
+    autotune_point_t expected, best;
+
+    autotune_start(&uninterrupted, &config);
+    sim_run(&uninterrupted, 100);
+    TEST_ASSERT_TRUE(autotune_get_best(&uninterrupted, &expected));
+
+    autotune_start(&interrupted, &config);
+    sim_run(&interrupted, 5);
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_RUNNING, interrupted.state);
+
+    autotune_progress_t progress = interrupted.progress;
+    autotune_resume(&resumed, &config, &progress);
+    sim_run(&resumed, 100);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_DONE, resumed.state);
+    TEST_ASSERT_TRUE(autotune_get_best(&resumed, &best));
+    TEST_ASSERT_EQUAL_FLOAT(expected.frequency, best.frequency);
+    TEST_ASSERT_EQUAL_UINT16(expected.voltage, best.voltage);
+}
+
+TEST_CASE("Autotune steps back from a point the board did not survive", "[autotune]")
+{
+    autotune_config_t config = sim_config(AUTOTUNE_GOAL_EFFICIENCY, 0);
+    autotune_t interrupted, resumed;
+    autotune_point_t point, best;
+
+    autotune_start(&interrupted, &config);
+    sim_run(&interrupted, 5);
+    TEST_ASSERT_TRUE(autotune_get_best(&interrupted, &best));
+
+    // Reset while the next point was measured
+    autotune_progress_t progress = interrupted.progress;
+    progress.in_measurement = true;
+    autotune_resume(&resumed, &config, &progress);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_DONE, resumed.state);
+    TEST_ASSERT_FALSE(autotune_next(&resumed, &point));
+    TEST_ASSERT_TRUE(autotune_get_best(&resumed, &point));
+    TEST_ASSERT_EQUAL_FLOAT(best.frequency, point.frequency);
+    TEST_ASSERT_EQUAL_UINT16(best.voltage, point.voltage);
+
+    // Reset on the very first point, nothing to fall back to
+    autotune_start(&interrupted, &config);
+    progress = interrupted.progress;
+    progress.in_measurement = true;
+    autotune_resume(&resumed, &config, &progress);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_ABORTED, resumed.state);
+    TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_RESET, resumed.abort_reason);
+}
+
+TEST_CASE("Autotune aborts on the chip temperature limit", "[autotune]")
+{
+    autotune_config_t config = sim_config(AUTOTUNE_GOAL_HASHRATE, 0);
+    config.max_chip_temp = 30.0f + sim_power(500, 1100) * 1.5f;
+    autotune_t autotune;
+    autotune_point_t best;
+
+    autotune_start(&autotune, &config);
+    sim_run(&autotune, 100);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_ABORTED, autotune.state);
+    TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_CHIP_TEMP, autotune.abort_reason);
+
+    // Only points below the limit were accepted
+    TEST_ASSERT_TRUE(autotune_get_best(&autotune, &best));
+    TEST_ASSERT_LESS_OR_EQUAL_FLOAT(config.max_chip_temp, 30.0f + sim_power(best.frequency, best.voltage) * 1.5f);
+}
+
+TEST_CASE("Autotune aborts on a fault", "[autotune]")
+{
+    autotune_config_t config = sim_config(AUTOTUNE_GOAL_EFFICIENCY, 0);
+    autotune_t autotune;
+    autotune_point_t point;
+
+    autotune_start(&autotune, &config);
+    TEST_ASSERT_TRUE(autotune_next(&autotune, &point));
+
+    autotune_measurement_t measurement = sim_measure(point);
+    measurement.fault = true;
+    autotune_report(&autotune, &measurement);
+
+    TEST_ASSERT_EQUAL(AUTOTUNE_STATE_ABORTED, autotune.state);
+    TEST_ASSERT_EQUAL(AUTOTUNE_ABORT_FAULT, autotune.abort_reason);
+    TEST_ASSERT_FALSE(autotune_next(&autotune, &point));
+}
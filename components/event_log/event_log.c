@@ -0,0 +1,213 @@
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "event_log.h"
+
+#define EVENT_LOG_RING_SIZE 128
+#define EVENT_LOG_DRAIN_MS 100
+#define EVENT_LOG_LINE_MAX 128
+
+static const char * TAG = "event_log";
+
+static int format_result_nonce(const uint32_t args[EVENT_LOG_MAX_ARGS], char * buf, size_t size)
+{
+    float nonce_diff;
+    char pool_job[EVENT_LOG_STRING_MAX + 1] = {0};
+    memcpy(&nonce_diff, &args[3], sizeof(nonce_diff));
+    memcpy(pool_job, &args[5], EVENT_LOG_STRING_MAX);
+    return snprintf(buf, size, "ID: %s, Job ID: %02" PRIX32 ", ver: %08" PRIX32 " Nonce %08" PRIX32 " diff %.1f of %" PRIu32 ".",
+                    pool_job, args[0], args[1], args[2], nonce_diff, args[4]);
+}
+
+const event_def_t event_defs[EVENT_COUNT] = {
+    [EVENT_NONE] = { EVENT_SUBSYSTEM_ASIC, ESP_LOG_NONE, "event_log", "" },
+    [EVENT_ASIC_NONCE] = { EVENT_SUBSYSTEM_ASIC, ESP_LOG_INFO, "asic",
+        "Job ID: %02" PRIX32 ", Core: %" PRIu32 "/%" PRIu32 ", Ver: %08" PRIX32 },
+    [EVENT_ASIC_CHIP_NONCE] = { EVENT_SUBSYSTEM_ASIC, ESP_LOG_INFO, "asic",
+        "Job ID: %02" PRIX32 ", Asic: %" PRIu32 ", Core: %" PRIu32 "/%" PRIu32 ", Ver: %08" PRIX32 },
+    [EVENT_RESULT_NONCE] = { EVENT_SUBSYSTEM_RESULT, ESP_LOG_INFO, "asic_result", NULL, format_result_nonce },
+    [EVENT_STRATUM_RX] = { EVENT_SUBSYSTEM_STRATUM, ESP_LOG_INFO, "stratum_api",
+        "rx: id %" PRIu32 ", method %" PRIu32 },
+};
+
+// Log tag of every subsystem, its level decides what is recorded
+static const char * const subsystem_tags[EVENT_SUBSYSTEM_COUNT] = {
+    [EVENT_SUBSYSTEM_ASIC] = "asic",
+    [EVENT_SUBSYSTEM_RESULT] = "asic_result",
+    [EVENT_SUBSYSTEM_STRATUM] = "stratum_api",
+};
+
+esp_log_level_t event_log_levels[EVENT_SUBSYSTEM_COUNT] = {
+    [EVENT_SUBSYSTEM_ASIC] = ESP_LOG_INFO,
+    [EVENT_SUBSYSTEM_RESULT] = ESP_LOG_INFO,
+    [EVENT_SUBSYSTEM_STRATUM] = ESP_LOG_INFO,
+};
+
+// The id is written last, a slot with EVENT_NONE is still being filled
+typedef struct {
+    atomic_uint id;
+    uint32_t args[EVENT_LOG_MAX_ARGS];
+    int64_t time_us;
+} event_slot_t;
+
+// One ring per core keeps the writers of both cores off each other's cache lines
+typedef struct {
+    event_slot_t slots[EVENT_LOG_RING_SIZE];
+    atomic_uint head;            // slots reserved by writers, free running
+    atomic_uint tail;            // slots taken by the reader
+} event_ring_t;
+
+static event_ring_t rings[portNUM_PROCESSORS];
+static atomic_uint dropped;
+static uint32_t dropped_reported;      // by the event log task
+
+void event_log_record(event_id_t id, const uint32_t args[EVENT_LOG_MAX_ARGS])
+{
+    event_ring_t * ring = &rings[esp_cpu_get_core_id()];
+
+    // A task preempted or moved to the other core in between still gets a slot of its own
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    do {
+        if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= EVENT_LOG_RING_SIZE) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ring->head, &head, head + 1,
+                                                    memory_order_acquire, memory_order_relaxed));
+
+    event_slot_t * slot = &ring->slots[head % EVENT_LOG_RING_SIZE];
+    slot->time_us = esp_timer_get_time();
+    memcpy(slot->args, args, sizeof(slot->args));
+    atomic_store_explicit(&slot->id, id, memory_order_release);
+}
+
+bool event_log_read(event_record_t * record)
+{
+    event_ring_t * oldest_ring = NULL;
+    event_slot_t * oldest = NULL;
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        event_ring_t * ring = &rings[i];
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        if (tail == atomic_load_explicit(&ring->head, memory_order_acquire)) {
+            continue;
+        }
+        event_slot_t * slot = &ring->slots[tail % EVENT_LOG_RING_SIZE];
+        if (atomic_load_explicit(&slot->id, memory_order_acquire) == EVENT_NONE) {
+            continue;
+        }
+        if (oldest == NULL || slot->time_us < oldest->time_us) {
+            oldest_ring = ring;
+            oldest = slot;
+        }
+    }
+
+    if (oldest == NULL) {
+        return false;
+    }
+
+    record->id = atomic_load_explicit(&oldest->id, memory_order_relaxed);
+    record->time_us = oldest->time_us;
+    memcpy(record->args, oldest->args, sizeof(record->args));
+
+    atomic_store_explicit(&oldest->id, EVENT_NONE, memory_order_relaxed);
+    atomic_fetch_add_explicit(&oldest_ring->tail, 1, memory_order_release);
+    return true;
+}
+
+int event_log_format(const event_record_t * record, char * buf, size_t size)
+{
+    if (record->id <= EVENT_NONE || record->id >= EVENT_COUNT) {
+        return snprintf(buf, size, "unknown event %d", record->id);
+    }
+
+    const event_def_t * def = &event_defs[record->id];
+    const uint32_t * args = record->args;
+    if (def->formatter != NULL) {
+        return def->formatter(args, buf, size);
+    }
+    return snprintf(buf, size, def->format, args[0], args[1], args[2], args[3], args[4]);
+}
+
+void event_log_set_level(event_subsystem_t subsystem, esp_log_level_t level)
+{
+    if (subsystem < EVENT_SUBSYSTEM_COUNT) {
+        esp_log_level_set(subsystem_tags[subsystem], level);
+        event_log_levels[subsystem] = level;
+    }
+}
+
+esp_log_level_t event_log_get_level(event_subsystem_t subsystem)
+{
+    return subsystem < EVENT_SUBSYSTEM_COUNT ? event_log_levels[subsystem] : ESP_LOG_NONE;
+}
+
+uint32_t event_log_dropped(void)
+{
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+static char level_letter(esp_log_level_t level)
+{
+    switch (level) {
+        case ESP_LOG_ERROR: return 'E';
+        case ESP_LOG_WARN:  return 'W';
+        case ESP_LOG_DEBUG: return 'D';
+        case ESP_LOG_VERBOSE: return 'V';
+        default:            return 'I';
+    }
+}
+
+static const char * level_color(esp_log_level_t level)
+{
+    switch (level) {
+        case ESP_LOG_ERROR: return LOG_COLOR_E;
+        case ESP_LOG_WARN:  return LOG_COLOR_W;
+        case ESP_LOG_DEBUG: return LOG_COLOR_D;
+        case ESP_LOG_VERBOSE: return LOG_COLOR_V;
+        default:            return LOG_COLOR_I;
+    }
+}
+
+// Records are printed like ESP_LOG lines, with the time they were recorded
+static void event_log_task(void * pvParameters)
+{
+    event_record_t record;
+    char text[EVENT_LOG_LINE_MAX];
+
+    while (1) {
+        while (event_log_read(&record)) {
+            const event_def_t * def = &event_defs[record.id];
+            event_log_format(&record, text, sizeof(text));
+            esp_log_write(def->level, def->tag, "%s%c (%" PRIu32 ") %s: %s%s\n", level_color(def->level),
+                          level_letter(def->level), (uint32_t) (record.time_us / 1000), def->tag, text,
+                          LOG_RESET_COLOR);
+        }
+
+        // The hot paths only read the cached levels, a lookup of the tag is too slow for them
+        for (int i = 0; i < EVENT_SUBSYSTEM_COUNT; i++) {
+            event_log_levels[i] = esp_log_level_get(subsystem_tags[i]);
+        }
+
+        uint32_t total = event_log_dropped();
+        if (total != dropped_reported) {
+            ESP_LOGW(TAG, "%" PRIu32 " events dropped", total - dropped_reported);
+            dropped_reported = total;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(EVENT_LOG_DRAIN_MS));
+    }
+}
+
+void event_log_init(void)
+{
+    if (xTaskCreate(event_log_task, "event log", 4096, NULL, 1, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Error creating event log task");
+    }
+}
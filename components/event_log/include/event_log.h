@@ -0,0 +1,128 @@
+#ifndef EVENT_LOG_H_
+#define EVENT_LOG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_log.h"
+
+#define EVENT_LOG_MAX_ARGS 9
+#define EVENT_LOG_STRING_MAX 16       // characters of a string argument, longer strings are cut
+#define EVENT_LOG_STRING_WORDS (EVENT_LOG_STRING_MAX / sizeof(uint32_t))
+
+typedef enum {
+    EVENT_SUBSYSTEM_ASIC = 0,    // chip drivers
+    EVENT_SUBSYSTEM_RESULT,      // nonce checks of the result task
+    EVENT_SUBSYSTEM_STRATUM,
+    EVENT_SUBSYSTEM_COUNT,
+} event_subsystem_t;
+
+typedef enum {
+    EVENT_NONE = 0,
+    EVENT_ASIC_NONCE,            // job id, core, small core, version bits
+    EVENT_ASIC_CHIP_NONCE,       // job id, chip, core, small core, version bits
+    EVENT_RESULT_NONCE,          // job id, rolled version, nonce, difficulty as float, pool difficulty, pool job id as string
+    EVENT_STRATUM_RX,            // message id, stratum_method
+    EVENT_COUNT,
+} event_id_t;
+
+// Formats the arguments of an event that are not all plain uint32_t, like snprintf
+typedef int (*event_formatter_t)(const uint32_t args[EVENT_LOG_MAX_ARGS], char * buf, size_t size);
+
+typedef struct {
+    event_subsystem_t subsystem;
+    esp_log_level_t level;
+    const char * tag;
+    const char * format;         // conversions of uint32_t arguments only
+    event_formatter_t formatter; // used instead of the format when set
+} event_def_t;
+
+typedef struct {
+    event_id_t id;
+    int64_t time_us;             // esp_timer time of the record
+    uint32_t args[EVENT_LOG_MAX_ARGS];
+} event_record_t;
+
+extern const event_def_t event_defs[EVENT_COUNT];
+extern esp_log_level_t event_log_levels[EVENT_SUBSYSTEM_COUNT];
+
+static inline bool event_log_enabled(event_id_t id)
+{
+    return event_defs[id].level <= event_log_levels[event_defs[id].subsystem];
+}
+
+// Passes a float as an event argument
+static inline uint32_t event_log_float(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Copies a string into event arguments, the pointer may not outlive the record
+static inline void event_log_string(const char * value, uint32_t words[EVENT_LOG_STRING_WORDS])
+{
+    char text[EVENT_LOG_STRING_MAX] = {0};
+    memcpy(text, value, strnlen(value, sizeof(text)));
+    memcpy(words, text, sizeof(text));
+}
+
+/**
+ * @brief Record an event when its subsystem is verbose enough.
+ *
+ * Only the arguments are stored, they are formatted later by the event log task.
+ */
+#define EVENT_LOG(id, ...)                                                  \
+    do {                                                                    \
+        if (event_log_enabled(id)) {                                        \
+            const uint32_t event_args[EVENT_LOG_MAX_ARGS] = { __VA_ARGS__ }; \
+            event_log_record(id, event_args);                               \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief Start the low priority task that formats the records to the log.
+ *
+ * Records are kept without the task, e.g. in the unit tests.
+ */
+void event_log_init(void);
+
+/**
+ * @brief Append a record to the ring of the current core, dropped when the ring is full.
+ *
+ * Safe to call from any task, it does not block or allocate.
+ */
+void event_log_record(event_id_t id, const uint32_t args[EVENT_LOG_MAX_ARGS]);
+
+/**
+ * @brief Take the oldest record of all cores.
+ *
+ * There must be a single reader, the event log task once it runs.
+ *
+ * @return false when no record is ready
+ */
+bool event_log_read(event_record_t * record);
+
+/**
+ * @brief Format the message of a record, without the log prefix.
+ *
+ * @return length like snprintf
+ */
+int event_log_format(const event_record_t * record, char * buf, size_t size);
+
+/**
+ * @brief Set the level of a subsystem and of its log tag.
+ *
+ * The levels follow the log tags, the event log task picks up a change
+ * made with esp_log_level_set at runtime within one drain period.
+ */
+void event_log_set_level(event_subsystem_t subsystem, esp_log_level_t level);
+esp_log_level_t event_log_get_level(event_subsystem_t subsystem);
+
+/**
+ * @brief Records lost since boot because a ring was full.
+ */
+uint32_t event_log_dropped(void);
+
+#endif /* EVENT_LOG_H_ */
@@ -0,0 +1,143 @@
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "event_log.h"
+
+#define BENCHMARK_NONCES 50 // two records each, below the ring size
+
+static const char * TAG = "test_event_log";
+
+static void drain(void)
+{
+    event_record_t record;
+    while (event_log_read(&record)) {
+    }
+}
+
+// Formats like the console output, without the time spent on the UART
+static int null_vprintf(const char * format, va_list args)
+{
+    char line[128];
+    return vsnprintf(line, sizeof(line), format, args);
+}
+
+TEST_CASE("Event records are read back in order and formatted", "[event_log]")
+{
+    drain();
+
+    EVENT_LOG(EVENT_ASIC_CHIP_NONCE, 0x18, 2, 97, 5, 0x1FFE000);
+    uint32_t pool_job[EVENT_LOG_STRING_WORDS];
+    event_log_string("6f3a1c", pool_job);
+    EVENT_LOG(EVENT_RESULT_NONCE, 0x18, 0x21FFE000, 0xDEADBEEF, event_log_float(4242.5), 1000,
+              pool_job[0], pool_job[1], pool_job[2], pool_job[3]);
+
+    event_record_t record;
+    char text[128];
+
+    TEST_ASSERT_TRUE(event_log_read(&record));
+    TEST_ASSERT_EQUAL(EVENT_ASIC_CHIP_NONCE, record.id);
+    event_log_format(&record, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("Job ID: 18, Asic: 2, Core: 97/5, Ver: 01FFE000", text);
+
+    int64_t first_time = record.time_us;
+    TEST_ASSERT_TRUE(event_log_read(&record));
+    TEST_ASSERT_EQUAL(EVENT_RESULT_NONCE, record.id);
+    TEST_ASSERT_TRUE(record.time_us >= first_time);
+    event_log_format(&record, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("ID: 6f3a1c, Job ID: 18, ver: 21FFE000 Nonce DEADBEEF diff 4242.5 of 1000.", text);
+
+    TEST_ASSERT_FALSE(event_log_read(&record));
+}
+
+TEST_CASE("String arguments longer than the record are cut", "[event_log]")
+{
+    drain();
+
+    uint32_t pool_job[EVENT_LOG_STRING_WORDS];
+    event_log_string("67f3c2a100000a3e7b", pool_job);
+    EVENT_LOG(EVENT_RESULT_NONCE, 1, 2, 3, event_log_float(1), 4, pool_job[0], pool_job[1], pool_job[2], pool_job[3]);
+
+    event_record_t record;
+    char text[128];
+    TEST_ASSERT_TRUE(event_log_read(&record));
+    event_log_format(&record, text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("ID: 67f3c2a100000a3e, Job ID: 01, ver: 00000002 Nonce 00000003 diff 1.0 of 4.", text);
+}
+
+TEST_CASE("Event subsystems below their level record nothing", "[event_log]")
+{
+    drain();
+
+    event_log_set_level(EVENT_SUBSYSTEM_ASIC, ESP_LOG_WARN);
+    EVENT_LOG(EVENT_ASIC_NONCE, 1, 2, 3, 4);
+    event_log_set_level(EVENT_SUBSYSTEM_ASIC, ESP_LOG_INFO);
+
+    event_record_t record;
+    TEST_ASSERT_FALSE(event_log_read(&record));
+
+    EVENT_LOG(EVENT_ASIC_NONCE, 1, 2, 3, 4);
+    TEST_ASSERT_TRUE(event_log_read(&record));
+}
+
+TEST_CASE("Events are dropped and counted when the ring is full", "[event_log]")
+{
+    drain();
+
+    uint32_t dropped = event_log_dropped();
+    int recorded = 0;
+    for (int i = 0; i < 1000; i++) {
+        EVENT_LOG(EVENT_STRATUM_RX, i, 1);
+    }
+
+    event_record_t record;
+    int64_t last = -1;
+    while (event_log_read(&record)) {
+        TEST_ASSERT_TRUE((int64_t) record.args[0] > last);
+        last = record.args[0];
+        recorded++;
+    }
+    TEST_ASSERT_TRUE(recorded > 0 && recorded < 1000);
+    TEST_ASSERT_EQUAL(1000 - recorded, event_log_dropped() - dropped);
+}
+
+// Cost of logging one nonce in the ASIC driver and the result task,
+// with ESP_LOGI as before and with the event records now
+TEST_CASE("Benchmark logging cost per nonce", "[event_log]")
+{
+    uint32_t job_id = 0x18, asic_nr = 2, core_id = 97, small_core_id = 5, version_bits = 0x1FFE000;
+    uint32_t nonce = 0xDEADBEEF, pool_diff = 1000;
+    double nonce_diff = 4242.5;
+
+    vprintf_like_t previous = esp_log_set_vprintf(null_vprintf);
+
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCHMARK_NONCES; i++) {
+        ESP_LOGI(TAG, "Job ID: %02" PRIX32 ", Asic: %" PRIu32 ", Core: %" PRIu32 "/%" PRIu32 ", Ver: %08" PRIX32,
+                 job_id, asic_nr, core_id, small_core_id, version_bits);
+        ESP_LOGI(TAG, "ID: %s, ver: %08" PRIX32 " Nonce %08" PRIX32 " diff %.1f of %" PRIu32 ".",
+                 "6f3a1c", version_bits, nonce, nonce_diff, pool_diff);
+    }
+    uint32_t log_cycles = (esp_cpu_get_cycle_count() - start) / BENCHMARK_NONCES;
+
+    esp_log_set_vprintf(previous);
+
+    drain();
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCHMARK_NONCES; i++) {
+        EVENT_LOG(EVENT_ASIC_CHIP_NONCE, job_id, asic_nr, core_id, small_core_id, version_bits);
+        uint32_t pool_job[EVENT_LOG_STRING_WORDS];
+        event_log_string("6f3a1c", pool_job);
+        EVENT_LOG(EVENT_RESULT_NONCE, job_id, version_bits, nonce, event_log_float(nonce_diff), pool_diff,
+                  pool_job[0], pool_job[1], pool_job[2], pool_job[3]);
+    }
+    uint32_t event_cycles = (esp_cpu_get_cycle_count() - start) / BENCHMARK_NONCES;
+    drain();
+
+    printf("Logging per nonce: ESP_LOGI %" PRIu32 " cycles, EVENT_LOG %" PRIu32 " cycles\n", log_cycles, event_cycles);
+
+    TEST_ASSERT_LESS_THAN_UINT32(log_cycles, event_cycles);
+}
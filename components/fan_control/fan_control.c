@@ -0,0 +1,100 @@
+#include <math.h>
+#include <string.h>
+
+#include "fan_control.h"
+
+// The feed-forward term fades out over about the thermal time constant of
+// the heat sink while the integral takes over
+#define FEED_FORWARD_TIME_CONSTANT 120.0f // s
+
+// Integrating far below the setpoint only winds up while heating up
+#define INTEGRAL_BAND 5.0f // °C
+
+const fan_control_gains_t fan_control_schedule[] = {
+    { .power = 10,  .kp = 6.0f, .ki = 0.3f,  .ff_gain = 4.0f },
+    { .power = 30,  .kp = 4.0f, .ki = 0.2f,  .ff_gain = 2.5f },
+    { .power = 100, .kp = 3.0f, .ki = 0.15f, .ff_gain = 1.0f },
+};
+const int fan_control_schedule_count = sizeof(fan_control_schedule) / sizeof(fan_control_schedule[0]);
+
+static float clamp(float value, float min, float max)
+{
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+void fan_control_init(fan_control_t * fan_control, const fan_control_gains_t * schedule, int schedule_count)
+{
+    memset(fan_control, 0, sizeof(fan_control_t));
+    fan_control->schedule = schedule;
+    fan_control->schedule_count = schedule_count;
+    fan_control->max_output = 100;
+}
+
+void fan_control_set_limits(fan_control_t * fan_control, float setpoint, float min_output, float max_output)
+{
+    fan_control->setpoint = setpoint;
+    fan_control->min_output = min_output;
+    fan_control->max_output = max_output;
+}
+
+fan_control_gains_t fan_control_get_gains(const fan_control_t * fan_control, float power)
+{
+    const fan_control_gains_t * schedule = fan_control->schedule;
+    int count = fan_control->schedule_count;
+
+    if (power <= schedule[0].power) {
+        return schedule[0];
+    }
+    if (power >= schedule[count - 1].power) {
+        return schedule[count - 1];
+    }
+
+    int i = 1;
+    while (power > schedule[i].power) {
+        i++;
+    }
+
+    const fan_control_gains_t * low = &schedule[i - 1];
+    const fan_control_gains_t * high = &schedule[i];
+    float t = (power - low->power) / (high->power - low->power);
+
+    fan_control_gains_t gains = {
+        .power = power,
+        .kp = low->kp + (high->kp - low->kp) * t,
+        .ki = low->ki + (high->ki - low->ki) * t,
+        .ff_gain = low->ff_gain + (high->ff_gain - low->ff_gain) * t,
+    };
+    return gains;
+}
+
+float fan_control_update(fan_control_t * fan_control, float temp, float power, float dt)
+{
+    if (power < 0) {
+        power = 0;
+    }
+
+    fan_control_gains_t gains = fan_control_get_gains(fan_control, power);
+    float error = temp - fan_control->setpoint;
+
+    if (!fan_control->has_power_reference) {
+        fan_control->power_reference = power;
+        fan_control->has_power_reference = true;
+    }
+    fan_control->power_reference += (power - fan_control->power_reference) * fminf(dt / FEED_FORWARD_TIME_CONSTANT, 1);
+    fan_control->feed_forward = gains.ff_gain * (power - fan_control->power_reference);
+
+    float integral = fan_control->integral + gains.ki * error * dt;
+    float output = fan_control->feed_forward + gains.kp * error + integral;
+
+    // Only integrate when not far below the setpoint and when it does not push further into the limits
+    if (error > -INTEGRAL_BAND
+        && (output < fan_control->max_output || error < 0) && (output > fan_control->min_output || error > 0)) {
+        fan_control->integral = clamp(integral, -fan_control->max_output, fan_control->max_output);
+    }
+
+    output = fan_control->feed_forward + gains.kp * error + fan_control->integral;
+    fan_control->output = clamp(output, fan_control->min_output, fan_control->max_output);
+    return fan_control->output;
+}
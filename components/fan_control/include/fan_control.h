@@ -0,0 +1,58 @@
+#ifndef FAN_CONTROL_H_
+#define FAN_CONTROL_H_
+
+#include <stdbool.h>
+
+// Gains at one operating point, a schedule is interpolated on power
+typedef struct {
+    float power;     // W
+    float kp;        // % fan per °C
+    float ki;        // % fan per °C per second
+    float ff_gain;   // % fan per W of power change
+} fan_control_gains_t;
+
+typedef struct {
+    float setpoint;  // °C
+    float min_output; // % fan
+    float max_output; // % fan
+    const fan_control_gains_t * schedule; // sorted by power
+    int schedule_count;
+
+    float integral;  // % fan
+    float power_reference; // W, slowly follows the power
+    bool has_power_reference;
+    float feed_forward; // % fan
+    float output;    // % fan
+} fan_control_t;
+
+// Gains the firmware ships with, from small single chip boards to the larger multi chip ones
+extern const fan_control_gains_t fan_control_schedule[];
+extern const int fan_control_schedule_count;
+
+void fan_control_init(fan_control_t * fan_control, const fan_control_gains_t * schedule, int schedule_count);
+
+void fan_control_set_limits(fan_control_t * fan_control, float setpoint, float min_output, float max_output);
+
+/**
+ * @brief Compute the fan speed from the hottest temperature and the power.
+ *
+ * A PI term on the temperature error is added to a feed-forward term
+ * proportional to the power change, so a power step moves the fan before
+ * the temperature rises. The feed-forward term fades out as the integral
+ * takes over, so the steady state does not depend on the absolute power.
+ * The integral does not run far below the setpoint and stops while the
+ * output is clamped.
+ *
+ * @param temp hottest temperature in °C
+ * @param power power in W
+ * @param dt seconds since the last update
+ * @return fan speed in %
+ */
+float fan_control_update(fan_control_t * fan_control, float temp, float power, float dt);
+
+/**
+ * @brief Interpolate the gains of the schedule at a power.
+ */
+fan_control_gains_t fan_control_get_gains(const fan_control_t * fan_control, float power);
+
+#endif /* FAN_CONTROL_H_ */
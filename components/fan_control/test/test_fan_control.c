@@ -0,0 +1,131 @@
+#include <math.h>
+#include "unity.h"
+#include "fan_control.h"
+
+// First order thermal model: the heat sink conductance grows with the fan speed
+#define SIM_AMBIENT 25.0f
+#define SIM_HEAT_CAPACITY 40.0f  // J/°C
+#define SIM_CONDUCTANCE_0 0.1f   // W/°C with the fan stopped
+#define SIM_CONDUCTANCE_FAN 0.006f // W/°C per % fan
+#define SIM_DT 1.8f              // s, poll rate of the power management task
+
+#define SETPOINT 60.0f
+
+typedef struct {
+    float temp;
+    float max_temp;
+    float min_temp;
+} sim_t;
+
+static void sim_step(sim_t * sim, float power, float fan)
+{
+    float conductance = SIM_CONDUCTANCE_0 + SIM_CONDUCTANCE_FAN * fan;
+    sim->temp += (power - (sim->temp - SIM_AMBIENT) * conductance) / SIM_HEAT_CAPACITY * SIM_DT;
+    if (sim->temp > sim->max_temp) sim->max_temp = sim->temp;
+    if (sim->temp < sim->min_temp) sim->min_temp = sim->temp;
+}
+
+static void sim_run(sim_t * sim, fan_control_t * fan_control, float power, int steps)
+{
+    sim->max_temp = sim->temp;
+    sim->min_temp = sim->temp;
+    for (int i = 0; i < steps; i++) {
+        float fan = fan_control_update(fan_control, sim->temp, power, SIM_DT);
+        sim_step(sim, power, fan);
+    }
+}
+
+static void init(fan_control_t * fan_control, const fan_control_gains_t * gains, int count)
+{
+    fan_control_init(fan_control, gains, count);
+    fan_control_set_limits(fan_control, SETPOINT, 25, 100);
+}
+
+static void init_shipped(fan_control_t * fan_control)
+{
+    init(fan_control, fan_control_schedule, fan_control_schedule_count);
+}
+
+TEST_CASE("Fan control settles at the setpoint", "[fan_control]")
+{
+    fan_control_t fan_control;
+    sim_t sim = { .temp = SIM_AMBIENT };
+
+    init_shipped(&fan_control);
+    sim_run(&sim, &fan_control, 18, 1000);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, SETPOINT, sim.temp);
+}
+
+TEST_CASE("Fan control feed-forward reduces the overshoot of a power step", "[fan_control]")
+{
+    fan_control_gains_t feedback_only[fan_control_schedule_count];
+    for (int i = 0; i < fan_control_schedule_count; i++) {
+        feedback_only[i] = fan_control_schedule[i];
+        feedback_only[i].ff_gain = 0;
+    }
+    fan_control_t with_ff, without_ff;
+    sim_t sim_ff = { .temp = SIM_AMBIENT };
+    sim_t sim_pi = { .temp = SIM_AMBIENT };
+
+    init_shipped(&with_ff);
+    init(&without_ff, feedback_only, fan_control_schedule_count);
+    sim_run(&sim_ff, &with_ff, 14, 1000);
+    sim_run(&sim_pi, &without_ff, 14, 1000);
+
+    // A higher frequency or a pool reconnect steps the power up
+    sim_run(&sim_ff, &with_ff, 20, 300);
+    sim_run(&sim_pi, &without_ff, 20, 300);
+
+    float overshoot_ff = sim_ff.max_temp - SETPOINT;
+    float overshoot_pi = sim_pi.max_temp - SETPOINT;
+
+    TEST_ASSERT_LESS_THAN(overshoot_pi / 2, overshoot_ff);
+    TEST_ASSERT_LESS_THAN(1.5f, overshoot_ff);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, SETPOINT, sim_ff.temp);
+
+    // And back down without undershooting much
+    sim_run(&sim_ff, &with_ff, 14, 300);
+    TEST_ASSERT_GREATER_THAN(SETPOINT - 1.5f, sim_ff.min_temp);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, SETPOINT, sim_ff.temp);
+}
+
+TEST_CASE("Fan control does not wind up at the minimum speed", "[fan_control]")
+{
+    fan_control_t fan_control;
+    sim_t sim = { .temp = SIM_AMBIENT };
+
+    init_shipped(&fan_control);
+
+    // Too little power to reach the setpoint, the fan stays at its minimum
+    sim_run(&sim, &fan_control, 3, 1000);
+    TEST_ASSERT_EQUAL_FLOAT(25, fan_control.output);
+    TEST_ASSERT_LESS_THAN(SETPOINT, sim.temp);
+
+    // A wound up integral would hold the fan at the minimum far too long
+    sim_run(&sim, &fan_control, 20, 1000);
+    TEST_ASSERT_LESS_THAN(SETPOINT + 5.0f, sim.max_temp);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, SETPOINT, sim.temp);
+}
+
+TEST_CASE("Fan control interpolates the gain schedule", "[fan_control]")
+{
+    fan_control_t fan_control;
+    init_shipped(&fan_control);
+
+    fan_control_gains_t gains = fan_control_get_gains(&fan_control, 20);
+    TEST_ASSERT_EQUAL_FLOAT(5.0f, gains.kp);
+    TEST_ASSERT_EQUAL_FLOAT(0.25f, gains.ki);
+    TEST_ASSERT_EQUAL_FLOAT(3.25f, gains.ff_gain);
+
+    gains = fan_control_get_gains(&fan_control, 65);
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, gains.kp);
+    TEST_ASSERT_EQUAL_FLOAT(0.175f, gains.ki);
+    TEST_ASSERT_EQUAL_FLOAT(1.75f, gains.ff_gain);
+
+    gains = fan_control_get_gains(&fan_control, 5);
+    TEST_ASSERT_EQUAL_FLOAT(6.0f, gains.kp);
+
+    gains = fan_control_get_gains(&fan_control, 150);
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, gains.kp);
+}
@@ -0,0 +1,97 @@
+#ifndef MINING_TRACE_H_
+#define MINING_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MINING_TRACE_BUCKET_COUNT 14
+
+// Defined in global_state.h of main
+typedef struct GlobalState GlobalState;
+
+// Trace points, a notify and a nonce each carry their own correlation id
+typedef enum {
+    TRACE_NOTIFY_RECEIVED = 0,   // line read from the socket
+    TRACE_NOTIFY_PARSED,
+    TRACE_JOB_BUILT,             // first job of a notify
+    TRACE_JOB_SENT,              // first job of a notify on the UART
+    TRACE_RESULT_RECEIVED,       // nonce read from the UART
+    TRACE_RESULT_VERIFIED,
+    TRACE_SHARE_SENT,
+    TRACE_SHARE_ACKNOWLEDGED,
+    TRACE_POINT_COUNT,
+} trace_point_t;
+
+typedef enum {
+    TRACE_SPAN_NOTIFY_PARSE = 0, // received to parsed
+    TRACE_SPAN_NOTIFY_TO_JOB,    // received to first job built
+    TRACE_SPAN_JOB_TO_UART,      // first job built to sent
+    TRACE_SPAN_NOTIFY_TO_UART,   // received to first job sent
+    TRACE_SPAN_RESULT_VERIFY,    // received to verified
+    TRACE_SPAN_RESULT_TO_WIRE,   // received to share sent
+    TRACE_SPAN_SHARE_ACK,        // share sent to acknowledged
+    TRACE_SPAN_COUNT,
+} trace_span_t;
+
+typedef struct {
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+    uint32_t buckets[MINING_TRACE_BUCKET_COUNT]; // not cumulative, the last one is unbounded
+} TraceSpanStats;
+
+typedef struct {
+    int64_t time_us;
+    uint32_t id;
+    trace_point_t point;
+} TraceEvent;
+
+// Upper bounds of all but the last bucket
+extern const uint32_t mining_trace_bucket_bounds_us[MINING_TRACE_BUCKET_COUNT - 1];
+
+/**
+ * @brief Allocate the raw event ring, in PSRAM when there is some.
+ *
+ * The histograms work without it.
+ */
+void mining_trace_init(GlobalState * GLOBAL_STATE);
+
+/**
+ * @brief Start the trace of a notify.
+ *
+ * @param received_us when the line was read, before parsing
+ * @return correlation id of the notify and its jobs
+ */
+uint32_t mining_trace_notify_received(int64_t received_us);
+void mining_trace_notify_parsed(uint32_t notify_id);
+void mining_trace_job_built(uint32_t notify_id);
+void mining_trace_job_sent(uint32_t notify_id);
+
+/**
+ * @brief Start the trace of a nonce.
+ *
+ * @return correlation id of the nonce and its share
+ */
+uint32_t mining_trace_result_received(int64_t received_us);
+void mining_trace_result_verified(uint32_t result_id);
+void mining_trace_share_sent(uint32_t result_id, int message_id);
+void mining_trace_share_acknowledged(int message_id);
+
+void mining_trace_get_span(trace_span_t span, TraceSpanStats * stats);
+const char * mining_trace_span_name(trace_span_t span);
+const char * mining_trace_point_name(trace_point_t point);
+
+/**
+ * @brief Get the range of raw events still in the ring.
+ *
+ * @param first sequence number of the oldest event
+ * @return sequence number after the newest event, equal to first when tracing is off
+ */
+uint32_t mining_trace_event_range(uint32_t * first);
+
+/**
+ * @return false when the event was overwritten meanwhile
+ */
+bool mining_trace_get_event(uint32_t sequence, TraceEvent * event);
+
+#endif /* MINING_TRACE_H_ */
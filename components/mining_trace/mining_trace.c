@@ -0,0 +1,273 @@
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "global_state.h"
+#include "mining_trace.h"
+
+// Raw events kept for the trace download
+#define TRACE_EVENTS 256
+#define TRACE_PSRAM_EVENTS 8192
+
+// Notifies and shares in flight, older ones are overwritten
+#define TRACE_NOTIFY_SLOTS 8
+#define TRACE_SHARE_SLOTS 16
+
+static const char * TAG = "mining_trace";
+
+const uint32_t mining_trace_bucket_bounds_us[MINING_TRACE_BUCKET_COUNT - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000,
+};
+
+static const char * point_names[TRACE_POINT_COUNT] = {
+    [TRACE_NOTIFY_RECEIVED] = "notify received",
+    [TRACE_NOTIFY_PARSED] = "notify parsed",
+    [TRACE_JOB_BUILT] = "job built",
+    [TRACE_JOB_SENT] = "job sent",
+    [TRACE_RESULT_RECEIVED] = "result received",
+    [TRACE_RESULT_VERIFIED] = "result verified",
+    [TRACE_SHARE_SENT] = "share sent",
+    [TRACE_SHARE_ACKNOWLEDGED] = "share acknowledged",
+};
+
+static const char * span_names[TRACE_SPAN_COUNT] = {
+    [TRACE_SPAN_NOTIFY_PARSE] = "notifyParse",
+    [TRACE_SPAN_NOTIFY_TO_JOB] = "notifyToJob",
+    [TRACE_SPAN_JOB_TO_UART] = "jobToUart",
+    [TRACE_SPAN_NOTIFY_TO_UART] = "notifyToUart",
+    [TRACE_SPAN_RESULT_VERIFY] = "resultVerify",
+    [TRACE_SPAN_RESULT_TO_WIRE] = "resultToWire",
+    [TRACE_SPAN_SHARE_ACK] = "shareAck",
+};
+
+typedef struct {
+    uint32_t id;
+    int64_t received_us;
+    int64_t built_us;            // 0 until the first job is built
+    bool sent;
+} NotifyTrace;
+
+typedef struct {
+    int message_id;              // -1 when free
+    uint32_t result_id;
+    int64_t sent_us;
+} ShareTrace;
+
+// Trace points come from the stratum, job, ASIC and result tasks on both cores
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TraceSpanStats spans[TRACE_SPAN_COUNT];
+
+static NotifyTrace notifies[TRACE_NOTIFY_SLOTS];
+static uint32_t notify_sequence;
+
+// The result task handles one nonce at a time
+static uint32_t result_sequence;
+static int64_t result_received_us;
+
+static ShareTrace shares[TRACE_SHARE_SLOTS];
+
+static TraceEvent * events;
+static uint32_t event_capacity;
+static uint32_t event_head;
+
+void mining_trace_init(GlobalState * GLOBAL_STATE)
+{
+    for (int i = 0; i < TRACE_SHARE_SLOTS; i++) {
+        shares[i].message_id = -1;
+    }
+
+    uint32_t capacity = GLOBAL_STATE->psram_is_available ? TRACE_PSRAM_EVENTS : TRACE_EVENTS;
+    uint32_t caps = GLOBAL_STATE->psram_is_available ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL;
+    TraceEvent * buffer = heap_caps_malloc(capacity * sizeof(TraceEvent), caps | MALLOC_CAP_8BIT);
+    if (buffer == NULL) {
+        ESP_LOGW(TAG, "No memory for the trace events, keeping the histograms only");
+        return;
+    }
+
+    portENTER_CRITICAL(&trace_lock);
+    events = buffer;
+    event_capacity = capacity;
+    portEXIT_CRITICAL(&trace_lock);
+
+    ESP_LOGI(TAG, "Keeping %lu trace events", capacity);
+}
+
+// Called with trace_lock held
+static void record(trace_point_t point, uint32_t id, int64_t time_us)
+{
+    if (events == NULL) {
+        return;
+    }
+    events[event_head % event_capacity] = (TraceEvent) { .time_us = time_us, .id = id, .point = point };
+    event_head++;
+}
+
+// Called with trace_lock held
+static void span_add(trace_span_t span, int64_t duration_us)
+{
+    if (duration_us < 0) {
+        return;
+    }
+
+    TraceSpanStats * stats = &spans[span];
+    int bucket = 0;
+    while (bucket < MINING_TRACE_BUCKET_COUNT - 1 && duration_us > mining_trace_bucket_bounds_us[bucket]) {
+        bucket++;
+    }
+    stats->buckets[bucket]++;
+    stats->count++;
+    stats->sum_us += duration_us;
+    if (duration_us > stats->max_us) {
+        stats->max_us = duration_us > UINT32_MAX ? UINT32_MAX : duration_us;
+    }
+}
+
+uint32_t mining_trace_notify_received(int64_t received_us)
+{
+    portENTER_CRITICAL(&trace_lock);
+    uint32_t id = ++notify_sequence;
+    notifies[id % TRACE_NOTIFY_SLOTS] = (NotifyTrace) { .id = id, .received_us = received_us };
+    record(TRACE_NOTIFY_RECEIVED, id, received_us);
+    portEXIT_CRITICAL(&trace_lock);
+    return id;
+}
+
+void mining_trace_notify_parsed(uint32_t notify_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    NotifyTrace * notify = &notifies[notify_id % TRACE_NOTIFY_SLOTS];
+    if (notify->id == notify_id) {
+        span_add(TRACE_SPAN_NOTIFY_PARSE, now - notify->received_us);
+        record(TRACE_NOTIFY_PARSED, notify_id, now);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void mining_trace_job_built(uint32_t notify_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    NotifyTrace * notify = &notifies[notify_id % TRACE_NOTIFY_SLOTS];
+    if (notify->id == notify_id && notify->built_us == 0) {
+        notify->built_us = now;
+        span_add(TRACE_SPAN_NOTIFY_TO_JOB, now - notify->received_us);
+        record(TRACE_JOB_BUILT, notify_id, now);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void mining_trace_job_sent(uint32_t notify_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    NotifyTrace * notify = &notifies[notify_id % TRACE_NOTIFY_SLOTS];
+    if (notify->id == notify_id && notify->built_us != 0 && !notify->sent) {
+        notify->sent = true;
+        span_add(TRACE_SPAN_JOB_TO_UART, now - notify->built_us);
+        span_add(TRACE_SPAN_NOTIFY_TO_UART, now - notify->received_us);
+        record(TRACE_JOB_SENT, notify_id, now);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+uint32_t mining_trace_result_received(int64_t received_us)
+{
+    portENTER_CRITICAL(&trace_lock);
+    uint32_t id = ++result_sequence;
+    result_received_us = received_us;
+    record(TRACE_RESULT_RECEIVED, id, received_us);
+    portEXIT_CRITICAL(&trace_lock);
+    return id;
+}
+
+void mining_trace_result_verified(uint32_t result_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    if (result_id == result_sequence) {
+        span_add(TRACE_SPAN_RESULT_VERIFY, now - result_received_us);
+        record(TRACE_RESULT_VERIFIED, result_id, now);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void mining_trace_share_sent(uint32_t result_id, int message_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (message_id < 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&trace_lock);
+    if (result_id == result_sequence) {
+        shares[message_id % TRACE_SHARE_SLOTS] = (ShareTrace) { .message_id = message_id, .result_id = result_id, .sent_us = now };
+        span_add(TRACE_SPAN_RESULT_TO_WIRE, now - result_received_us);
+        record(TRACE_SHARE_SENT, result_id, now);
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void mining_trace_share_acknowledged(int message_id)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (message_id < 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&trace_lock);
+    ShareTrace * share = &shares[message_id % TRACE_SHARE_SLOTS];
+    if (share->message_id == message_id) {
+        span_add(TRACE_SPAN_SHARE_ACK, now - share->sent_us);
+        record(TRACE_SHARE_ACKNOWLEDGED, share->result_id, now);
+        share->message_id = -1;
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void mining_trace_get_span(trace_span_t span, TraceSpanStats * stats)
+{
+    portENTER_CRITICAL(&trace_lock);
+    *stats = spans[span];
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+const char * mining_trace_span_name(trace_span_t span)
+{
+    return span < TRACE_SPAN_COUNT ? span_names[span] : "unknown";
+}
+
+const char * mining_trace_point_name(trace_point_t point)
+{
+    return point < TRACE_POINT_COUNT ? point_names[point] : "unknown";
+}
+
+uint32_t mining_trace_event_range(uint32_t * first)
+{
+    portENTER_CRITICAL(&trace_lock);
+    uint32_t head = event_head;
+    *first = head > event_capacity ? head - event_capacity : 0;
+    portEXIT_CRITICAL(&trace_lock);
+    return head;
+}
+
+bool mining_trace_get_event(uint32_t sequence, TraceEvent * event)
+{
+    bool valid;
+
+    portENTER_CRITICAL(&trace_lock);
+    valid = events != NULL && sequence < event_head && event_head - sequence <= event_capacity;
+    if (valid) {
+        *event = events[sequence % event_capacity];
+    }
+    portEXIT_CRITICAL(&trace_lock);
+    return valid;
+}
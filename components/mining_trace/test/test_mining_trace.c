@@ -0,0 +1,130 @@
+#include "unity.h"
+#include "esp_timer.h"
+#include "mining_trace.h"
+
+// More than the notifies and shares kept in flight, so older ids are forgotten
+#define NEWER_IN_FLIGHT 64
+
+static TraceSpanStats get_span(trace_span_t span)
+{
+    TraceSpanStats stats;
+    mining_trace_get_span(span, &stats);
+    return stats;
+}
+
+static uint32_t span_count(trace_span_t span)
+{
+    return get_span(span).count;
+}
+
+TEST_CASE("Span durations land in the bucket of their upper bound", "[mining_trace]")
+{
+    const struct {
+        int64_t duration_us;
+        int bucket;
+    } cases[] = {
+        { 50, 0 },                                       // up to 100 us
+        { 3000, 5 },                                     // 2.5 to 5 ms
+        { 40000, 8 },                                    // 25 to 50 ms
+        { 2000000, MINING_TRACE_BUCKET_COUNT - 1 },      // above 1 s
+    };
+
+    for (int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        TraceSpanStats before = get_span(TRACE_SPAN_NOTIFY_PARSE);
+
+        uint32_t id = mining_trace_notify_received(esp_timer_get_time() - cases[i].duration_us);
+        mining_trace_notify_parsed(id);
+
+        TraceSpanStats after = get_span(TRACE_SPAN_NOTIFY_PARSE);
+        TEST_ASSERT_EQUAL_UINT32(before.count + 1, after.count);
+        TEST_ASSERT_EQUAL_UINT32(before.buckets[cases[i].bucket] + 1, after.buckets[cases[i].bucket]);
+        TEST_ASSERT_TRUE(after.sum_us - before.sum_us >= cases[i].duration_us);
+    }
+}
+
+TEST_CASE("Spans with a negative duration are dropped", "[mining_trace]")
+{
+    uint32_t count = span_count(TRACE_SPAN_NOTIFY_PARSE);
+
+    uint32_t id = mining_trace_notify_received(esp_timer_get_time() + 1000000);
+    mining_trace_notify_parsed(id);
+
+    TEST_ASSERT_EQUAL_UINT32(count, span_count(TRACE_SPAN_NOTIFY_PARSE));
+}
+
+TEST_CASE("Notify stages are matched by the id of the notify", "[mining_trace]")
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t stale = mining_trace_notify_received(now);
+    uint32_t id = 0;
+    for (int i = 0; i < NEWER_IN_FLIGHT; i++) {
+        id = mining_trace_notify_received(now);
+    }
+
+    uint32_t parsed = span_count(TRACE_SPAN_NOTIFY_PARSE);
+    mining_trace_notify_parsed(stale);
+    TEST_ASSERT_EQUAL_UINT32(parsed, span_count(TRACE_SPAN_NOTIFY_PARSE));
+
+    // A job is only sent after it was built, and only the first job of a notify counts
+    uint32_t built = span_count(TRACE_SPAN_NOTIFY_TO_JOB);
+    uint32_t sent = span_count(TRACE_SPAN_JOB_TO_UART);
+    uint32_t notify_to_uart = span_count(TRACE_SPAN_NOTIFY_TO_UART);
+
+    mining_trace_job_sent(id);
+    TEST_ASSERT_EQUAL_UINT32(sent, span_count(TRACE_SPAN_JOB_TO_UART));
+
+    mining_trace_job_built(id);
+    mining_trace_job_built(id);
+    TEST_ASSERT_EQUAL_UINT32(built + 1, span_count(TRACE_SPAN_NOTIFY_TO_JOB));
+
+    mining_trace_job_sent(id);
+    mining_trace_job_sent(id);
+    TEST_ASSERT_EQUAL_UINT32(sent + 1, span_count(TRACE_SPAN_JOB_TO_UART));
+    TEST_ASSERT_EQUAL_UINT32(notify_to_uart + 1, span_count(TRACE_SPAN_NOTIFY_TO_UART));
+}
+
+TEST_CASE("Shares are matched to their nonce and acknowledged once", "[mining_trace]")
+{
+    uint32_t verified = span_count(TRACE_SPAN_RESULT_VERIFY);
+    uint32_t to_wire = span_count(TRACE_SPAN_RESULT_TO_WIRE);
+    uint32_t acknowledged = span_count(TRACE_SPAN_SHARE_ACK);
+
+    uint32_t id = mining_trace_result_received(esp_timer_get_time() - 3000);
+    mining_trace_result_verified(id);
+    mining_trace_share_sent(id, 1000);
+    TEST_ASSERT_EQUAL_UINT32(verified + 1, span_count(TRACE_SPAN_RESULT_VERIFY));
+    TEST_ASSERT_EQUAL_UINT32(to_wire + 1, span_count(TRACE_SPAN_RESULT_TO_WIRE));
+
+    mining_trace_share_acknowledged(1001);
+    TEST_ASSERT_EQUAL_UINT32(acknowledged, span_count(TRACE_SPAN_SHARE_ACK));
+
+    mining_trace_share_acknowledged(1000);
+    mining_trace_share_acknowledged(1000);
+    TEST_ASSERT_EQUAL_UINT32(acknowledged + 1, span_count(TRACE_SPAN_SHARE_ACK));
+
+    // The result task moved on to the next nonce
+    uint32_t stale = mining_trace_result_received(esp_timer_get_time());
+    mining_trace_result_received(esp_timer_get_time());
+    mining_trace_result_verified(stale);
+    mining_trace_share_sent(stale, 1002);
+    mining_trace_share_acknowledged(1002);
+    TEST_ASSERT_EQUAL_UINT32(verified + 1, span_count(TRACE_SPAN_RESULT_VERIFY));
+    TEST_ASSERT_EQUAL_UINT32(to_wire + 1, span_count(TRACE_SPAN_RESULT_TO_WIRE));
+    TEST_ASSERT_EQUAL_UINT32(acknowledged + 1, span_count(TRACE_SPAN_SHARE_ACK));
+}
+
+TEST_CASE("Acknowledgements of forgotten shares are ignored", "[mining_trace]")
+{
+    uint32_t id = mining_trace_result_received(esp_timer_get_time());
+    mining_trace_share_sent(id, 2000);
+    for (int i = 1; i <= NEWER_IN_FLIGHT; i++) {
+        mining_trace_share_sent(id, 2000 + i);
+    }
+
+    uint32_t acknowledged = span_count(TRACE_SPAN_SHARE_ACK);
+    mining_trace_share_acknowledged(2000);
+    TEST_ASSERT_EQUAL_UINT32(acknowledged, span_count(TRACE_SPAN_SHARE_ACK));
+
+    mining_trace_share_acknowledged(2000 + NEWER_IN_FLIGHT);
+    TEST_ASSERT_EQUAL_UINT32(acknowledged + 1, span_count(TRACE_SPAN_SHARE_ACK));
+}
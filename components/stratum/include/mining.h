@@ -23,6 +23,7 @@ typedef struct
     uint32_t pool_diff;
     char *jobid;
     char *extranonce2;
+    uint32_t trace_id;      // of the notify the job was built from
 } bm_job;
 
 void free_bm_job(bm_job *job);
@@ -42,6 +42,7 @@ typedef struct
     uint32_t version;
     uint32_t target;
     uint32_t ntime;
+    uint32_t trace_id;         // correlates the latency trace points of the notify and its jobs
 } mining_notify;
 
 typedef struct
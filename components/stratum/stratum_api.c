@@ -11,6 +11,7 @@
 #include "lwip/sockets.h"
 #include "utils.h"
 #include "esp_timer.h"
+#include "event_log.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -155,7 +156,10 @@ char * STRATUM_V1_receive_jsonrpc_line(int sockfd)
 
 void STRATUM_V1_parse(StratumApiV1Message * message, const char * stratum_json)
 {
-    ESP_LOGI(TAG, "rx: %s", stratum_json); // debug incoming stratum messages
+    // debug incoming stratum messages, the whole message only with the stratum_api tag at debug level
+    if (event_log_get_level(EVENT_SUBSYSTEM_STRATUM) >= ESP_LOG_DEBUG) {
+        ESP_LOGI(TAG, "rx: %s", stratum_json);
+    }
 
     cJSON * json = cJSON_Parse(stratum_json);
 
@@ -276,6 +280,7 @@ void STRATUM_V1_parse(StratumApiV1Message * message, const char * stratum_json)
     }
 
     message->method = result;
+    EVENT_LOG(EVENT_STRATUM_RX, (uint32_t) parsed_id, result);
 
     if (message->method == MINING_NOTIFY) {
 
@@ -19,6 +19,9 @@
 #include "bap.h"
 #include "asic.h"
 
+// Longest wait for a frequency ramp before the change is reported as timed out
+#define BAP_FREQUENCY_RAMP_TIMEOUT_MS 10000
+
 static const char *TAG = "BAP_HANDLERS";
 
 static bap_command_handler_t handlers[BAP_CMD_UNKNOWN + 1] = {0};
@@ -285,12 +288,11 @@ void BAP_handle_settings(const char *parameter, const char *value) {
                 
                 //ESP_LOGI(TAG, "Setting ASIC frequency to %.2f MHz", target_frequency);
                 
-                bool success = ASIC_set_frequency(bap_global_state, target_frequency);
+                bool success = FREQUENCY_RAMP_set(bap_global_state, target_frequency, BAP_FREQUENCY_RAMP_TIMEOUT_MS);
                 
                 if (success) {
                     //ESP_LOGI(TAG, "Frequency successfully set to %.2f MHz", target_frequency);
                     
-                    bap_global_state->POWER_MANAGEMENT_MODULE.frequency_value = target_frequency;
                     nvs_config_set_u16(NVS_CONFIG_ASIC_FREQUENCY, target_frequency);
                     
                     char freq_str[32];
@@ -298,7 +300,7 @@ void BAP_handle_settings(const char *parameter, const char *value) {
                     BAP_send_message(BAP_CMD_ACK, parameter, freq_str);
                 } else {
                     ESP_LOGE(TAG, "Failed to set frequency to %.2f MHz", target_frequency);
-                    BAP_send_message(BAP_CMD_ERR, parameter, "set_failed");
+                    BAP_send_message(BAP_CMD_ERR, parameter, bap_global_state->FREQUENCY_RAMP_MODULE.is_ramping ? "ramp_timeout" : "set_failed");
                 }
             }
             break;
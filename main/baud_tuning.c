@@ -0,0 +1,152 @@
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "baud_tuning.h"
+#include "asic.h"
+#include "asic_reset.h"
+#include "frequency_transition_bmXX.h"
+#include "nvs_config.h"
+#include "serial.h"
+
+// Number of CHIP_ID reads that must all succeed for a baud rate to be accepted
+#define PROBE_ROUNDS 10
+
+// Runtime fallback: at least this many frames with more than 2% errors
+#define ERROR_WINDOW_FRAMES 500
+#define ERROR_THRESHOLD_PERCENT 2
+
+static const char * TAG = "baud_tuning";
+
+static uint32_t window_frames;
+static uint32_t window_errors;
+
+static bool verify_link(GlobalState * GLOBAL_STATE)
+{
+    int asic_count = GLOBAL_STATE->DEVICE_CONFIG.family.asic_count;
+
+    for (int i = 0; i < PROBE_ROUNDS; i++) {
+        int chips = ASIC_probe_chips(GLOBAL_STATE);
+        if (chips != asic_count) {
+            ESP_LOGW(TAG, "Link check failed: %d of %d chips responded", chips, asic_count);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool try_baud(GlobalState * GLOBAL_STATE, int baud)
+{
+    int actual_baud = ASIC_set_baud(GLOBAL_STATE, baud);
+    if (actual_baud == 0) {
+        return false;
+    }
+
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+    SERIAL_set_baud(actual_baud);
+
+    return verify_link(GLOBAL_STATE);
+}
+
+// The chain is unreachable at a failed baud rate, start over from the default
+static esp_err_t restart_asic(GlobalState * GLOBAL_STATE)
+{
+    SERIAL_set_baud(115200);
+
+    esp_err_t ret = asic_reset();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    reset_frequency_transition();
+
+    if (ASIC_init(GLOBAL_STATE) == 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+int BAUD_tune(GlobalState * GLOBAL_STATE)
+{
+    const uint32_t * baud_options = GLOBAL_STATE->DEVICE_CONFIG.family.asic.baud_options;
+    int32_t baud_ceiling = nvs_config_get_i32(NVS_CONFIG_ASIC_BAUD, 0);
+
+    int baud = baud_options[0];
+
+    for (int i = 1; baud_options[i] != 0; i++) {
+        if (baud_ceiling > 0 && baud_options[i] > baud_ceiling) {
+            break;
+        }
+
+        if (try_baud(GLOBAL_STATE, baud_options[i])) {
+            baud = baud_options[i];
+            continue;
+        }
+
+        ESP_LOGW(TAG, "%lu baud failed, falling back to %d baud", baud_options[i], baud);
+
+        if (restart_asic(GLOBAL_STATE) != ESP_OK) {
+            ESP_LOGE(TAG, "ASIC restart failed");
+            return baud_options[0];
+        }
+
+        if (baud != baud_options[0] && !try_baud(GLOBAL_STATE, baud)) {
+            ESP_LOGW(TAG, "%d baud failed after restart, using default baud", baud);
+            baud = baud_options[0];
+            if (restart_asic(GLOBAL_STATE) != ESP_OK) {
+                ESP_LOGE(TAG, "ASIC restart failed");
+            }
+        }
+        break;
+    }
+
+    ESP_LOGI(TAG, "ASIC link running at %d baud", baud);
+
+    if (baud != baud_ceiling) {
+        nvs_config_set_i32(NVS_CONFIG_ASIC_BAUD, baud);
+    }
+
+    get_receive_work_stats(&window_frames, &window_errors);
+    GLOBAL_STATE->SYSTEM_MODULE.asic_baud = baud;
+
+    return baud;
+}
+
+void BAUD_check_errors(GlobalState * GLOBAL_STATE)
+{
+    uint32_t frames, errors;
+    get_receive_work_stats(&frames, &errors);
+
+    uint32_t delta_frames = frames - window_frames;
+    uint32_t delta_errors = errors - window_errors;
+
+    if (delta_frames < ERROR_WINDOW_FRAMES) {
+        return;
+    }
+
+    window_frames = frames;
+    window_errors = errors;
+
+    if (delta_errors * 100 <= delta_frames * ERROR_THRESHOLD_PERCENT) {
+        return;
+    }
+
+    const uint32_t * baud_options = GLOBAL_STATE->DEVICE_CONFIG.family.asic.baud_options;
+    int baud = GLOBAL_STATE->SYSTEM_MODULE.asic_baud;
+
+    int lower_baud = 0;
+    for (int i = 0; baud_options[i] != 0 && baud_options[i] < baud; i++) {
+        lower_baud = baud_options[i];
+    }
+
+    ESP_LOGE(TAG, "%lu of %lu ASIC frames failed at %d baud", delta_errors, delta_frames, baud);
+
+    if (lower_baud == 0) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "Lowering ASIC baud to %d and restarting", lower_baud);
+    nvs_config_set_i32(NVS_CONFIG_ASIC_BAUD, lower_baud);
+    esp_restart();
+}
@@ -0,0 +1,30 @@
+#ifndef BAUD_TUNING_H_
+#define BAUD_TUNING_H_
+
+#include "global_state.h"
+
+/**
+ * @brief Train the ASIC serial link up to the fastest verified baud rate.
+ *
+ * Steps through the baud options of the ASIC, checking every step with
+ * CHIP_ID register reads from all chips. The highest rate that passed is
+ * stored in NVS and used as the ceiling for the next boot.
+ *
+ * Must be called after ASIC_init and before the ASIC tasks are started.
+ *
+ * @param GLOBAL_STATE Global state
+ * @return The baud rate the host UART should be set to
+ */
+int BAUD_tune(GlobalState * GLOBAL_STATE);
+
+/**
+ * @brief Check the runtime receive error rate of the ASIC serial link.
+ *
+ * When the CRC/framing error rate exceeds the threshold, the stored ceiling
+ * is lowered to the next baud option and the device restarts.
+ *
+ * @param GLOBAL_STATE Global state
+ */
+void BAUD_check_errors(GlobalState * GLOBAL_STATE);
+
+#endif /* BAUD_TUNING_H_ */
@@ -8,6 +8,12 @@
 #include "power_management_task.h"
 #include "statistics_task.h"
 #include "hashrate_monitor_task.h"
+#include "core_monitor.h"
+#include "frequency_ramp_task.h"
+#include "autotune_task.h"
+#include "thermal_throttle.h"
+#include "sensor_task.h"
+#include "power_telemetry.h"
 #include "serial.h"
 #include "stratum_api.h"
 #include "work_queue.h"
@@ -20,6 +26,9 @@
 #define HISTORY_LENGTH 100
 #define DIFF_STRING_SIZE 10
 
+// Pool response time histogram, the last bucket is above all bounds
+#define RESPONSE_TIME_BUCKET_COUNT 10
+
 typedef struct {
     char message[64];
     uint32_t count;
@@ -36,6 +45,10 @@ typedef struct
     int64_t start_time;
     uint64_t shares_accepted;
     uint64_t shares_rejected;
+    uint64_t total_shares_accepted; // since the first boot
+    uint64_t total_shares_rejected;
+    uint64_t total_uptime_base;     // s before this boot
+    double total_energy;            // J since the first boot
     uint64_t work_received;
     RejectedReasonStat rejected_reason_stats[10];
     int rejected_reason_stats_count;
@@ -65,6 +78,9 @@ typedef struct
     bool pool_extranonce_subscribe;
     bool fallback_pool_extranonce_subscribe;
     double response_time;
+    uint32_t response_time_buckets[RESPONSE_TIME_BUCKET_COUNT]; // not cumulative
+    uint32_t response_time_count;
+    double response_time_sum;       // ms
     bool use_fallback_stratum;
     bool is_using_fallback;
     uint16_t overheat_mode;
@@ -75,6 +91,7 @@ typedef struct
     char firmware_update_filename[20];
     char firmware_update_status[20];
     char * asic_status;
+    int asic_baud;
 } SystemModule;
 
 typedef struct
@@ -86,7 +103,7 @@ typedef struct
     char *finished;
 } SelfTestModule;
 
-typedef struct
+typedef struct GlobalState
 {
     work_queue stratum_queue;
     work_queue ASIC_jobs_queue;
@@ -99,6 +116,12 @@ typedef struct
     SelfTestModule SELF_TEST_MODULE;
     StatisticsModule STATISTICS_MODULE;
     HashrateMonitorModule HASHRATE_MONITOR_MODULE;
+    CoreMonitorModule CORE_MONITOR_MODULE;
+    FrequencyRampModule FREQUENCY_RAMP_MODULE;
+    AutotuneModule AUTOTUNE_MODULE;
+    ThermalThrottleModule THERMAL_THROTTLE_MODULE;
+    SensorModule SENSOR_MODULE;
+    PowerTelemetryModule POWER_TELEMETRY_MODULE;
 
     char * extranonce_str;
     int extranonce_2_len;
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "cJSON.h"
+#include "global_state.h"
+#include "nvs_config.h"
+#include "autotune_task.h"
+
+static GlobalState *GLOBAL_STATE = NULL;
+
+// Function declarations from http_server.c
+extern esp_err_t is_network_allowed(httpd_req_t *req);
+extern esp_err_t set_cors_headers(httpd_req_t *req);
+
+// Initialize the autotune API with the global state
+void autotune_api_init(GlobalState *global_state) {
+    GLOBAL_STATE = global_state;
+}
+
+static cJSON * create_point(autotune_point_t point)
+{
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddNumberToObject(obj, "frequency", point.frequency);
+    cJSON_AddNumberToObject(obj, "voltage", point.voltage);
+    return obj;
+}
+
+/* Handler for system autotune status endpoint */
+esp_err_t GET_system_autotune(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+    autotune_t * autotune = &AUTOTUNE_MODULE->autotune;
+    autotune_measurement_t * measurement = &AUTOTUNE_MODULE->last_measurement;
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "supported", AUTOTUNE_is_supported(GLOBAL_STATE));
+    cJSON_AddStringToObject(root, "state", AUTOTUNE_get_state_string(autotune->state));
+    cJSON_AddStringToObject(root, "abortReason", AUTOTUNE_get_abort_reason_string(autotune->abort_reason));
+    cJSON_AddStringToObject(root, "goal", autotune->config.goal == AUTOTUNE_GOAL_HASHRATE ? "hashrate" : "efficiency");
+    cJSON_AddNumberToObject(root, "powerCap", autotune->config.power_cap);
+    cJSON_AddNumberToObject(root, "pointsMeasured", autotune->points_measured);
+
+    if (autotune->state == AUTOTUNE_STATE_RUNNING) {
+        cJSON_AddItemToObject(root, "point", create_point(autotune->progress.point));
+    }
+
+    if (autotune->points_measured > 0) {
+        cJSON *last = cJSON_CreateObject();
+        cJSON_AddNumberToObject(last, "hashrate", measurement->hashrate);
+        cJSON_AddNumberToObject(last, "errorPercentage", measurement->error_percent);
+        cJSON_AddNumberToObject(last, "power", measurement->power);
+        cJSON_AddNumberToObject(last, "chipTemp", measurement->chip_temp);
+        cJSON_AddNumberToObject(last, "vrTemp", measurement->vr_temp);
+        cJSON_AddItemToObject(root, "lastMeasurement", last);
+    }
+
+    if (autotune->progress.has_best) {
+        cJSON *best = create_point(autotune->progress.best);
+        cJSON_AddNumberToObject(best, "hashrate", autotune->progress.best_hashrate);
+        cJSON_AddNumberToObject(best, "power", autotune->progress.best_power);
+        cJSON_AddNumberToObject(best, "efficiency", autotune_efficiency(autotune->progress.best_power, autotune->progress.best_hashrate));
+        cJSON_AddItemToObject(root, "best", best);
+    }
+
+    // Result of the last finished search on this board
+    char * result = nvs_config_get_string(NVS_CONFIG_AUTOTUNE_RESULT, "");
+    autotune_point_t point;
+    unsigned int voltage;
+    float hashrate, power;
+    if (sscanf(result, "%f,%u,%f,%f", &point.frequency, &voltage, &hashrate, &power) == 4) {
+        point.voltage = voltage;
+        cJSON *saved = create_point(point);
+        cJSON_AddNumberToObject(saved, "hashrate", hashrate);
+        cJSON_AddNumberToObject(saved, "power", power);
+        cJSON_AddNumberToObject(saved, "efficiency", autotune_efficiency(power, hashrate));
+        cJSON_AddItemToObject(root, "result", saved);
+    }
+    free(result);
+
+    const char *response = cJSON_PrintUnformatted(root);
+    httpd_resp_sendstr(req, response);
+
+    free((void *)response);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+/* Handler for starting and aborting a search */
+esp_err_t POST_system_autotune(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    char buf[128];
+    int total_len = req->content_len;
+    int cur_len = 0;
+    if (total_len >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "content too long");
+        return ESP_OK;
+    }
+    while (cur_len < total_len) {
+        int received = httpd_req_recv(req, buf + cur_len, total_len - cur_len);
+        if (received <= 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to post autotune action");
+            return ESP_OK;
+        }
+        cur_len += received;
+    }
+    buf[total_len] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_OK;
+    }
+
+    const cJSON *action = cJSON_GetObjectItem(root, "action");
+    const cJSON *goal = cJSON_GetObjectItem(root, "goal");
+    const cJSON *power_cap = cJSON_GetObjectItem(root, "powerCap");
+
+    if (!cJSON_IsString(action)
+        || (goal != NULL && !cJSON_IsString(goal))
+        || (power_cap != NULL && (!cJSON_IsNumber(power_cap) || power_cap->valuedouble < 0))) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Wrong API input");
+        return ESP_OK;
+    }
+
+    if (strcmp(action->valuestring, "start") == 0) {
+        if (!AUTOTUNE_is_supported(GLOBAL_STATE)) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Autotune not supported for this ASIC");
+            return ESP_OK;
+        }
+        if (GLOBAL_STATE->AUTOTUNE_MODULE.autotune.state == AUTOTUNE_STATE_RUNNING) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Autotune already running");
+            return ESP_OK;
+        }
+        autotune_goal_t autotune_goal = goal != NULL && strcmp(goal->valuestring, "hashrate") == 0
+            ? AUTOTUNE_GOAL_HASHRATE
+            : AUTOTUNE_GOAL_EFFICIENCY;
+        AUTOTUNE_start(GLOBAL_STATE, autotune_goal, power_cap != NULL ? power_cap->valuedouble : 0);
+    } else if (strcmp(action->valuestring, "abort") == 0) {
+        AUTOTUNE_abort(GLOBAL_STATE);
+    } else {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Wrong API input");
+        return ESP_OK;
+    }
+
+    cJSON_Delete(root);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
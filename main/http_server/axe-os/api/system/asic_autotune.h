@@ -0,0 +1,16 @@
+#ifndef ASIC_API_AUTOTUNE_H_
+#define ASIC_API_AUTOTUNE_H_
+
+#include <esp_http_server.h>
+#include "global_state.h"
+
+// Function to handle GET /api/system/autotune
+esp_err_t GET_system_autotune(httpd_req_t *req);
+
+// Function to handle POST /api/system/autotune
+esp_err_t POST_system_autotune(httpd_req_t *req);
+
+// Initialize the autotune API with the global state
+void autotune_api_init(GlobalState *global_state);
+
+#endif // ASIC_API_AUTOTUNE_H_
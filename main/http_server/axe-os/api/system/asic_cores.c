@@ -0,0 +1,120 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "cJSON.h"
+#include "global_state.h"
+#include "core_monitor.h"
+
+static GlobalState *GLOBAL_STATE = NULL;
+
+// Function declarations from http_server.c
+extern esp_err_t is_network_allowed(httpd_req_t *req);
+extern esp_err_t set_cors_headers(httpd_req_t *req);
+
+// Initialize the ASIC cores API with the global state
+void asic_cores_api_init(GlobalState *global_state) {
+    GLOBAL_STATE = global_state;
+}
+
+// One hex digit per core, 8 is the expected nonce count, 0 is none and f is twice or more
+static char heat_level(uint32_t observed, double expected)
+{
+    if (expected <= 0) {
+        return '0';
+    }
+    int level = (int) (8.0 * observed / expected + 0.5);
+    if (level > 15) level = 15;
+    return "0123456789abcdef"[level];
+}
+
+/* Handler for system asic cores endpoint */
+esp_err_t GET_system_asic_cores(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    CoreMonitorModule * CORE_MONITOR_MODULE = &GLOBAL_STATE->CORE_MONITOR_MODULE;
+
+    if (!CORE_MONITOR_MODULE->is_initialized) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Core statistics not supported for this ASIC");
+    }
+
+    int core_count = CORE_MONITOR_MODULE->core_count;
+    int small_core_count = CORE_MONITOR_MODULE->small_core_count;
+
+    char * heatmap = malloc(core_count * small_core_count + 1);
+    if (heatmap == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "coreCount", core_count);
+    cJSON_AddNumberToObject(root, "smallCoreCount", small_core_count);
+
+    cJSON *asics_array = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "asics", asics_array);
+
+    for (int asic_nr = 0; asic_nr < GLOBAL_STATE->DEVICE_CONFIG.family.asic_count; asic_nr++) {
+        uint32_t asic_nonces = CORE_MONITOR_MODULE->asic_nonces[asic_nr];
+        uint32_t * core_nonces = &CORE_MONITOR_MODULE->core_nonces[asic_nr * CORE_MONITOR_MAX_CORES];
+        uint16_t * small_core_nonces = &CORE_MONITOR_MODULE->small_core_nonces[asic_nr * CORE_MONITOR_MAX_CORES * CORE_MONITOR_MAX_SMALL_CORES];
+        double expected = (double) asic_nonces / core_count;
+
+        cJSON *asic = cJSON_CreateObject();
+        cJSON_AddItemToArray(asics_array, asic);
+        cJSON_AddNumberToObject(asic, "nonces", asic_nonces);
+        cJSON_AddNumberToObject(asic, "expectedPerCore", expected);
+
+        cJSON *weak_cores = cJSON_CreateArray();
+        cJSON *dead_cores = cJSON_CreateArray();
+
+        for (int core_id = 0; core_id < core_count; core_id++) {
+            heatmap[core_id] = heat_level(core_nonces[core_id], expected);
+
+            switch (core_monitor_get_core_health(CORE_MONITOR_MODULE, asic_nr, core_id)) {
+                case CORE_HEALTH_WEAK:
+                    cJSON_AddItemToArray(weak_cores, cJSON_CreateNumber(core_id));
+                    break;
+                case CORE_HEALTH_DEAD:
+                    cJSON_AddItemToArray(dead_cores, cJSON_CreateNumber(core_id));
+                    break;
+                default:
+                    break;
+            }
+        }
+        heatmap[core_count] = '\0';
+        cJSON_AddStringToObject(asic, "cores", heatmap);
+
+        for (int core_id = 0; core_id < core_count; core_id++) {
+            double small_core_expected = (double) core_nonces[core_id] / small_core_count;
+            for (int small_core_id = 0; small_core_id < small_core_count; small_core_id++) {
+                uint16_t observed = small_core_nonces[core_id * CORE_MONITOR_MAX_SMALL_CORES + small_core_id];
+                heatmap[core_id * small_core_count + small_core_id] = heat_level(observed, small_core_expected);
+            }
+        }
+        heatmap[core_count * small_core_count] = '\0';
+        cJSON_AddStringToObject(asic, "smallCores", heatmap);
+
+        cJSON_AddItemToObject(asic, "weakCores", weak_cores);
+        cJSON_AddItemToObject(asic, "deadCores", dead_cores);
+    }
+
+    free(heatmap);
+
+    const char *response = cJSON_PrintUnformatted(root);
+    httpd_resp_sendstr(req, response);
+
+    free((void *)response);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
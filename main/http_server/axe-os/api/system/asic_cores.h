@@ -0,0 +1,13 @@
+#ifndef ASIC_API_CORES_H_
+#define ASIC_API_CORES_H_
+
+#include <esp_http_server.h>
+#include "global_state.h"
+
+// Function to handle the /api/system/asic/cores endpoint
+esp_err_t GET_system_asic_cores(httpd_req_t *req);
+
+// Initialize the ASIC cores API with the global state
+void asic_cores_api_init(GlobalState *global_state);
+
+#endif // ASIC_API_CORES_H_
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "cJSON.h"
+#include "global_state.h"
+#include "power_telemetry.h"
+
+static GlobalState *GLOBAL_STATE = NULL;
+
+// Function declarations from http_server.c
+extern esp_err_t is_network_allowed(httpd_req_t *req);
+extern esp_err_t set_cors_headers(httpd_req_t *req);
+
+// Initialize the power telemetry API with the global state
+void power_api_init(GlobalState *global_state) {
+    GLOBAL_STATE = global_state;
+}
+
+static cJSON * create_labels(void)
+{
+    cJSON *labels = cJSON_CreateArray();
+    cJSON_AddItemToArray(labels, cJSON_CreateString("timestamp"));
+    cJSON_AddItemToArray(labels, cJSON_CreateString("voltage"));
+    cJSON_AddItemToArray(labels, cJSON_CreateString("current"));
+    cJSON_AddItemToArray(labels, cJSON_CreateString("power"));
+    cJSON_AddItemToArray(labels, cJSON_CreateString("coreVoltage"));
+    return labels;
+}
+
+static void add_stat(cJSON *array, const power_stat_t *stat)
+{
+    cJSON *item = cJSON_CreateArray();
+    cJSON_AddItemToArray(item, cJSON_CreateNumber(stat->min));
+    cJSON_AddItemToArray(item, cJSON_CreateNumber(stat->mean));
+    cJSON_AddItemToArray(item, cJSON_CreateNumber(stat->max));
+    cJSON_AddItemToArray(array, item);
+}
+
+static cJSON * create_summary(void)
+{
+    power_summary_t *summaries = malloc(sizeof(power_summary_t) * POWER_TELEMETRY_SUMMARY_SIZE);
+    if (summaries == NULL) {
+        return NULL;
+    }
+    int count = Power_telemetry_get_summaries(GLOBAL_STATE, summaries, POWER_TELEMETRY_SUMMARY_SIZE);
+
+    cJSON *summary = cJSON_CreateObject();
+    cJSON_AddNumberToObject(summary, "periodMs", POWER_TELEMETRY_PERIOD_MS * POWER_TELEMETRY_DECIMATION);
+    cJSON_AddItemToObject(summary, "labels", create_labels());
+
+    // Every value is [min, mean, max] over the period
+    cJSON *data = cJSON_AddArrayToObject(summary, "data");
+    for (int i = 0; i < count; i++) {
+        cJSON *row = cJSON_CreateArray();
+        cJSON_AddItemToArray(row, cJSON_CreateNumber(summaries[i].time_ms));
+        add_stat(row, &summaries[i].input_voltage);
+        add_stat(row, &summaries[i].current);
+        add_stat(row, &summaries[i].power);
+        add_stat(row, &summaries[i].core_voltage);
+        cJSON_AddItemToArray(data, row);
+    }
+
+    free(summaries);
+    return summary;
+}
+
+static cJSON * create_capture(void)
+{
+    power_capture_t *capture = malloc(sizeof(power_capture_t));
+    if (capture == NULL || !Power_telemetry_get_capture(GLOBAL_STATE, capture)) {
+        free(capture);
+        return NULL;
+    }
+
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddStringToObject(obj, "trigger", Power_telemetry_get_trigger_string(capture->trigger));
+    cJSON_AddNumberToObject(obj, "triggerTimestamp", capture->trigger_time_ms);
+    cJSON_AddNumberToObject(obj, "triggerIndex", capture->trigger_index);
+    cJSON_AddItemToObject(obj, "labels", create_labels());
+
+    cJSON *data = cJSON_AddArrayToObject(obj, "data");
+    for (int i = 0; i < capture->count; i++) {
+        const power_sample_t *sample = &capture->samples[i];
+        cJSON *row = cJSON_CreateArray();
+        cJSON_AddItemToArray(row, cJSON_CreateNumber(sample->time_ms));
+        cJSON_AddItemToArray(row, cJSON_CreateNumber(sample->input_voltage));
+        cJSON_AddItemToArray(row, cJSON_CreateNumber(sample->current));
+        cJSON_AddItemToArray(row, cJSON_CreateNumber(sample->power));
+        cJSON_AddItemToArray(row, cJSON_CreateNumber(sample->core_voltage));
+        cJSON_AddItemToArray(data, row);
+    }
+
+    free(capture);
+    return obj;
+}
+
+/* Handler for the power telemetry endpoint */
+esp_err_t GET_system_power(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "samplePeriodMs", POWER_TELEMETRY_PERIOD_MS);
+    cJSON_AddStringToObject(root, "captureState", Power_telemetry_get_capture_state_string(GLOBAL_STATE->POWER_TELEMETRY_MODULE.capture_state));
+
+    cJSON *summary = create_summary();
+    if (summary != NULL) {
+        cJSON_AddItemToObject(root, "summary", summary);
+    }
+
+    cJSON *capture = create_capture();
+    if (capture != NULL) {
+        cJSON_AddItemToObject(root, "capture", capture);
+    }
+
+    const char *response = cJSON_PrintUnformatted(root);
+    httpd_resp_sendstr(req, response);
+
+    free((void *)response);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+/* Handler for capturing a window on request */
+esp_err_t POST_system_power_capture(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    if (GLOBAL_STATE->POWER_TELEMETRY_MODULE.capture_state == POWER_CAPTURE_RECORDING) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Capture already recording");
+        return ESP_OK;
+    }
+
+    Power_telemetry_trigger(GLOBAL_STATE, POWER_TRIGGER_MANUAL);
+
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
@@ -0,0 +1,16 @@
+#ifndef ASIC_API_POWER_H_
+#define ASIC_API_POWER_H_
+
+#include <esp_http_server.h>
+#include "global_state.h"
+
+// Function to handle GET /api/system/power
+esp_err_t GET_system_power(httpd_req_t *req);
+
+// Function to handle POST /api/system/power/capture
+esp_err_t POST_system_power_capture(httpd_req_t *req);
+
+// Initialize the power telemetry API with the global state
+void power_api_init(GlobalState *global_state);
+
+#endif // ASIC_API_POWER_H_
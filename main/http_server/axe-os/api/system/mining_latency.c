@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+#include "cJSON.h"
+#include "chunk_writer.h"
+#include "mining_trace.h"
+#include "mining_latency.h"
+
+// Function declarations from http_server.c
+extern esp_err_t is_network_allowed(httpd_req_t *req);
+extern esp_err_t set_cors_headers(httpd_req_t *req);
+
+/* Handler for system latency endpoint */
+esp_err_t GET_system_latency(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON *bounds = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "bucketBoundsUs", bounds);
+    for (int i = 0; i < MINING_TRACE_BUCKET_COUNT - 1; i++) {
+        cJSON_AddItemToArray(bounds, cJSON_CreateNumber(mining_trace_bucket_bounds_us[i]));
+    }
+
+    cJSON *spans = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "spans", spans);
+    for (trace_span_t span = 0; span < TRACE_SPAN_COUNT; span++) {
+        TraceSpanStats stats;
+        mining_trace_get_span(span, &stats);
+
+        cJSON *span_json = cJSON_CreateObject();
+        cJSON_AddItemToObject(spans, mining_trace_span_name(span), span_json);
+        cJSON_AddNumberToObject(span_json, "count", stats.count);
+        cJSON_AddNumberToObject(span_json, "meanUs", stats.count > 0 ? (double) stats.sum_us / stats.count : 0);
+        cJSON_AddNumberToObject(span_json, "maxUs", stats.max_us);
+
+        cJSON *buckets = cJSON_CreateArray();
+        cJSON_AddItemToObject(span_json, "buckets", buckets);
+        for (int i = 0; i < MINING_TRACE_BUCKET_COUNT; i++) {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(stats.buckets[i]));
+        }
+    }
+
+    const char *response = cJSON_PrintUnformatted(root);
+    httpd_resp_sendstr(req, response);
+
+    free((void *)response);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+// Notifies and nonces on separate rows of the viewer
+static int trace_row(trace_point_t point)
+{
+    return point < TRACE_RESULT_RECEIVED ? 1 : 2;
+}
+
+static const char * trace_category(trace_point_t point)
+{
+    return point < TRACE_RESULT_RECEIVED ? "notify" : "nonce";
+}
+
+// Last point seen of the recent notifies and nonces, to join consecutive points into slices
+#define TRACE_CHAINS 32
+
+typedef struct {
+    uint32_t id;
+    int64_t time_us;
+    bool valid;
+} TraceChain;
+
+// Only used from the HTTP server task
+static TraceChain trace_chains[2][TRACE_CHAINS];
+/* Handler for the raw trace, in the Trace Event Format of chrome://tracing and Perfetto */
+esp_err_t GET_system_latency_trace(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    uint32_t first;
+    uint32_t end = mining_trace_event_range(&first);
+    if (first == end) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No trace events recorded");
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"bitaxe-trace.json\"");
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    ChunkWriter writer = { .req = req };
+
+    chunk_printf(&writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+                          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"notify\"}},"
+                          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"nonce\"}}");
+
+    memset(trace_chains, 0, sizeof(trace_chains));
+
+    for (uint32_t sequence = first; sequence != end && writer.err == ESP_OK; sequence++) {
+        TraceEvent event;
+        if (!mining_trace_get_event(sequence, &event)) {
+            continue; // overwritten while sending
+        }
+
+        int row = trace_row(event.point);
+        TraceChain * chain = &trace_chains[row - 1][event.id % TRACE_CHAINS];
+        const char * name = mining_trace_point_name(event.point);
+        const char * category = trace_category(event.point);
+
+        // An async slice from the previous point of the same notify or nonce up to this one
+        if (chain->valid && chain->id == event.id) {
+            chunk_printf(&writer, ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"b\",\"id\":%lu,\"ts\":%lld,\"pid\":1,\"tid\":%d}"
+                                  ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"e\",\"id\":%lu,\"ts\":%lld,\"pid\":1,\"tid\":%d}",
+                         name, category, event.id, chain->time_us, row,
+                         name, category, event.id, event.time_us, row);
+        } else {
+            // The first point seen of an id, the slices start here
+            chunk_printf(&writer, ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"id\":%lu}}",
+                         name, category, event.time_us, row, event.id);
+        }
+
+        chain->id = event.id;
+        chain->time_us = event.time_us;
+        chain->valid = true;
+    }
+
+    chunk_write(&writer, "]}", 2);
+    chunk_flush(&writer);
+
+    if (writer.err != ESP_OK) {
+        return writer.err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
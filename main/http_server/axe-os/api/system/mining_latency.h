@@ -0,0 +1,12 @@
+#ifndef MINING_LATENCY_API_H_
+#define MINING_LATENCY_API_H_
+
+#include <esp_http_server.h>
+
+// Function to handle the /api/system/latency endpoint
+esp_err_t GET_system_latency(httpd_req_t *req);
+
+// Function to handle the /api/system/latency/trace endpoint, a Chrome trace of the raw events
+esp_err_t GET_system_latency_trace(httpd_req_t *req);
+
+#endif // MINING_LATENCY_API_H_
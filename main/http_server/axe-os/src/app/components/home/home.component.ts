@@ -1,5 +1,5 @@
 import { Component, OnInit, ViewChild, Input, OnDestroy } from '@angular/core';
-import { interval, map, Observable, shareReplay, startWith, Subscription, switchMap, tap, first, Subject, takeUntil } from 'rxjs';
+import { interval, map, merge, Observable, scan, shareReplay, startWith, Subscription, switchMap, tap, first, Subject, takeUntil } from 'rxjs';
 import { HttpErrorResponse } from '@angular/common/http';
 import { FormBuilder, FormGroup, Validators } from '@angular/forms';
 import { ToastrService } from 'ngx-toastr';
@@ -9,6 +9,7 @@ import { QuicklinkService } from 'src/app/services/quicklink.service';
 import { ShareRejectionExplanationService } from 'src/app/services/share-rejection-explanation.service';
 import { LoadingService } from 'src/app/services/loading.service';
 import { SystemService } from 'src/app/services/system.service';
+import { TelemetryGroup, WebsocketService } from 'src/app/services/web-socket.service';
 import { ThemeService } from 'src/app/services/theme.service';
 import { ISystemInfo } from 'src/models/ISystemInfo';
 import { ISystemStatistics } from 'src/models/ISystemStatistics';
@@ -19,6 +20,7 @@ import { eChartLabel } from 'src/models/enum/eChartLabel';
 import { chartLabelValue } from 'src/models/enum/eChartLabel';
 import { chartLabelKey } from 'src/models/enum/eChartLabel';
 import { LocalStorageService } from 'src/app/local-storage.service';
+import { environment } from '../../../environments/environment';
 
 type PoolLabel = 'Primary' | 'Fallback';
 
@@ -29,6 +31,8 @@ type PoolLabel = 'Primary' | 'Fallback';
 })
 export class HomeComponent implements OnInit, OnDestroy {
 
+  private static readonly TELEMETRY_GROUPS: TelemetryGroup[] = ['hashrate', 'power', 'thermal', 'shares'];
+
   public info$!: Observable<ISystemInfo>;
   public stats$!: Observable<ISystemStatistics>;
   public pools$!: Observable<SelectItem<PoolLabel>[]>;
@@ -73,7 +77,8 @@ export class HomeComponent implements OnInit, OnDestroy {
     private loadingService: LoadingService,
     private toastr: ToastrService,
     private shareRejectReasonsService: ShareRejectionExplanationService,
-    private storageService: LocalStorageService
+    private storageService: LocalStorageService,
+    private websocketService: WebsocketService
   ) {
     this.initializeChart();
 
@@ -343,13 +348,18 @@ export class HomeComponent implements OnInit, OnDestroy {
 
   private startGetLiveData()
   {
-     // live data
-    this.info$ = interval(5000).pipe(
-      startWith(() => this.systemService.getInfo()),
-      switchMap(() => {
-        return this.systemService.getInfo()
-      }),
-      map(info => {
+    // live data, the full info is refreshed rarely and the telemetry pushes the changed fields in between
+    this.info$ = this.systemService.getInfo().pipe(
+      switchMap(firstInfo => merge(
+        interval(environment.production ? 60000 : 5000).pipe(switchMap(() => this.systemService.getInfo())),
+        this.websocketService.telemetry(HomeComponent.TELEMETRY_GROUPS, 5000)
+      ).pipe(
+        scan((info, update) => ({ ...info, ...update }), firstInfo),
+        startWith(firstInfo)
+      )),
+      map(raw => {
+        // The merged info is reused for the next frame, scale a copy
+        const info = { ...raw, hashrateMonitor: { ...raw.hashrateMonitor } };
         info.hashRate = info.hashRate * 1000000000;
         info.hashrateMonitor.hashrate = info.hashrateMonitor?.hashrate * 1000000000;
         info.expectedHashrate = info.expectedHashrate * 1000000000;
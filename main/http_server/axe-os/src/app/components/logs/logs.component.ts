@@ -53,33 +53,13 @@ export class LogsComponent implements OnInit, OnDestroy, AfterViewChecked {
 
   private subscribeLogs() {
     this.websocketSubscription = this.websocketService.ws$.subscribe({
-        next: (val) => {
-          const matches = val.matchAll(/\[(\d+;\d+)m(.*?)(?=\[|\n|$)/g);
-          let className = 'ansi-white'; // default color
-
-          for (const match of matches) {
-            const colorCode = match[1].split(';')[1];
-            switch (colorCode) {
-              case '31': className = 'ansi-red'; break;
-              case '32': className = 'ansi-green'; break;
-              case '33': className = 'ansi-yellow'; break;
-              case '34': className = 'ansi-blue'; break;
-              case '35': className = 'ansi-magenta'; break;
-              case '36': className = 'ansi-cyan'; break;
-              case '37': className = 'ansi-white'; break;
+        next: (frame) => {
+          // The device batches several lines into one frame
+          for (const line of frame.split('\n')) {
+            if (line.length > 0) {
+              this.addLine(line);
             }
           }
-
-          // Get current filter value from form
-          const currentFilter = this.form?.get('filter')?.value;
-
-          if (!currentFilter || val.includes(currentFilter)) {
-            this.logs.push({ className, text: val });
-          }
-
-          if (this.logs.length > 256) {
-            this.logs.shift();
-          }
         },
         error: (error) => {
           this.toastr.error("Error opening websocket connection");
@@ -87,6 +67,35 @@ export class LogsComponent implements OnInit, OnDestroy, AfterViewChecked {
       })
   }
 
+  private addLine(val: string) {
+    const matches = val.matchAll(/\[(\d+;\d+)m(.*?)(?=\[|\n|$)/g);
+    let className = 'ansi-white'; // default color
+
+    for (const match of matches) {
+      const colorCode = match[1].split(';')[1];
+      switch (colorCode) {
+        case '31': className = 'ansi-red'; break;
+        case '32': className = 'ansi-green'; break;
+        case '33': className = 'ansi-yellow'; break;
+        case '34': className = 'ansi-blue'; break;
+        case '35': className = 'ansi-magenta'; break;
+        case '36': className = 'ansi-cyan'; break;
+        case '37': className = 'ansi-white'; break;
+      }
+    }
+
+    // Get current filter value from form
+    const currentFilter = this.form?.get('filter')?.value;
+
+    if (!currentFilter || val.includes(currentFilter)) {
+      this.logs.push({ className, text: val });
+    }
+
+    if (this.logs.length > 256) {
+      this.logs.shift();
+    }
+  }
+
   public clearLogs() {
     this.logs.length = 0;
   }
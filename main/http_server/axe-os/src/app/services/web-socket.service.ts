@@ -1,5 +1,10 @@
 import { Injectable } from '@angular/core';
+import { catchError, map, NEVER, Observable } from 'rxjs';
 import { webSocket, WebSocketSubject } from 'rxjs/webSocket';
+import { environment } from '../../environments/environment';
+import { ISystemInfo } from 'src/models/ISystemInfo';
+
+export type TelemetryGroup = 'hashrate' | 'power' | 'thermal' | 'shares' | 'system';
 
 @Injectable({
   providedIn: 'root'
@@ -14,4 +19,27 @@ export class WebsocketService {
       deserializer: (e: MessageEvent) => { return e.data }
     });
   }
+
+  // Changed info fields, pushed by the device on every interval
+  public telemetry(groups: TelemetryGroup[], intervalMs: number): Observable<Partial<ISystemInfo>> {
+    if (!environment.production) {
+      return NEVER;
+    }
+
+    // A connection of its own, without the log lines
+    const ws$ = webSocket<any>({
+      url: `ws://${window.location.host}/api/ws`,
+      deserializer: (e: MessageEvent) => { return e.data }
+    });
+
+    return ws$.multiplex(
+      () => ({ telemetry: { groups, intervalMs }, logs: false }),
+      () => ({ telemetry: { groups: [] } }),
+      (message: string) => message.startsWith('{"telemetry"')
+    ).pipe(
+      map((message: string) => JSON.parse(message).telemetry as Partial<ISystemInfo>),
+      // Without the connection the full info refresh still updates the page
+      catchError(() => NEVER)
+    );
+  }
 }
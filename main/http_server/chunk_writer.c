@@ -0,0 +1,54 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "chunk_writer.h"
+
+void chunk_flush(ChunkWriter * writer)
+{
+    if (ESP_OK == writer->err && 0 < writer->len) {
+        writer->err = httpd_resp_send_chunk(writer->req, writer->buf, writer->len);
+    }
+    writer->len = 0;
+}
+
+void chunk_write(ChunkWriter * writer, const char * data, size_t len)
+{
+    writer->total += len;
+
+    while (0 < len && ESP_OK == writer->err) {
+        size_t copy = MIN(len, sizeof(writer->buf) - writer->len);
+        memcpy(writer->buf + writer->len, data, copy);
+        writer->len += copy;
+        data += copy;
+        len -= copy;
+        if (sizeof(writer->buf) == writer->len) {
+            chunk_flush(writer);
+        }
+    }
+}
+
+void chunk_printf(ChunkWriter * writer, const char * format, ...)
+{
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    if (0 < len) {
+        chunk_write(writer, text, MIN((size_t) len, sizeof(text) - 1));
+    }
+}
+
+void chunk_number(ChunkWriter * writer, double value)
+{
+    if (!isfinite(value)) {
+        chunk_write(writer, "null", 4);
+    } else if (fabs(value) < 1e15 && value == (double) (int64_t) value) {
+        chunk_printf(writer, "%lld", (int64_t) value);
+    } else {
+        chunk_printf(writer, "%1.15g", value);
+    }
+}
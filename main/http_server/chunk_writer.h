@@ -0,0 +1,30 @@
+#ifndef CHUNK_WRITER_H_
+#define CHUNK_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_http_server.h>
+
+// Responses are streamed in chunks of this size
+#define CHUNK_BUFFER_SIZE 1024
+
+// Buffers a response and sends it in chunks, the first error stops all writes
+typedef struct
+{
+    httpd_req_t * req;
+    esp_err_t err;
+    size_t len;
+    size_t total;                  // bytes written so far
+    char buf[CHUNK_BUFFER_SIZE];
+} ChunkWriter;
+
+void chunk_write(ChunkWriter * writer, const char * data, size_t len);
+void chunk_printf(ChunkWriter * writer, const char * format, ...) __attribute__((format(printf, 2, 3)));
+
+// A JSON number in the notation of cJSON_Print, non-finite values are null
+void chunk_number(ChunkWriter * writer, double value);
+
+// Send the buffered data, the caller still ends the response
+void chunk_flush(ChunkWriter * writer);
+
+#endif /* CHUNK_WRITER_H_ */
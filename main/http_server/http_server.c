@@ -1,7 +1,9 @@
 #include <pthread.h>
 #include <fcntl.h>
 #include <string.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <stdatomic.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 
@@ -12,6 +14,7 @@
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_random.h"
+#include "esp_rom_crc.h"
 #include "esp_spiffs.h"
 #include "esp_timer.h"
 #include "esp_wifi.h"
@@ -38,17 +41,26 @@
 #include "asic.h"
 #include "TPS546.h"
 #include "statistics_task.h"
+#include "statistics_history.h"
 #include "theme_api.h"  // Add theme API include
 #include "axe-os/api/system/asic_settings.h"
+#include "axe-os/api/system/asic_cores.h"
+#include "axe-os/api/system/mining_latency.h"
+#include "axe-os/api/system/asic_autotune.h"
+#include "axe-os/api/system/asic_power.h"
 #include "display.h"
 #include "http_server.h"
+#include "chunk_writer.h"
+#include "metrics.h"
+#include "telemetry.h"
 #include "system.h"
 #include "websocket.h"
 
-#define JSON_ALL_STATS_ELEMENT_SIZE 120
-
 #define NVS_STR_LIMIT (4000 - 1)
 
+// Rows of a statistics response unless the client asks for more, limit=0 sends all
+#define STATISTICS_RESPONSE_LIMIT 720
+
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
 static const char * TAG = "http_server";
@@ -90,6 +102,13 @@ typedef enum
     SRC_NONE // last
 } DataSource;
 
+typedef enum
+{
+    STATS_FORMAT_JSON,
+    STATS_FORMAT_CSV,
+    STATS_FORMAT_BINARY,
+} StatisticsFormat;
+
 DataSource strToDataSource(const char * sourceStr)
 {
     if (NULL != sourceStr) {
@@ -110,9 +129,82 @@ DataSource strToDataSource(const char * sourceStr)
     return SRC_NONE;
 }
 
+// Column order of the statistics response
+static const DataSource statisticsColumns[] = {
+    SRC_HASHRATE, SRC_ASIC_TEMP, SRC_HASHRATE_REGISTER, SRC_ERROR_COUNTER_REGISTER, SRC_VR_TEMP, SRC_ASIC_VOLTAGE,
+    SRC_VOLTAGE, SRC_POWER, SRC_CURRENT, SRC_FAN_SPEED, SRC_FAN_RPM, SRC_WIFI_RSSI, SRC_FREE_HEAP,
+};
+
+static const char * dataSourceToStr(DataSource source)
+{
+    switch (source) {
+        case SRC_HASHRATE:               return STATS_LABEL_HASHRATE;
+        case SRC_HASHRATE_REGISTER:      return STATS_LABEL_HASHRATE_REGISTER;
+        case SRC_ERROR_COUNTER_REGISTER: return STATS_LABEL_ERROR_COUNTER_REGISTER;
+        case SRC_ASIC_TEMP:              return STATS_LABEL_ASIC_TEMP;
+        case SRC_VR_TEMP:                return STATS_LABEL_VR_TEMP;
+        case SRC_ASIC_VOLTAGE:           return STATS_LABEL_ASIC_VOLTAGE;
+        case SRC_VOLTAGE:                return STATS_LABEL_VOLTAGE;
+        case SRC_POWER:                  return STATS_LABEL_POWER;
+        case SRC_CURRENT:                return STATS_LABEL_CURRENT;
+        case SRC_FAN_SPEED:              return STATS_LABEL_FAN_SPEED;
+        case SRC_FAN_RPM:                return STATS_LABEL_FAN_RPM;
+        case SRC_WIFI_RSSI:              return STATS_LABEL_WIFI_RSSI;
+        case SRC_FREE_HEAP:              return STATS_LABEL_FREE_HEAP;
+        default:                         return "";
+    }
+}
+
 static GlobalState * GLOBAL_STATE;
 static httpd_handle_t server = NULL;
 
+// Compact /api/system/info, shared by all requests until it is rebuilt
+#define SYSTEM_INFO_MAX_AGE_MS 1000
+#define SYSTEM_INFO_INITIAL_SIZE 4096
+#define SYSTEM_INFO_MAX_SIZE 32768
+#define SYSTEM_INFO_SLACK 5
+#define SYSTEM_INFO_COUNTERS_SIZE 128
+
+// Settings shown by /api/system/info, a change rebuilds the snapshot right away
+static const char * const SYSTEM_INFO_CONFIG_KEYS[] = {
+    NVS_CONFIG_WIFI_SSID,
+    NVS_CONFIG_HOSTNAME,
+    NVS_CONFIG_STRATUM_URL,
+    NVS_CONFIG_STRATUM_PORT,
+    NVS_CONFIG_STRATUM_USER,
+    NVS_CONFIG_STRATUM_DIFFICULTY,
+    NVS_CONFIG_STRATUM_EXTRANONCE_SUBSCRIBE,
+    NVS_CONFIG_FALLBACK_STRATUM_URL,
+    NVS_CONFIG_FALLBACK_STRATUM_PORT,
+    NVS_CONFIG_FALLBACK_STRATUM_USER,
+    NVS_CONFIG_FALLBACK_STRATUM_DIFFICULTY,
+    NVS_CONFIG_FALLBACK_STRATUM_EXTRANONCE_SUBSCRIBE,
+    NVS_CONFIG_ASIC_FREQUENCY_FLOAT,
+    NVS_CONFIG_ASIC_CHIP_FREQUENCIES,
+    NVS_CONFIG_ASIC_VOLTAGE,
+    NVS_CONFIG_POWER_LIMIT,
+    NVS_CONFIG_OVERHEAT_MODE,
+    NVS_CONFIG_OVERCLOCK_ENABLED,
+    NVS_CONFIG_DISPLAY,
+    NVS_CONFIG_ROTATION,
+    NVS_CONFIG_INVERT_SCREEN,
+    NVS_CONFIG_DISPLAY_TIMEOUT,
+    NVS_CONFIG_AUTO_FAN_SPEED,
+    NVS_CONFIG_MIN_FAN_SPEED,
+    NVS_CONFIG_TEMP_TARGET,
+    NVS_CONFIG_DIE_TEMP_CONTROL,
+    NVS_CONFIG_DIE_TEMP_TARGET,
+    NVS_CONFIG_FAN_FEED_FORWARD,
+    NVS_CONFIG_STATISTICS_FREQUENCY,
+};
+
+static char * system_info_buf;
+static size_t system_info_size;
+static size_t system_info_len;
+static int64_t system_info_time;
+static char system_info_etag[16];
+static atomic_bool system_info_stale;
+
 typedef enum
 {
     STORAGE_U8,
@@ -609,6 +701,7 @@ bool check_settings_and_update(const cJSON * const root)
         { .name = "hostname",                           .json_type = cJSON_String, .storage_type = STORAGE_STR,   .min = 1,  .max = 32,            .nvs_name = NVS_CONFIG_HOSTNAME },
         { .name = "coreVoltage",                        .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 1,  .max = USHRT_MAX,     .nvs_name = NVS_CONFIG_ASIC_VOLTAGE },
         { .name = "frequency",                          .json_type = cJSON_Number, .storage_type = STORAGE_FLOAT, .min = 1,  .max = USHRT_MAX,     .nvs_name = NVS_CONFIG_ASIC_FREQUENCY_FLOAT },
+        { .name = "chipFrequencies",                    .json_type = cJSON_String, .storage_type = STORAGE_STR,   .min = 0,  .max = NVS_STR_LIMIT, .nvs_name = NVS_CONFIG_ASIC_CHIP_FREQUENCIES },
         { .name = "overheat_mode",                      .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 0,  .max = 0,             .nvs_name = NVS_CONFIG_OVERHEAT_MODE },
         { .name = "display",                            .json_type = cJSON_String, .storage_type = STORAGE_STR,   .min = 0,  .max = NVS_STR_LIMIT, .nvs_name = NVS_CONFIG_DISPLAY },
         { .name = "rotation",                           .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 0,  .max = 270,           .nvs_name = NVS_CONFIG_ROTATION },
@@ -618,7 +711,12 @@ bool check_settings_and_update(const cJSON * const root)
         { .name = "fanspeed",                           .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 0,  .max = 100,           .nvs_name = NVS_CONFIG_FAN_SPEED },
         { .name = "minFanSpeed",                        .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 0,  .max = 99,            .nvs_name = NVS_CONFIG_MIN_FAN_SPEED },
         { .name = "temptarget",                         .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 35, .max = 66,            .nvs_name = NVS_CONFIG_TEMP_TARGET },
+        { .name = "dieTempControl",                     .json_type = cJSON_Option, .storage_type = STORAGE_U16,   .min = 0,  .max = 1,             .nvs_name = NVS_CONFIG_DIE_TEMP_CONTROL },
+        { .name = "dieTempTarget",                      .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 40, .max = 74,            .nvs_name = NVS_CONFIG_DIE_TEMP_TARGET },
+        { .name = "fanFeedForward",                     .json_type = cJSON_Option, .storage_type = STORAGE_U16,   .min = 0,  .max = 1,             .nvs_name = NVS_CONFIG_FAN_FEED_FORWARD },
+        { .name = "powerLimit",                         .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 0,  .max = USHRT_MAX,     .nvs_name = NVS_CONFIG_POWER_LIMIT },
         { .name = "statsFrequency",                     .json_type = cJSON_Number, .storage_type = STORAGE_U16,   .min = 0,  .max = USHRT_MAX,     .nvs_name = NVS_CONFIG_STATISTICS_FREQUENCY },
+        { .name = "asicBaud",                           .json_type = cJSON_Number, .storage_type = STORAGE_I32,   .min = 0,  .max = 3125000,       .nvs_name = NVS_CONFIG_ASIC_BAUD },
         { .name = "overclockEnabled",                   .json_type = cJSON_Option, .storage_type = STORAGE_U16,   .min = 0,  .max = 1,             .nvs_name = NVS_CONFIG_OVERCLOCK_ENABLED }
     };
 
@@ -724,6 +822,16 @@ bool check_settings_and_update(const cJSON * const root)
             }
         }
 
+        updatedSettings = getUpdatedSettings("chipFrequencies", settings, ARRAY_SIZE(settings));
+        if (updatedSettings) {
+            float frequencies[FREQUENCY_RAMP_MAX_CHIPS];
+            int count = FREQUENCY_RAMP_parse_chip_frequencies(updatedSettings->str_value, frequencies, FREQUENCY_RAMP_MAX_CHIPS);
+            if (count < 0 || count > GLOBAL_STATE->DEVICE_CONFIG.family.asic_count) {
+                ESP_LOGW(TAG, "Value '%s' for '%s' is not a list of up to %d frequencies", updatedSettings->str_value, updatedSettings->name, GLOBAL_STATE->DEVICE_CONFIG.family.asic_count);
+                result = false;
+            }
+        }
+
         updatedSettings = getUpdatedSettings("frequency", settings, ARRAY_SIZE(settings));
         if (updatedSettings) {
             // also store as u16 for backwards compatibility
@@ -851,21 +959,8 @@ static esp_err_t POST_restart(httpd_req_t * req)
     return ESP_OK;
 }
 
-/* Simple handler for getting system handler */
-static esp_err_t GET_system_info(httpd_req_t * req)
+static cJSON * create_system_info(void)
 {
-    if (is_network_allowed(req) != ESP_OK) {
-        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
-    }
-
-    httpd_resp_set_type(req, "application/json");
-
-    // Set CORS headers
-    if (set_cors_headers(req) != ESP_OK) {
-        httpd_resp_send_500(req);
-        return ESP_OK;
-    }
-
     char * ssid = nvs_config_get_string(NVS_CONFIG_WIFI_SSID, CONFIG_ESP_WIFI_SSID);
     char * hostname = nvs_config_get_string(NVS_CONFIG_HOSTNAME, CONFIG_LWIP_LOCAL_HOSTNAME);
     char * ipv4 = GLOBAL_STATE->SYSTEM_MODULE.ip_addr_str;
@@ -875,6 +970,7 @@ static esp_err_t GET_system_info(httpd_req_t * req)
     char * stratumUser = nvs_config_get_string(NVS_CONFIG_STRATUM_USER, CONFIG_STRATUM_USER);
     char * fallbackStratumUser = nvs_config_get_string(NVS_CONFIG_FALLBACK_STRATUM_USER, CONFIG_FALLBACK_STRATUM_USER);
     char * display = nvs_config_get_string(NVS_CONFIG_DISPLAY, "SSD1306 (128x32)");
+    char * chipFrequencies = nvs_config_get_string(NVS_CONFIG_ASIC_CHIP_FREQUENCIES, "");
     float frequency = nvs_config_get_float(NVS_CONFIG_ASIC_FREQUENCY_FLOAT, CONFIG_ASIC_FREQUENCY);
 
     uint8_t mac[6];
@@ -882,17 +978,18 @@ static esp_err_t GET_system_info(httpd_req_t * req)
     char formattedMac[18];
     snprintf(formattedMac, sizeof(formattedMac), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
 
-    int8_t wifi_rssi = -90;
-    get_wifi_current_rssi(&wifi_rssi);
-
     cJSON * root = cJSON_CreateObject();
     cJSON_AddNumberToObject(root, "power", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.power);
     cJSON_AddNumberToObject(root, "voltage", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.voltage);
-    cJSON_AddNumberToObject(root, "current", Power_get_current(GLOBAL_STATE));
+    cJSON_AddNumberToObject(root, "current", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.current);
     cJSON_AddNumberToObject(root, "temp", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp_avg);
     cJSON_AddNumberToObject(root, "temp2", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp2_avg);
+    cJSON_AddNumberToObject(root, "dieTemp", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp_max);
     cJSON_AddNumberToObject(root, "vrTemp", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.vr_temp);
     cJSON_AddNumberToObject(root, "maxPower", GLOBAL_STATE->DEVICE_CONFIG.family.max_power);
+    cJSON_AddNumberToObject(root, "powerLimit", nvs_config_get_u16(NVS_CONFIG_POWER_LIMIT, 0));
+    cJSON_AddNumberToObject(root, "powerLimitActual", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.power_limit);
+    cJSON_AddNumberToObject(root, "isPowerLimited", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.is_power_limited);
     cJSON_AddNumberToObject(root, "nominalVoltage", GLOBAL_STATE->DEVICE_CONFIG.family.nominal_voltage);
     cJSON_AddNumberToObject(root, "hashRate", GLOBAL_STATE->SYSTEM_MODULE.current_hashrate);
     cJSON_AddNumberToObject(root, "hashrateRegister", GLOBAL_STATE->HASHRATE_MONITOR_MODULE.hashrate);
@@ -906,20 +1003,23 @@ static esp_err_t GET_system_info(httpd_req_t * req)
 
     cJSON_AddNumberToObject(root, "isPSRAMAvailable", GLOBAL_STATE->psram_is_available);
 
-    cJSON_AddNumberToObject(root, "freeHeap", esp_get_free_heap_size());
     cJSON_AddNumberToObject(root, "coreVoltage", nvs_config_get_u16(NVS_CONFIG_ASIC_VOLTAGE, CONFIG_ASIC_VOLTAGE));
     cJSON_AddNumberToObject(root, "coreVoltageActual", VCORE_get_voltage_mv(GLOBAL_STATE));
     cJSON_AddNumberToObject(root, "frequency", frequency);
+    cJSON_AddNumberToObject(root, "frequencyActual", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.frequency_value);
+    cJSON_AddStringToObject(root, "chipFrequencies", chipFrequencies);
+    cJSON_AddNumberToObject(root, "frequencyRampProgress", FREQUENCY_RAMP_get_progress(&GLOBAL_STATE->FREQUENCY_RAMP_MODULE));
     cJSON_AddStringToObject(root, "ssid", ssid);
     cJSON_AddStringToObject(root, "macAddr", formattedMac);
     cJSON_AddStringToObject(root, "hostname", hostname);
     cJSON_AddStringToObject(root, "ipv4", ipv4);
     cJSON_AddStringToObject(root, "ipv6", ipv6);
     cJSON_AddStringToObject(root, "wifiStatus", GLOBAL_STATE->SYSTEM_MODULE.wifi_status);
-    cJSON_AddNumberToObject(root, "wifiRSSI", wifi_rssi);
     cJSON_AddNumberToObject(root, "apEnabled", GLOBAL_STATE->SYSTEM_MODULE.ap_enabled);
     cJSON_AddNumberToObject(root, "sharesAccepted", GLOBAL_STATE->SYSTEM_MODULE.shares_accepted);
     cJSON_AddNumberToObject(root, "sharesRejected", GLOBAL_STATE->SYSTEM_MODULE.shares_rejected);
+    cJSON_AddNumberToObject(root, "sharesAcceptedTotal", GLOBAL_STATE->SYSTEM_MODULE.total_shares_accepted);
+    cJSON_AddNumberToObject(root, "sharesRejectedTotal", GLOBAL_STATE->SYSTEM_MODULE.total_shares_rejected);
 
     cJSON *error_array = cJSON_CreateArray();
     cJSON_AddItemToObject(root, "sharesRejectedReasons", error_array);
@@ -931,7 +1031,7 @@ static esp_err_t GET_system_info(httpd_req_t * req)
         cJSON_AddItemToArray(error_array, error_obj);
     }
 
-    cJSON_AddNumberToObject(root, "uptimeSeconds", (esp_timer_get_time() - GLOBAL_STATE->SYSTEM_MODULE.start_time) / 1000000);
+    cJSON_AddNumberToObject(root, "energyTotal", GLOBAL_STATE->SYSTEM_MODULE.total_energy / 3600.0);
     cJSON_AddNumberToObject(root, "smallCoreCount", GLOBAL_STATE->DEVICE_CONFIG.family.asic.small_core_count);
     cJSON_AddStringToObject(root, "ASICModel", GLOBAL_STATE->DEVICE_CONFIG.family.asic.name);
     cJSON_AddStringToObject(root, "stratumURL", stratumURL);
@@ -965,16 +1065,44 @@ static esp_err_t GET_system_info(httpd_req_t * req)
     cJSON_AddNumberToObject(root, "fanspeed", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.fan_perc);
     cJSON_AddNumberToObject(root, "minFanSpeed", nvs_config_get_u16(NVS_CONFIG_MIN_FAN_SPEED, 25));
     cJSON_AddNumberToObject(root, "temptarget", nvs_config_get_u16(NVS_CONFIG_TEMP_TARGET, 60));
+    cJSON_AddNumberToObject(root, "dieTempControl", nvs_config_get_u16(NVS_CONFIG_DIE_TEMP_CONTROL, 0));
+    cJSON_AddNumberToObject(root, "dieTempTarget", nvs_config_get_u16(NVS_CONFIG_DIE_TEMP_TARGET, 68));
+    cJSON_AddNumberToObject(root, "fanFeedForward", nvs_config_get_u16(NVS_CONFIG_FAN_FEED_FORWARD, 0));
     cJSON_AddNumberToObject(root, "fanrpm", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.fan_rpm);
 
     cJSON_AddNumberToObject(root, "statsFrequency", nvs_config_get_u16(NVS_CONFIG_STATISTICS_FREQUENCY, 0));
 
+    uint32_t asic_rx_frames, asic_rx_errors;
+    get_receive_work_stats(&asic_rx_frames, &asic_rx_errors);
+    cJSON_AddNumberToObject(root, "asicBaud", GLOBAL_STATE->SYSTEM_MODULE.asic_baud);
+    cJSON_AddNumberToObject(root, "asicRxErrors", asic_rx_errors);
+
     cJSON_AddNumberToObject(root, "blockFound", GLOBAL_STATE->SYSTEM_MODULE.block_found);
 
     if (GLOBAL_STATE->SYSTEM_MODULE.power_fault > 0) {
         cJSON_AddStringToObject(root, "power_fault", VCORE_get_fault_string(GLOBAL_STATE));
     }
 
+    ThermalThrottleModule * THERMAL_THROTTLE_MODULE = &GLOBAL_STATE->THERMAL_THROTTLE_MODULE;
+    cJSON_AddNumberToObject(root, "throttleLevel", THERMAL_THROTTLE_MODULE->level);
+    cJSON_AddStringToObject(root, "throttleState", Thermal_throttle_get_level_string(THERMAL_THROTTLE_MODULE->level));
+
+    cJSON *throttle_events = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "throttleEvents", throttle_events);
+    for (int i = 0; i < THERMAL_THROTTLE_MODULE->event_count; i++) {
+        int index = (THERMAL_THROTTLE_MODULE->event_index + THERMAL_THROTTLE_EVENT_COUNT - THERMAL_THROTTLE_MODULE->event_count + i) % THERMAL_THROTTLE_EVENT_COUNT;
+        throttle_event_t * event = &THERMAL_THROTTLE_MODULE->events[index];
+
+        cJSON *throttle_event = cJSON_CreateObject();
+        cJSON_AddItemToArray(throttle_events, throttle_event);
+        cJSON_AddNumberToObject(throttle_event, "time", event->time);
+        cJSON_AddNumberToObject(throttle_event, "uptimeSeconds", event->uptime_s);
+        cJSON_AddNumberToObject(throttle_event, "level", event->level);
+        cJSON_AddStringToObject(throttle_event, "state", Thermal_throttle_get_level_string(event->level));
+        cJSON_AddNumberToObject(throttle_event, "temp", event->chip_temp);
+        cJSON_AddNumberToObject(throttle_event, "vrTemp", event->vr_temp);
+    }
+
     if (GLOBAL_STATE->block_height > 0) {
         cJSON_AddNumberToObject(root, "blockHeight", GLOBAL_STATE->block_height);
         cJSON_AddStringToObject(root, "scriptsig", GLOBAL_STATE->scriptsig);
@@ -1001,6 +1129,15 @@ static esp_err_t GET_system_info(httpd_req_t * req)
             cJSON_AddItemToObject(asic, "domains", cJSON_CreateFloatArray(domains, 4));
     
             cJSON_AddNumberToObject(asic, "error", GLOBAL_STATE->HASHRATE_MONITOR_MODULE.error_measurement[i].hashrate);
+
+            if (i < FREQUENCY_RAMP_MAX_CHIPS) {
+                cJSON_AddNumberToObject(asic, "frequency", GLOBAL_STATE->FREQUENCY_RAMP_MODULE.chip_frequency[i]);
+            }
+
+            if (i < sizeof(GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp) / sizeof(GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp[0])
+                && GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp_time_ms[i] != 0) {
+                cJSON_AddNumberToObject(asic, "temp", GLOBAL_STATE->POWER_MANAGEMENT_MODULE.chip_temp[i]);
+            }
         }
     }
     cJSON_AddNumberToObject(hashrate_monitor, "hashrate", GLOBAL_STATE->HASHRATE_MONITOR_MODULE.hashrate);
@@ -1013,15 +1150,81 @@ static esp_err_t GET_system_info(httpd_req_t * req)
     free(stratumUser);
     free(fallbackStratumUser);
     free(display);
+    free(chipFrequencies);
 
-    const char * sys_info = cJSON_Print(root);
-    httpd_resp_sendstr(req, sys_info);
-    free((char *)sys_info);
+    return root;
+}
+
+static void system_info_config_changed(const char * key, void * context)
+{
+    atomic_store(&system_info_stale, true);
+}
+
+// Rebuild the snapshot when a setting changed or it is older than the maximum age
+static bool update_system_info(void)
+{
+    int64_t now = esp_timer_get_time();
+    bool stale = atomic_exchange(&system_info_stale, false);
+    if (system_info_len > 0 && !stale && now - system_info_time < SYSTEM_INFO_MAX_AGE_MS * 1000) {
+        return true;
+    }
+
+    cJSON * root = create_system_info();
+    if (root == NULL) {
+        return false;
+    }
+
+    // cJSON needs some slack to print into a preallocated buffer, the counters are appended after it
+    size_t reserve = SYSTEM_INFO_SLACK + SYSTEM_INFO_COUNTERS_SIZE;
+    bool printed = system_info_size > 0
+        && cJSON_PrintPreallocated(root, system_info_buf, system_info_size - reserve, false);
+    while (!printed && system_info_size < SYSTEM_INFO_MAX_SIZE) {
+        size_t size = system_info_size > 0 ? system_info_size * 2 : SYSTEM_INFO_INITIAL_SIZE;
+        char * buf = realloc(system_info_buf, size);
+        if (buf == NULL) {
+            break;
+        }
+        system_info_buf = buf;
+        system_info_size = size;
+        printed = cJSON_PrintPreallocated(root, system_info_buf, system_info_size - reserve, false);
+    }
     cJSON_Delete(root);
-    return ESP_OK;
+
+    if (!printed) {
+        ESP_LOGE(TAG, "Failed to print system info");
+        system_info_len = 0;
+        return false;
+    }
+
+    // Counters tick on every snapshot, the ETag only covers the rest so polling clients can get a 304
+    system_info_len = strlen(system_info_buf);
+    snprintf(system_info_etag, sizeof(system_info_etag), "\"%08" PRIx32 "\"",
+             esp_rom_crc32_le(0, (const uint8_t *) system_info_buf, system_info_len));
+
+    int8_t wifi_rssi = -90;
+    get_wifi_current_rssi(&wifi_rssi);
+
+    // Replaces the closing brace of the object
+    system_info_len += snprintf(system_info_buf + system_info_len - 1, SYSTEM_INFO_COUNTERS_SIZE + 1,
+                                ",\"freeHeap\":%lu,\"wifiRSSI\":%d,\"uptimeSeconds\":%lld,\"uptimeSecondsTotal\":%llu}",
+                                esp_get_free_heap_size(), wifi_rssi, (now - GLOBAL_STATE->SYSTEM_MODULE.start_time) / 1000000,
+                                SYSTEM_get_total_uptime(GLOBAL_STATE)) - 1;
+    system_info_time = now;
+    return true;
 }
 
-static esp_err_t GET_system_statistics(httpd_req_t * req)
+static bool is_not_modified(httpd_req_t * req, const char * etag)
+{
+    char if_none_match[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) != ESP_OK) {
+        return false;
+    }
+    // A list of tags, possibly weak ones, still contains the quoted tag
+    return strstr(if_none_match, etag) != NULL || strcmp(if_none_match, "*") == 0;
+}
+
+/* Simple handler for getting system handler */
+static esp_err_t GET_system_info(httpd_req_t * req)
 {
     if (is_network_allowed(req) != ESP_OK) {
         return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
@@ -1035,21 +1238,54 @@ static esp_err_t GET_system_statistics(httpd_req_t * req)
         return ESP_OK;
     }
 
+    // All handlers run on the server task, the snapshot needs no lock
+    if (!update_system_info()) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_hdr(req, "ETag", system_info_etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    if (is_not_modified(req, system_info_etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    return httpd_resp_send(req, system_info_buf, system_info_len);
+}
+
+static StatisticsFormat strToStatisticsFormat(const char * formatStr)
+{
+    if (strcmp(formatStr, "csv") == 0)    return STATS_FORMAT_CSV;
+    if (strcmp(formatStr, "binary") == 0) return STATS_FORMAT_BINARY;
+    return STATS_FORMAT_JSON;
+}
+
+static esp_err_t GET_system_statistics(httpd_req_t * req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
     char * buf = NULL;
     size_t bufLen = httpd_req_get_url_query_len(req) + 1;
     bool dataSelection[SRC_NONE] = {false};
     bool selectionCheck = false;
-    int prebuffer = 0;
+    StatisticsFormat format = STATS_FORMAT_JSON;
+    int64_t since = INT64_MIN;
+    uint32_t resolution = 0;
+    uint32_t limit = STATISTICS_RESPONSE_LIMIT;
 
     // Check query parameters
     if (1 < bufLen) {
         buf = (char *)malloc(bufLen);
         if (buf) {
             if (httpd_req_get_url_query_str(req, buf, bufLen) == ESP_OK) {
-                char * columns = (char *)malloc(bufLen);
-                if (columns) {
-                    if (httpd_query_key_value(buf, "columns", columns, bufLen) == ESP_OK) {
-                        char * param = strtok(columns, ",");
+                char * value = (char *)malloc(bufLen);
+                if (value) {
+                    if (httpd_query_key_value(buf, "columns", value, bufLen) == ESP_OK) {
+                        char * param = strtok(value, ",");
                         while (NULL != param) {
                             DataSource sourceParam = strToDataSource(param);
                             if (SRC_NONE != sourceParam) {
@@ -1059,7 +1295,19 @@ static esp_err_t GET_system_statistics(httpd_req_t * req)
                             param = strtok(NULL, ",");
                         }
                     }
-                    free((void *)columns);
+                    if (httpd_query_key_value(buf, "since", value, bufLen) == ESP_OK) {
+                        since = strtoll(value, NULL, 10);
+                    }
+                    if (httpd_query_key_value(buf, "resolution", value, bufLen) == ESP_OK) {
+                        resolution = strtoul(value, NULL, 10);
+                    }
+                    if (httpd_query_key_value(buf, "format", value, bufLen) == ESP_OK) {
+                        format = strToStatisticsFormat(value);
+                    }
+                    if (httpd_query_key_value(buf, "limit", value, bufLen) == ESP_OK) {
+                        limit = strtoul(value, NULL, 10);
+                    }
+                    free((void *)value);
                 }
             }
             free((void *)buf);
@@ -1073,65 +1321,133 @@ static esp_err_t GET_system_statistics(httpd_req_t * req)
         }
     }
 
-    // Create object for statistics
-    cJSON * root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "currentTimestamp", (esp_timer_get_time() / 1000));
-    prebuffer++;
-
-    cJSON * labelArray = cJSON_CreateArray();
-    if (dataSelection[SRC_HASHRATE]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_HASHRATE)); }
-    if (dataSelection[SRC_ASIC_TEMP]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_ASIC_TEMP)); }
-    if (dataSelection[SRC_HASHRATE_REGISTER]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_HASHRATE_REGISTER)); }
-    if (dataSelection[SRC_ERROR_COUNTER_REGISTER]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_ERROR_COUNTER_REGISTER)); }
-    if (dataSelection[SRC_VR_TEMP]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_VR_TEMP)); }
-    if (dataSelection[SRC_ASIC_VOLTAGE]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_ASIC_VOLTAGE)); }
-    if (dataSelection[SRC_VOLTAGE]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_VOLTAGE)); }
-    if (dataSelection[SRC_POWER]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_POWER)); }
-    if (dataSelection[SRC_CURRENT]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_CURRENT)); }
-    if (dataSelection[SRC_FAN_SPEED]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_FAN_SPEED)); }
-    if (dataSelection[SRC_FAN_RPM]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_FAN_RPM)); }
-    if (dataSelection[SRC_WIFI_RSSI]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_WIFI_RSSI)); }
-    if (dataSelection[SRC_FREE_HEAP]) { cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_FREE_HEAP)); }
-    cJSON_AddItemToArray(labelArray, cJSON_CreateString(STATS_LABEL_TIMESTAMP));
-
-    cJSON_AddItemToObject(root, "labels", labelArray);
-    prebuffer++;
-
-    cJSON * statsArray = cJSON_AddArrayToObject(root, "statistics");
-
-    if (NULL != GLOBAL_STATE->STATISTICS_MODULE.statisticsList) {
-        StatisticsNodePtr node = *GLOBAL_STATE->STATISTICS_MODULE.statisticsList; // double pointer
-        struct StatisticsData statsData;
-
-        while (NULL != node) {
-            node = statisticData(node, &statsData);
-
-            cJSON * valueArray = cJSON_CreateArray();
-            if (dataSelection[SRC_HASHRATE]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.hashrate)); }
-            if (dataSelection[SRC_ASIC_TEMP]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.chipTemperature)); }
-            if (dataSelection[SRC_HASHRATE_REGISTER]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.hashrateRegister)); }
-            if (dataSelection[SRC_ERROR_COUNTER_REGISTER]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.errorCountRegister)); }
-            if (dataSelection[SRC_VR_TEMP]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.vrTemperature)); }
-            if (dataSelection[SRC_ASIC_VOLTAGE]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.coreVoltageActual)); }
-            if (dataSelection[SRC_VOLTAGE]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.voltage)); }
-            if (dataSelection[SRC_POWER]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.power)); }
-            if (dataSelection[SRC_CURRENT]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.current)); }
-            if (dataSelection[SRC_FAN_SPEED]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.fanSpeed)); }
-            if (dataSelection[SRC_FAN_RPM]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.fanRPM)); }
-            if (dataSelection[SRC_WIFI_RSSI]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.wifiRSSI)); }
-            if (dataSelection[SRC_FREE_HEAP]) { cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.freeHeap)); }
-            cJSON_AddItemToArray(valueArray, cJSON_CreateNumber(statsData.timestamp));
-
-            cJSON_AddItemToArray(statsArray, valueArray);
-            prebuffer++;
+    switch (format) {
+        case STATS_FORMAT_CSV:    httpd_resp_set_type(req, "text/csv"); break;
+        case STATS_FORMAT_BINARY: httpd_resp_set_type(req, "application/octet-stream"); break;
+        default:                  httpd_resp_set_type(req, "application/json"); break;
+    }
+
+    // Set CORS headers
+    if (set_cors_headers(req) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+
+    ChunkWriter writer = { .req = req };
+
+    // CSV and binary start with the same header line
+    if (STATS_FORMAT_JSON == format) {
+        chunk_printf(&writer, "{\"currentTimestamp\":%lld,\"labels\":[", esp_timer_get_time() / 1000);
+    }
+    for (int i = 0; i < ARRAY_SIZE(statisticsColumns); i++) {
+        if (dataSelection[statisticsColumns[i]]) {
+            chunk_printf(&writer, STATS_FORMAT_JSON == format ? "\"%s\"," : "%s,", dataSourceToStr(statisticsColumns[i]));
         }
     }
+    if (STATS_FORMAT_JSON == format) {
+        chunk_printf(&writer, "\"%s\"],\"statistics\":[", STATS_LABEL_TIMESTAMP);
+    } else {
+        chunk_printf(&writer, "%s\n", STATS_LABEL_TIMESTAMP);
+    }
 
-    const char * response = cJSON_PrintBuffered(root, (JSON_ALL_STATS_ELEMENT_SIZE * prebuffer), 0); // unformatted
-    httpd_resp_sendstr(req, response);
-    free((void *)response);
+    // Coarser resolutions are served from the history in flash
+    history_tier_t tier = statistics_history_tier(resolution);
+    uint32_t first;
+    uint32_t end = HISTORY_TIER_COUNT == tier
+        ? statisticDataRangeSince(since, &first)
+        : statistics_history_range_since(tier, since, &first);
 
-    cJSON_Delete(root);
+    // The latest rows, or with since the oldest after it so the client can page on from the last timestamp
+    if (0 < limit && end - first > limit) {
+        if (INT64_MIN == since) {
+            first = end - limit;
+        } else {
+            end = first + limit;
+        }
+    }
+
+    struct StatisticsData statsData;
+    bool separator = false;
+    uint32_t rows = 0;
+    uint32_t heap_start = esp_get_free_heap_size();
+    uint32_t heap_low = heap_start;
+
+    for (uint32_t sequence = first; sequence != end && ESP_OK == writer.err; sequence++) {
+        bool valid = HISTORY_TIER_COUNT == tier
+            ? statisticData(sequence, &statsData)
+            : statistics_history_get(tier, sequence, &statsData);
+        if (!valid || statsData.timestamp <= since) {
+            continue; // overwritten while reading, or at the since boundary
+        }
+        rows++;
+
+        double values[SRC_NONE];
+        values[SRC_HASHRATE] = statsData.hashrate;
+        values[SRC_HASHRATE_REGISTER] = statsData.hashrateRegister;
+        values[SRC_ERROR_COUNTER_REGISTER] = statsData.errorCountRegister;
+        values[SRC_ASIC_TEMP] = statsData.chipTemperature;
+        values[SRC_VR_TEMP] = statsData.vrTemperature;
+        values[SRC_ASIC_VOLTAGE] = statsData.coreVoltageActual;
+        values[SRC_VOLTAGE] = statsData.voltage;
+        values[SRC_POWER] = statsData.power;
+        values[SRC_CURRENT] = statsData.current;
+        values[SRC_FAN_SPEED] = statsData.fanSpeed;
+        values[SRC_FAN_RPM] = statsData.fanRPM;
+        values[SRC_WIFI_RSSI] = statsData.wifiRSSI;
+        values[SRC_FREE_HEAP] = statsData.freeHeap;
+
+        switch (format) {
+            case STATS_FORMAT_BINARY:
+                // Little endian float32 values, then the int64 timestamp
+                for (int i = 0; i < ARRAY_SIZE(statisticsColumns); i++) {
+                    if (dataSelection[statisticsColumns[i]]) {
+                        float value = values[statisticsColumns[i]];
+                        chunk_write(&writer, (const char *) &value, sizeof(value));
+                    }
+                }
+                chunk_write(&writer, (const char *) &statsData.timestamp, sizeof(statsData.timestamp));
+                break;
+            case STATS_FORMAT_CSV:
+                for (int i = 0; i < ARRAY_SIZE(statisticsColumns); i++) {
+                    if (dataSelection[statisticsColumns[i]]) {
+                        chunk_number(&writer, values[statisticsColumns[i]]);
+                        chunk_write(&writer, ",", 1);
+                    }
+                }
+                chunk_printf(&writer, "%lld\n", statsData.timestamp);
+                break;
+            default:
+                chunk_write(&writer, separator ? ",[" : "[", separator ? 2 : 1);
+                for (int i = 0; i < ARRAY_SIZE(statisticsColumns); i++) {
+                    if (dataSelection[statisticsColumns[i]]) {
+                        chunk_number(&writer, values[statisticsColumns[i]]);
+                        chunk_write(&writer, ",", 1);
+                    }
+                }
+                chunk_printf(&writer, "%lld]", statsData.timestamp);
+                break;
+        }
+        separator = true;
+
+        // Measured rather than estimated, other tasks allocating meanwhile only make it higher
+        uint32_t heap_free = esp_get_free_heap_size();
+        if (heap_free < heap_low) {
+            heap_low = heap_free;
+        }
+    }
+
+    if (STATS_FORMAT_JSON == format) {
+        chunk_write(&writer, "]}", 2);
+    }
+    chunk_flush(&writer);
+
+    ESP_LOGD(TAG, "Statistics response: %lu rows, %u bytes, heap use up to %lu bytes", rows, writer.total, heap_start - heap_low);
+
+    if (ESP_OK != writer.err) {
+        ESP_LOGW(TAG, "Statistics response aborted: %s", esp_err_to_name(writer.err));
+        return writer.err;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
 
     return ESP_OK;
 }
@@ -1302,6 +1618,14 @@ esp_err_t start_rest_server(void * pvParameters)
     
     // Initialize the ASIC API with the global state
     asic_api_init(GLOBAL_STATE);
+    asic_cores_api_init(GLOBAL_STATE);
+    autotune_api_init(GLOBAL_STATE);
+    power_api_init(GLOBAL_STATE);
+    metrics_init(GLOBAL_STATE);
+    telemetry_init(GLOBAL_STATE);
+    for (int i = 0; i < ARRAY_SIZE(SYSTEM_INFO_CONFIG_KEYS); i++) {
+        nvs_config_subscribe(SYSTEM_INFO_CONFIG_KEYS[i], system_info_config_changed, NULL);
+    }
     const char * base_path = "";
 
     bool enter_recovery = false;
@@ -1320,7 +1644,7 @@ esp_err_t start_rest_server(void * pvParameters)
     config.uri_match_fn = httpd_uri_match_wildcard;
     config.stack_size = 8192;
     config.max_open_sockets = 20;
-    config.max_uri_handlers = 20;
+    config.max_uri_handlers = 28;
     config.close_fn = websocket_close_fn;
     config.lru_purge_enable = true;
 
@@ -1356,6 +1680,74 @@ esp_err_t start_rest_server(void * pvParameters)
     };
     httpd_register_uri_handler(server, &system_asic_get_uri);
 
+    /* URI handler for fetching per core nonce statistics */
+    httpd_uri_t system_asic_cores_get_uri = {
+        .uri = "/api/system/asic/cores", 
+        .method = HTTP_GET, 
+        .handler = GET_system_asic_cores, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_asic_cores_get_uri);
+
+    /* URI handlers for the mining latency histograms and trace */
+    httpd_uri_t system_latency_get_uri = {
+        .uri = "/api/system/latency", 
+        .method = HTTP_GET, 
+        .handler = GET_system_latency, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_latency_get_uri);
+
+    httpd_uri_t system_latency_trace_get_uri = {
+        .uri = "/api/system/latency/trace", 
+        .method = HTTP_GET, 
+        .handler = GET_system_latency_trace, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_latency_trace_get_uri);
+
+    /* URI handlers for the frequency and voltage autotune */
+    httpd_uri_t system_autotune_get_uri = {
+        .uri = "/api/system/autotune", 
+        .method = HTTP_GET, 
+        .handler = GET_system_autotune, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_autotune_get_uri);
+
+    httpd_uri_t system_autotune_post_uri = {
+        .uri = "/api/system/autotune", 
+        .method = HTTP_POST, 
+        .handler = POST_system_autotune, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_autotune_post_uri);
+
+    /* URI handlers for the high rate power telemetry */
+    httpd_uri_t system_power_get_uri = {
+        .uri = "/api/system/power", 
+        .method = HTTP_GET, 
+        .handler = GET_system_power, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_power_get_uri);
+
+    httpd_uri_t system_power_capture_post_uri = {
+        .uri = "/api/system/power/capture", 
+        .method = HTTP_POST, 
+        .handler = POST_system_power_capture, 
+        .user_ctx = rest_context
+    };
+    httpd_register_uri_handler(server, &system_power_capture_post_uri);
+
+    httpd_uri_t metrics_get_uri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = GET_metrics,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &metrics_get_uri);
+
     /* URI handler for fetching system statistic values */
     httpd_uri_t system_statistics_get_uri = {
         .uri = "/api/system/statistics", 
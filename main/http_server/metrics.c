@@ -0,0 +1,246 @@
+#include <math.h>
+#include <stdio.h>
+#include "esp_app_desc.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "chunk_writer.h"
+#include "connect.h"
+#include "global_state.h"
+#include "mining_trace.h"
+#include "system.h"
+#include "websocket.h"
+#include "metrics.h"
+
+#define METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+static GlobalState *GLOBAL_STATE = NULL;
+
+// Cost of the previous scrape, reported in the next one
+static uint32_t scrape_duration_us;
+static uint32_t scrape_size_bytes;
+
+// Function declarations from http_server.c
+extern esp_err_t is_network_allowed(httpd_req_t *req);
+
+// Initialize the metrics endpoint with the global state
+void metrics_init(GlobalState *global_state) {
+    GLOBAL_STATE = global_state;
+}
+
+static void write_family(ChunkWriter *writer, const char *name, const char *type, const char *help)
+{
+    chunk_printf(writer, "# TYPE bitaxe_%s %s\n# HELP bitaxe_%s %s\n", name, type, name, help);
+}
+
+static void write_sample(ChunkWriter *writer, const char *name, const char *labels, double value)
+{
+    chunk_printf(writer, "bitaxe_%s", name);
+    if (labels != NULL) {
+        chunk_printf(writer, "{%s}", labels);
+    }
+
+    if (isnan(value)) {
+        chunk_write(writer, " NaN\n", 5);
+    } else if (isinf(value)) {
+        chunk_printf(writer, " %s\n", value > 0 ? "+Inf" : "-Inf");
+    } else if (fabs(value) < 1e15 && value == (double) (int64_t) value) {
+        chunk_printf(writer, " %lld\n", (int64_t) value);
+    } else {
+        chunk_printf(writer, " %.9g\n", value);
+    }
+}
+
+static void write_gauge(ChunkWriter *writer, const char *name, const char *help, double value)
+{
+    write_family(writer, name, "gauge", help);
+    write_sample(writer, name, NULL, value);
+}
+
+// Label values are escaped as in the exposition format
+static void write_label(ChunkWriter *writer, const char *name, const char *value, bool last)
+{
+    chunk_printf(writer, "%s=\"", name);
+    for (const char *c = value; *c != '\0'; c++) {
+        switch (*c) {
+            case '"':  chunk_write(writer, "\\\"", 2); break;
+            case '\\': chunk_write(writer, "\\\\", 2); break;
+            case '\n': chunk_write(writer, "\\n", 2); break;
+            default:   chunk_write(writer, c, 1); break;
+        }
+    }
+    chunk_write(writer, last ? "\"" : "\",", last ? 1 : 2);
+}
+
+static void write_info(ChunkWriter *writer)
+{
+    write_family(writer, "build", "info", "Firmware and hardware");
+    chunk_write(writer, "bitaxe_build_info{", 18);
+    write_label(writer, "version", esp_app_get_description()->version, false);
+    write_label(writer, "asic_model", GLOBAL_STATE->DEVICE_CONFIG.family.asic.name, false);
+    write_label(writer, "board_version", GLOBAL_STATE->DEVICE_CONFIG.board_version, true);
+    chunk_write(writer, "} 1\n", 4);
+}
+
+static void write_asics(ChunkWriter *writer)
+{
+    HashrateMonitorModule *hashrate_monitor = &GLOBAL_STATE->HASHRATE_MONITOR_MODULE;
+    CoreMonitorModule *core_monitor = &GLOBAL_STATE->CORE_MONITOR_MODULE;
+    PowerManagementModule *power_management = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+    int asic_count = GLOBAL_STATE->DEVICE_CONFIG.family.asic_count;
+    char labels[16];
+
+    if (hashrate_monitor->is_initialized) {
+        write_family(writer, "asic_hashrate_hashes_per_second", "gauge", "Hashrate per chip from the hash counter register");
+        for (int i = 0; i < asic_count; i++) {
+            snprintf(labels, sizeof(labels), "asic=\"%d\"", i);
+            write_sample(writer, "asic_hashrate_hashes_per_second", labels, hashrate_monitor->total_measurement[i].hashrate * 1e9);
+        }
+        write_family(writer, "asic_error_hashrate_hashes_per_second", "gauge", "Hashrate of failed nonces per chip");
+        for (int i = 0; i < asic_count; i++) {
+            snprintf(labels, sizeof(labels), "asic=\"%d\"", i);
+            write_sample(writer, "asic_error_hashrate_hashes_per_second", labels, hashrate_monitor->error_measurement[i].hashrate * 1e9);
+        }
+    }
+
+    if (core_monitor->is_initialized) {
+        write_family(writer, "asic_nonces", "counter", "Nonces found per chip");
+        for (int i = 0; i < asic_count; i++) {
+            snprintf(labels, sizeof(labels), "asic=\"%d\"", i);
+            chunk_printf(writer, "bitaxe_asic_nonces_total{%s} %lu\n", labels, core_monitor->asic_nonces[i]);
+        }
+    }
+
+    write_family(writer, "asic_frequency_hertz", "gauge", "Frequency per chip");
+    for (int i = 0; i < asic_count && i < FREQUENCY_RAMP_MAX_CHIPS; i++) {
+        snprintf(labels, sizeof(labels), "asic=\"%d\"", i);
+        write_sample(writer, "asic_frequency_hertz", labels, GLOBAL_STATE->FREQUENCY_RAMP_MODULE.chip_frequency[i] * 1e6);
+    }
+
+    write_family(writer, "asic_temperature_celsius", "gauge", "Die temperature per chip");
+    for (int i = 0; i < asic_count && i < sizeof(power_management->chip_temp) / sizeof(power_management->chip_temp[0]); i++) {
+        if (power_management->chip_temp_time_ms[i] != 0) {
+            snprintf(labels, sizeof(labels), "asic=\"%d\"", i);
+            write_sample(writer, "asic_temperature_celsius", labels, power_management->chip_temp[i]);
+        }
+    }
+}
+
+static void write_response_time(ChunkWriter *writer)
+{
+    SystemModule *module = &GLOBAL_STATE->SYSTEM_MODULE;
+    uint32_t cumulative = 0;
+
+    write_family(writer, "pool_response_time_seconds", "histogram", "Time for the pool to answer a request");
+    for (int i = 0; i < RESPONSE_TIME_BUCKET_COUNT - 1; i++) {
+        cumulative += module->response_time_buckets[i];
+        chunk_printf(writer, "bitaxe_pool_response_time_seconds_bucket{le=\"%g\"} %lu\n", SYSTEM_response_time_bounds[i] / 1000.0, cumulative);
+    }
+    cumulative += module->response_time_buckets[RESPONSE_TIME_BUCKET_COUNT - 1];
+    chunk_printf(writer, "bitaxe_pool_response_time_seconds_bucket{le=\"+Inf\"} %lu\n", cumulative);
+    write_sample(writer, "pool_response_time_seconds_sum", NULL, module->response_time_sum / 1000.0);
+    write_sample(writer, "pool_response_time_seconds_count", NULL, module->response_time_count);
+}
+
+static void write_mining_latency(ChunkWriter *writer)
+{
+    write_family(writer, "mining_latency_seconds", "histogram", "Time between the trace points of a notify or a nonce");
+    for (trace_span_t span = 0; span < TRACE_SPAN_COUNT; span++) {
+        TraceSpanStats stats;
+        mining_trace_get_span(span, &stats);
+
+        const char *name = mining_trace_span_name(span);
+        uint32_t cumulative = 0;
+        for (int i = 0; i < MINING_TRACE_BUCKET_COUNT - 1; i++) {
+            cumulative += stats.buckets[i];
+            chunk_printf(writer, "bitaxe_mining_latency_seconds_bucket{span=\"%s\",le=\"%g\"} %lu\n", name, mining_trace_bucket_bounds_us[i] / 1e6, cumulative);
+        }
+        chunk_printf(writer, "bitaxe_mining_latency_seconds_bucket{span=\"%s\",le=\"+Inf\"} %lu\n", name, stats.count);
+        chunk_printf(writer, "bitaxe_mining_latency_seconds_sum{span=\"%s\"} %.6f\n", name, stats.sum_us / 1e6);
+        chunk_printf(writer, "bitaxe_mining_latency_seconds_count{span=\"%s\"} %lu\n", name, stats.count);
+    }
+}
+
+esp_err_t GET_metrics(httpd_req_t *req)
+{
+    if (is_network_allowed(req) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_401_UNAUTHORIZED, "Unauthorized");
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    SystemModule *system = &GLOBAL_STATE->SYSTEM_MODULE;
+    PowerManagementModule *power_management = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+
+    int8_t wifi_rssi = -90;
+    get_wifi_current_rssi(&wifi_rssi);
+
+    uint32_t asic_rx_frames, asic_rx_errors;
+    get_receive_work_stats(&asic_rx_frames, &asic_rx_errors);
+
+    httpd_resp_set_type(req, METRICS_CONTENT_TYPE);
+
+    // Everything is written from the module state into the chunk buffer on the stack
+    ChunkWriter writer = { .req = req };
+
+    write_info(&writer);
+
+    write_family(&writer, "hashrate_hashes_per_second", "gauge", "Hashrate estimated from the shares or the hash counter registers");
+    write_sample(&writer, "hashrate_hashes_per_second", "source=\"shares\"", system->current_hashrate * 1e9);
+    write_sample(&writer, "hashrate_hashes_per_second", "source=\"register\"", GLOBAL_STATE->HASHRATE_MONITOR_MODULE.hashrate * 1e9);
+    write_gauge(&writer, "expected_hashrate_hashes_per_second", "Hashrate expected from the frequency and core count", power_management->expected_hashrate * 1e9);
+    write_asics(&writer);
+
+    write_family(&writer, "shares", "counter", "Shares submitted since boot");
+    chunk_printf(&writer, "bitaxe_shares_total{result=\"accepted\"} %llu\n", system->shares_accepted);
+    chunk_printf(&writer, "bitaxe_shares_total{result=\"rejected\"} %llu\n", system->shares_rejected);
+    write_gauge(&writer, "pool_difficulty", "Difficulty set by the pool", GLOBAL_STATE->pool_difficulty);
+    write_response_time(&writer);
+
+    write_family(&writer, "temperature_celsius", "gauge", "Chip and regulator temperatures");
+    write_sample(&writer, "temperature_celsius", "sensor=\"asic\"", power_management->chip_temp_avg);
+    write_sample(&writer, "temperature_celsius", "sensor=\"asic_max\"", power_management->chip_temp_max);
+    write_sample(&writer, "temperature_celsius", "sensor=\"vr\"", power_management->vr_temp);
+    write_gauge(&writer, "power_watts", "Input power", power_management->power);
+    write_gauge(&writer, "input_voltage_volts", "Input voltage", power_management->voltage / 1000.0);
+    write_gauge(&writer, "input_current_amperes", "Input current", power_management->current / 1000.0);
+    write_gauge(&writer, "core_voltage_volts", "Measured core voltage", SENSOR_get(GLOBAL_STATE, SENSOR_CORE_VOLTAGE) / 1000.0);
+    write_gauge(&writer, "fan_speed_ratio", "Fan duty cycle", power_management->fan_perc / 100.0);
+    write_gauge(&writer, "fan_rpm", "Fan speed", power_management->fan_rpm);
+    write_gauge(&writer, "throttle_level", "Thermal throttle level, 0 when not throttling", GLOBAL_STATE->THERMAL_THROTTLE_MODULE.level);
+
+    write_family(&writer, "asic_rx_errors", "counter", "Corrupt frames received from the chips");
+    chunk_printf(&writer, "bitaxe_asic_rx_errors_total %lu\n", asic_rx_errors);
+    write_gauge(&writer, "wifi_rssi_dbm", "Signal strength of the access point", wifi_rssi);
+    write_gauge(&writer, "uptime_seconds", "Time since boot", (esp_timer_get_time() - system->start_time) / 1e6);
+
+    write_gauge(&writer, "heap_free_bytes", "Free heap", esp_get_free_heap_size());
+    write_gauge(&writer, "heap_minimum_free_bytes", "Lowest free heap since boot", esp_get_minimum_free_heap_size());
+    write_gauge(&writer, "heap_largest_free_block_bytes", "Largest allocatable block of internal RAM", heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (GLOBAL_STATE->psram_is_available) {
+        write_gauge(&writer, "psram_free_bytes", "Free PSRAM", heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    }
+
+    write_mining_latency(&writer);
+
+    write_family(&writer, "websocket_log_dropped_lines", "counter", "Log lines not streamed because the log ring was full");
+    chunk_printf(&writer, "bitaxe_websocket_log_dropped_lines_total %lu\n", websocket_log_dropped_total());
+
+    write_gauge(&writer, "scrape_duration_seconds", "Time to render and send the previous scrape", scrape_duration_us / 1e6);
+    write_gauge(&writer, "scrape_size_bytes", "Size of the previous scrape", scrape_size_bytes);
+
+    chunk_write(&writer, "# EOF\n", 6);
+    chunk_flush(&writer);
+
+    if (ESP_OK != writer.err) {
+        return writer.err;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    scrape_duration_us = esp_timer_get_time() - start;
+    scrape_size_bytes = writer.total;
+    ESP_LOGD("metrics", "Scrape of %lu bytes in %lu us", scrape_size_bytes, scrape_duration_us);
+
+    return ESP_OK;
+}
@@ -0,0 +1,13 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <esp_http_server.h>
+#include "global_state.h"
+
+// Function to handle GET /metrics
+esp_err_t GET_metrics(httpd_req_t *req);
+
+// Initialize the metrics endpoint with the global state
+void metrics_init(GlobalState *global_state);
+
+#endif // METRICS_H_
@@ -0,0 +1,249 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "connect.h"
+#include "websocket.h"
+#include "telemetry.h"
+
+static const char * TAG = "telemetry";
+
+static GlobalState * GLOBAL_STATE = NULL;
+
+// Field names match /api/system/info so clients can merge the frames into it
+typedef enum {
+    FIELD_HASHRATE = 0,
+    FIELD_HASHRATE_REGISTER,
+    FIELD_EXPECTED_HASHRATE,
+    FIELD_ERROR_COUNT_REGISTER,
+    FIELD_POWER,
+    FIELD_VOLTAGE,
+    FIELD_CURRENT,
+    FIELD_CORE_VOLTAGE_ACTUAL,
+    FIELD_FREQUENCY_ACTUAL,
+    FIELD_TEMP,
+    FIELD_TEMP2,
+    FIELD_DIE_TEMP,
+    FIELD_VR_TEMP,
+    FIELD_FAN_SPEED,
+    FIELD_FAN_RPM,
+    FIELD_THROTTLE_LEVEL,
+    FIELD_SHARES_ACCEPTED,
+    FIELD_SHARES_REJECTED,
+    FIELD_POOL_DIFFICULTY,
+    FIELD_RESPONSE_TIME,
+    FIELD_BLOCK_FOUND,
+    FIELD_FREE_HEAP,
+    FIELD_WIFI_RSSI,
+    FIELD_UPTIME,
+    FIELD_COUNT,
+} telemetry_field_t;
+
+typedef struct {
+    const char * name;
+    telemetry_group_t group;
+    uint8_t decimals;              // changes below this precision are not sent
+} TelemetryField;
+
+static const TelemetryField fields[FIELD_COUNT] = {
+    [FIELD_HASHRATE]             = { "hashRate",           TELEMETRY_GROUP_HASHRATE, 2 },
+    [FIELD_HASHRATE_REGISTER]    = { "hashrateRegister",   TELEMETRY_GROUP_HASHRATE, 2 },
+    [FIELD_EXPECTED_HASHRATE]    = { "expectedHashrate",   TELEMETRY_GROUP_HASHRATE, 0 },
+    [FIELD_ERROR_COUNT_REGISTER] = { "errorCountRegister", TELEMETRY_GROUP_HASHRATE, 0 },
+    [FIELD_POWER]                = { "power",              TELEMETRY_GROUP_POWER,    2 },
+    [FIELD_VOLTAGE]              = { "voltage",            TELEMETRY_GROUP_POWER,    0 },
+    [FIELD_CURRENT]              = { "current",            TELEMETRY_GROUP_POWER,    0 },
+    [FIELD_CORE_VOLTAGE_ACTUAL]  = { "coreVoltageActual",  TELEMETRY_GROUP_POWER,    0 },
+    [FIELD_FREQUENCY_ACTUAL]     = { "frequencyActual",    TELEMETRY_GROUP_POWER,    2 },
+    [FIELD_TEMP]                 = { "temp",               TELEMETRY_GROUP_THERMAL,  1 },
+    [FIELD_TEMP2]                = { "temp2",              TELEMETRY_GROUP_THERMAL,  1 },
+    [FIELD_DIE_TEMP]             = { "dieTemp",            TELEMETRY_GROUP_THERMAL,  1 },
+    [FIELD_VR_TEMP]              = { "vrTemp",             TELEMETRY_GROUP_THERMAL,  1 },
+    [FIELD_FAN_SPEED]            = { "fanspeed",           TELEMETRY_GROUP_THERMAL,  0 },
+    [FIELD_FAN_RPM]              = { "fanrpm",             TELEMETRY_GROUP_THERMAL,  0 },
+    [FIELD_THROTTLE_LEVEL]       = { "throttleLevel",      TELEMETRY_GROUP_THERMAL,  0 },
+    [FIELD_SHARES_ACCEPTED]      = { "sharesAccepted",     TELEMETRY_GROUP_SHARES,   0 },
+    [FIELD_SHARES_REJECTED]      = { "sharesRejected",     TELEMETRY_GROUP_SHARES,   0 },
+    [FIELD_POOL_DIFFICULTY]      = { "poolDifficulty",     TELEMETRY_GROUP_SHARES,   0 },
+    [FIELD_RESPONSE_TIME]        = { "responseTime",       TELEMETRY_GROUP_SHARES,   2 },
+    [FIELD_BLOCK_FOUND]          = { "blockFound",         TELEMETRY_GROUP_SHARES,   0 },
+    [FIELD_FREE_HEAP]            = { "freeHeap",           TELEMETRY_GROUP_SYSTEM,   0 },
+    [FIELD_WIFI_RSSI]            = { "wifiRSSI",           TELEMETRY_GROUP_SYSTEM,   0 },
+    [FIELD_UPTIME]               = { "uptimeSeconds",      TELEMETRY_GROUP_SYSTEM,   0 },
+};
+
+static const char * group_names[TELEMETRY_GROUP_COUNT] = {
+    [TELEMETRY_GROUP_HASHRATE] = "hashrate",
+    [TELEMETRY_GROUP_POWER] = "power",
+    [TELEMETRY_GROUP_THERMAL] = "thermal",
+    [TELEMETRY_GROUP_SHARES] = "shares",
+    [TELEMETRY_GROUP_SYSTEM] = "system",
+};
+
+typedef struct {
+    uint32_t groups;               // bit per telemetry_group_t, 0 when not subscribed
+    uint32_t interval_ms;
+    uint32_t next_ms;
+    bool full;                     // the next frame carries all fields
+    int64_t sent[FIELD_COUNT];     // scaled by 10^decimals
+} TelemetryClient;
+
+static TelemetryClient clients[MAX_WEBSOCKET_CLIENTS];
+
+// Snapshot of the current tick, scaled like the sent values
+static int64_t snapshot[FIELD_COUNT];
+static uint32_t snapshot_ms;
+
+void telemetry_init(GlobalState * global_state)
+{
+    GLOBAL_STATE = global_state;
+}
+
+static double field_value(telemetry_field_t field)
+{
+    SystemModule * system = &GLOBAL_STATE->SYSTEM_MODULE;
+    PowerManagementModule * power_management = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+
+    switch (field) {
+        case FIELD_HASHRATE:             return system->current_hashrate;
+        case FIELD_HASHRATE_REGISTER:    return GLOBAL_STATE->HASHRATE_MONITOR_MODULE.hashrate;
+        case FIELD_EXPECTED_HASHRATE:    return power_management->expected_hashrate;
+        case FIELD_ERROR_COUNT_REGISTER: return GLOBAL_STATE->HASHRATE_MONITOR_MODULE.error_count;
+        case FIELD_POWER:                return power_management->power;
+        case FIELD_VOLTAGE:              return power_management->voltage;
+        case FIELD_CURRENT:              return power_management->current;
+        case FIELD_CORE_VOLTAGE_ACTUAL:  return SENSOR_get(GLOBAL_STATE, SENSOR_CORE_VOLTAGE);
+        case FIELD_FREQUENCY_ACTUAL:     return power_management->frequency_value;
+        case FIELD_TEMP:                 return power_management->chip_temp_avg;
+        case FIELD_TEMP2:                return power_management->chip_temp2_avg;
+        case FIELD_DIE_TEMP:             return power_management->chip_temp_max;
+        case FIELD_VR_TEMP:              return power_management->vr_temp;
+        case FIELD_FAN_SPEED:            return power_management->fan_perc;
+        case FIELD_FAN_RPM:              return power_management->fan_rpm;
+        case FIELD_THROTTLE_LEVEL:       return GLOBAL_STATE->THERMAL_THROTTLE_MODULE.level;
+        case FIELD_SHARES_ACCEPTED:      return system->shares_accepted;
+        case FIELD_SHARES_REJECTED:      return system->shares_rejected;
+        case FIELD_POOL_DIFFICULTY:      return GLOBAL_STATE->pool_difficulty;
+        case FIELD_RESPONSE_TIME:        return system->response_time;
+        case FIELD_BLOCK_FOUND:          return system->block_found;
+        case FIELD_FREE_HEAP:            return esp_get_free_heap_size();
+        case FIELD_WIFI_RSSI: {
+            int8_t wifi_rssi = -90;
+            get_wifi_current_rssi(&wifi_rssi);
+            return wifi_rssi;
+        }
+        case FIELD_UPTIME:               return (esp_timer_get_time() - system->start_time) / 1000000;
+        default:                         return 0;
+    }
+}
+
+static const double factors[] = { 1, 10, 100, 1000 };
+
+static int64_t scale(double value, uint8_t decimals)
+{
+    return isfinite(value) ? llround(value * factors[decimals]) : 0;
+}
+
+void telemetry_subscribe(int client, const cJSON * subscription)
+{
+    TelemetryClient * state = &clients[client];
+    uint32_t groups = 0;
+
+    const cJSON * group;
+    cJSON_ArrayForEach(group, cJSON_GetObjectItem(subscription, "groups")) {
+        for (int i = 0; i < TELEMETRY_GROUP_COUNT; i++) {
+            if (cJSON_IsString(group) && strcmp(group->valuestring, group_names[i]) == 0) {
+                groups |= 1 << i;
+            }
+        }
+    }
+
+    uint32_t interval_ms = TELEMETRY_DEFAULT_INTERVAL_MS;
+    const cJSON * interval = cJSON_GetObjectItem(subscription, "intervalMs");
+    if (cJSON_IsNumber(interval)) {
+        interval_ms = fmin(fmax(interval->valuedouble, TELEMETRY_MIN_INTERVAL_MS), TELEMETRY_MAX_INTERVAL_MS);
+    }
+
+    state->groups = groups;
+    state->interval_ms = interval_ms;
+    state->next_ms = 0;
+    state->full = true;
+
+    ESP_LOGI(TAG, "Client %d: groups 0x%02lx every %lu ms", client, groups, interval_ms);
+}
+
+void telemetry_unsubscribe(int client)
+{
+    clients[client].groups = 0;
+}
+
+bool telemetry_is_active(void)
+{
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (clients[i].groups != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void telemetry_sample(uint32_t now_ms)
+{
+    uint32_t groups = 0;
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (clients[i].groups != 0 && (int32_t) (now_ms - clients[i].next_ms) >= 0) {
+            groups |= clients[i].groups;
+        }
+    }
+
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (groups & (1 << fields[i].group)) {
+            snapshot[i] = scale(field_value(i), fields[i].decimals);
+        }
+    }
+    snapshot_ms = now_ms;
+}
+
+size_t telemetry_render(int client, uint32_t now_ms, char * frame, size_t size)
+{
+    TelemetryClient * state = &clients[client];
+
+    if (state->groups == 0 || (int32_t) (now_ms - state->next_ms) < 0 || snapshot_ms != now_ms) {
+        return 0;
+    }
+
+    // Keep the phase, unless the client fell behind by a whole interval
+    state->next_ms += state->interval_ms;
+    if ((int32_t) (now_ms - state->next_ms) >= 0) {
+        state->next_ms = now_ms + state->interval_ms;
+    }
+
+    // Frames are sent on every interval, even without changes, as a time base for charts
+    int len = snprintf(frame, size, "{\"telemetry\":{\"t\":%lu", now_ms);
+    for (int i = 0; i < FIELD_COUNT && len < (int) size; i++) {
+        if (!(state->groups & (1 << fields[i].group)) || (!state->full && state->sent[i] == snapshot[i])) {
+            continue;
+        }
+
+        int64_t value = snapshot[i];
+        if (fields[i].decimals == 0) {
+            len += snprintf(frame + len, size - len, ",\"%s\":%lld", fields[i].name, value);
+        } else {
+            len += snprintf(frame + len, size - len, ",\"%s\":%.*f", fields[i].name, fields[i].decimals,
+                            value / factors[fields[i].decimals]);
+        }
+        state->sent[i] = value;
+    }
+    if (len < (int) size) {
+        len += snprintf(frame + len, size - len, "}}");
+    }
+    state->full = false;
+
+    if (len >= (int) size) {
+        ESP_LOGE(TAG, "Frame exceeds %u bytes", (unsigned int) size);
+        return 0;
+    }
+    return len;
+}
@@ -0,0 +1,52 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "global_state.h"
+
+// Subscriptions are checked at this rate, clients due in the same tick share one snapshot
+#define TELEMETRY_TICK_MS 100
+
+#define TELEMETRY_MIN_INTERVAL_MS 250
+#define TELEMETRY_MAX_INTERVAL_MS 60000
+#define TELEMETRY_DEFAULT_INTERVAL_MS 1000
+
+// Large enough for every field at once
+#define TELEMETRY_FRAME_SIZE 768
+
+typedef enum {
+    TELEMETRY_GROUP_HASHRATE = 0,
+    TELEMETRY_GROUP_POWER,
+    TELEMETRY_GROUP_THERMAL,
+    TELEMETRY_GROUP_SHARES,
+    TELEMETRY_GROUP_SYSTEM,
+    TELEMETRY_GROUP_COUNT,
+} telemetry_group_t;
+
+void telemetry_init(GlobalState * global_state);
+
+/**
+ * @brief Apply a subscription message of a websocket client.
+ *
+ * {"groups": ["power", "thermal"], "intervalMs": 1000}, no groups unsubscribes.
+ * The next frame carries all fields of the groups, later frames only the
+ * fields that changed at their displayed precision.
+ */
+void telemetry_subscribe(int client, const cJSON * subscription);
+void telemetry_unsubscribe(int client);
+bool telemetry_is_active(void);
+
+// Read the fields once for all clients due in this tick
+void telemetry_sample(uint32_t now_ms);
+
+/**
+ * @brief Render the delta frame of a client when its interval elapsed.
+ *
+ * @return length of the frame, 0 when the client is not due
+ */
+size_t telemetry_render(int client, uint32_t now_ms, char * frame, size_t size);
+
+#endif /* TELEMETRY_H_ */
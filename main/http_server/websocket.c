@@ -1,62 +1,164 @@
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <sys/param.h>
 #include <unistd.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
+#include "esp_timer.h"
+#include "cJSON.h"
 #include "websocket.h"
 #include "http_server.h"
+#include "telemetry.h"
 
 static const char * TAG = "websocket";
 
-static QueueHandle_t log_queue = NULL;
+// Log lines are appended to a byte ring by the logging tasks and drained
+// by the websocket task in batches, see log_to_ring
+#define LOG_RING_SIZE 8192
+#define LOG_LINE_MAX 256
+#define LOG_FRAME_SIZE 2048
+#define LOG_BATCH_LINES 64
+#define LOG_FLUSH_MS 50
+
+// Header word in front of every line, the payload is padded to whole words
+#define LOG_HEADER_COMMITTED (1u << 31)
+#define LOG_HEADER_LEN(header) (((header) >> 8) & 0xFFFF)
+#define LOG_HEADER_LEVEL(header) ((header) & 0xFF)
+#define LOG_ENTRY_SIZE(len) (sizeof(uint32_t) + (((len) + 3) & ~3u))
+
+static uint8_t log_ring[LOG_RING_SIZE] __attribute__((aligned(4)));
+static atomic_uint log_head;           // bytes reserved by writers, free running
+static atomic_uint log_tail;           // bytes consumed by the websocket task
+static atomic_uint log_dropped;        // lines not reported to the clients yet
+static atomic_uint log_dropped_total;
+
+static TaskHandle_t websocket_task_handle = NULL;
 static int clients[MAX_WEBSOCKET_CLIENTS];
+static esp_log_level_t client_levels[MAX_WEBSOCKET_CLIENTS]; // ESP_LOG_NONE turns the log lines off
 static int active_clients = 0;
 static SemaphoreHandle_t clients_mutex = NULL;
 
-int log_to_queue(const char *format, va_list args)
+// "\033[0;32mI (1234) tag: ..." or "I (1234) tag: ..."
+static esp_log_level_t parse_level(const char *line, size_t len)
 {
-    va_list args_copy;
-    va_copy(args_copy, args);
+    size_t i = 0;
+    if (len > 0 && line[0] == '\033') {
+        while (i < len && line[i] != 'm') {
+            i++;
+        }
+        i++;
+    }
+    if (i >= len) {
+        return ESP_LOG_INFO;
+    }
+    switch (line[i]) {
+        case 'E': return ESP_LOG_ERROR;
+        case 'W': return ESP_LOG_WARN;
+        case 'D': return ESP_LOG_DEBUG;
+        case 'V': return ESP_LOG_VERBOSE;
+        default:  return ESP_LOG_INFO;
+    }
+}
 
-    // Calculate the required buffer size +1 for \n
-    int needed_size = vsnprintf(NULL, 0, format, args_copy) + 1;
-    va_end(args_copy);
+static void ring_copy_in(uint32_t position, const void *src, size_t len)
+{
+    size_t offset = position % LOG_RING_SIZE;
+    size_t first = MIN(len, LOG_RING_SIZE - offset);
+    memcpy(&log_ring[offset], src, first);
+    memcpy(log_ring, (const uint8_t *)src + first, len - first);
+}
 
-    // Allocate the buffer dynamically
-    char *log_buffer = (char *)calloc(needed_size, sizeof(char));
-    if (log_buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for log buffer");
-        return 0;
+static void ring_copy_out(uint32_t position, void *dst, size_t len)
+{
+    size_t offset = position % LOG_RING_SIZE;
+    size_t first = MIN(len, LOG_RING_SIZE - offset);
+    memcpy(dst, &log_ring[offset], first);
+    memcpy((uint8_t *)dst + first, log_ring, len - first);
+}
+
+static void ring_clear(uint32_t position, size_t len)
+{
+    size_t offset = position % LOG_RING_SIZE;
+    size_t first = MIN(len, LOG_RING_SIZE - offset);
+    memset(&log_ring[offset], 0, first);
+    memset(log_ring, 0, len - first);
+}
+
+static atomic_uint *ring_header(uint32_t position)
+{
+    return (atomic_uint *)&log_ring[position % LOG_RING_SIZE];
+}
+
+// Any task may append, a line is reserved with a CAS on the head and
+// becomes visible to the reader once its header is committed
+static void log_ring_write(const char *line, size_t len)
+{
+    uint32_t size = LOG_ENTRY_SIZE(len);
+    uint32_t head = atomic_load_explicit(&log_head, memory_order_relaxed);
+    uint32_t used;
+    do {
+        used = head + size - atomic_load_explicit(&log_tail, memory_order_acquire);
+        if (used > LOG_RING_SIZE) {
+            atomic_fetch_add_explicit(&log_dropped, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&log_dropped_total, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&log_head, &head, head + size,
+                                                    memory_order_acquire, memory_order_relaxed));
+
+    ring_copy_in(head + sizeof(uint32_t), line, len);
+    atomic_store_explicit(ring_header(head), LOG_HEADER_COMMITTED | (len << 8) | parse_level(line, len),
+                          memory_order_release);
+
+    // Drain early when a burst fills half of the ring
+    if (used >= LOG_RING_SIZE / 2 && used - size < LOG_RING_SIZE / 2 && websocket_task_handle != NULL) {
+        xTaskNotifyGive(websocket_task_handle);
     }
+}
+
+int log_to_queue(const char *format, va_list args)
+{
+    char line[LOG_LINE_MAX];
 
-    // Format the string into the allocated buffer
+    va_list args_copy;
     va_copy(args_copy, args);
-    vsnprintf(log_buffer, needed_size, format, args_copy);
+    int needed = vsnprintf(line, sizeof(line) - 1, format, args_copy);
     va_end(args_copy);
+    if (needed <= 0) {
+        return 0;
+    }
 
-    // Ensure the log message ends with a newline
-    size_t len = strlen(log_buffer);
-    if (len > 0 && log_buffer[len - 1] != '\n') {
-        log_buffer[len] = '\n';
-        log_buffer[len + 1] = '\0';
+    // Long lines are cut for the clients, the console still gets all of them
+    bool truncated = (size_t)needed > sizeof(line) - 2;
+    size_t len = truncated ? sizeof(line) - 2 : needed;
+    if (line[len - 1] != '\n') {
+        line[len++] = '\n';
+    }
+    line[len] = '\0';
+
+    if (truncated) {
+        va_copy(args_copy, args);
+        vprintf(format, args_copy);
+        va_end(args_copy);
+    } else {
+        printf("%s", line);
     }
 
-    // Print to standard output
-    printf("%s", log_buffer);
+    log_ring_write(line, len);
 
-    // Send to queue for WebSocket broadcasting
-    if (xQueueSendToBack(log_queue, &log_buffer, pdMS_TO_TICKS(100)) != pdPASS) {
-        ESP_LOGW(TAG, "Failed to send log to queue, freeing buffer");
-        free(log_buffer);
-    }
+    return needed;
+}
 
-    return 0;
+uint32_t websocket_log_dropped_total(void)
+{
+    return atomic_load_explicit(&log_dropped_total, memory_order_relaxed);
 }
 
 static esp_err_t add_client(int fd)
@@ -74,6 +176,7 @@ static esp_err_t add_client(int fd)
             }
 
             clients[i] = fd;
+            client_levels[i] = ESP_LOG_VERBOSE;
             active_clients++;
             ESP_LOGI(TAG, "Added WebSocket client, fd: %d, slot: %d", fd, i);
             ret = ESP_OK;
@@ -98,6 +201,7 @@ static void remove_client(int fd)
     for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
         if (clients[i] == fd) {
             clients[i] = -1;
+            telemetry_unsubscribe(i);
             active_clients--;
             ESP_LOGI(TAG, "Removed WebSocket client, fd: %d, slot: %d", fd, i);
 
@@ -119,6 +223,51 @@ void websocket_close_fn(httpd_handle_t hd, int fd)
     close(fd);
 }
 
+static esp_log_level_t str_to_log_level(const char *level)
+{
+    if (strcmp(level, "none") == 0)  return ESP_LOG_NONE;
+    if (strcmp(level, "error") == 0) return ESP_LOG_ERROR;
+    if (strcmp(level, "warn") == 0)  return ESP_LOG_WARN;
+    if (strcmp(level, "info") == 0)  return ESP_LOG_INFO;
+    if (strcmp(level, "debug") == 0) return ESP_LOG_DEBUG;
+    return ESP_LOG_VERBOSE;
+}
+
+// {"telemetry": {"groups": [...], "intervalMs": 1000}, "logs": false, "logLevel": "warn"}
+static void handle_message(int fd, const char *message, size_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(message, len);
+    if (root == NULL) {
+        ESP_LOGW(TAG, "Ignoring invalid message from fd: %d", fd);
+        return;
+    }
+
+    if (xSemaphoreTake(clients_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+            if (clients[i] != fd) {
+                continue;
+            }
+
+            const cJSON *telemetry = cJSON_GetObjectItem(root, "telemetry");
+            if (cJSON_IsObject(telemetry)) {
+                telemetry_subscribe(i, telemetry);
+            }
+            const cJSON *logs = cJSON_GetObjectItem(root, "logs");
+            if (cJSON_IsBool(logs)) {
+                client_levels[i] = cJSON_IsTrue(logs) ? ESP_LOG_VERBOSE : ESP_LOG_NONE;
+            }
+            const cJSON *log_level = cJSON_GetObjectItem(root, "logLevel");
+            if (cJSON_IsString(log_level)) {
+                client_levels[i] = str_to_log_level(log_level->valuestring);
+            }
+            break;
+        }
+        xSemaphoreGive(clients_mutex);
+    }
+
+    cJSON_Delete(root);
+}
+
 esp_err_t websocket_handler(httpd_req_t *req)
 {
     if (is_network_allowed(req) != ESP_OK) {
@@ -189,23 +338,165 @@ esp_err_t websocket_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
-    // TODO: Handle incoming packets here
+    if (ws_pkt.type == HTTPD_WS_TYPE_TEXT) {
+        handle_message(httpd_req_to_sockfd(req), (const char *)buf, ws_pkt.len);
+    }
 
     free(buf);
     return ESP_OK;
 }
 
+static void send_telemetry(httpd_handle_t https_handle, uint32_t now_ms)
+{
+    static char frame[TELEMETRY_FRAME_SIZE];
+
+    if (xSemaphoreTake(clients_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    telemetry_sample(now_ms);
+    xSemaphoreGive(clients_mutex);
+
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (xSemaphoreTake(clients_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+            return;
+        }
+        int client_fd = clients[i];
+        size_t len = client_fd != -1 ? telemetry_render(i, now_ms, frame, sizeof(frame)) : 0;
+        xSemaphoreGive(clients_mutex);
+
+        if (len == 0) {
+            continue;
+        }
+
+        httpd_ws_frame_t ws_pkt;
+        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+        ws_pkt.payload = (uint8_t *)frame;
+        ws_pkt.len = len;
+        ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+
+        if (httpd_ws_send_frame_async(https_handle, client_fd, &ws_pkt) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to send telemetry frame to fd: %d", client_fd);
+            remove_client(client_fd);
+        }
+    }
+}
+
+typedef struct {
+    char text[LOG_FRAME_SIZE];
+    uint16_t len[LOG_BATCH_LINES];
+    uint8_t level[LOG_BATCH_LINES];
+    int count;
+    size_t size;
+} LogBatch;
+
+static void log_batch_add(LogBatch *batch, esp_log_level_t level, const char *line, size_t len)
+{
+    memcpy(&batch->text[batch->size], line, len);
+    batch->len[batch->count] = len;
+    batch->level[batch->count] = level;
+    batch->count++;
+    batch->size += len;
+}
+
+// Move committed lines from the ring into the batch, until it is full
+static void log_ring_read(LogBatch *batch)
+{
+    uint32_t tail = atomic_load_explicit(&log_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&log_head, memory_order_acquire);
+
+    while (tail != head && batch->count < LOG_BATCH_LINES) {
+        uint32_t header = atomic_load_explicit(ring_header(tail), memory_order_acquire);
+        if (!(header & LOG_HEADER_COMMITTED)) {
+            break; // still being written
+        }
+        size_t len = LOG_HEADER_LEN(header);
+        if (batch->size + len > LOG_FRAME_SIZE) {
+            break;
+        }
+
+        ring_copy_out(tail + sizeof(uint32_t), &batch->text[batch->size], len);
+        batch->len[batch->count] = len;
+        batch->level[batch->count] = LOG_HEADER_LEVEL(header);
+        batch->count++;
+        batch->size += len;
+
+        // A stale header must not look committed on the next lap
+        uint32_t size = LOG_ENTRY_SIZE(len);
+        ring_clear(tail, size);
+        tail += size;
+        atomic_store_explicit(&log_tail, tail, memory_order_release);
+    }
+}
+
+// One frame per log level in use, shared by all clients with that level
+static void send_logs(httpd_handle_t https_handle)
+{
+    static LogBatch batch;
+    static char frame[LOG_FRAME_SIZE];
+
+    uint32_t levels = 0;
+    for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+        if (clients[i] != -1 && client_levels[i] != ESP_LOG_NONE) {
+            levels |= 1 << client_levels[i];
+        }
+    }
+
+    do {
+        batch.count = 0;
+        batch.size = 0;
+
+        uint32_t dropped = atomic_exchange_explicit(&log_dropped, 0, memory_order_relaxed);
+        if (dropped > 0) {
+            char line[64];
+            int len = snprintf(line, sizeof(line), "W (%lu) %s: %lu log lines dropped\n",
+                               esp_log_timestamp(), TAG, dropped);
+            log_batch_add(&batch, ESP_LOG_WARN, line, len);
+        }
+        log_ring_read(&batch);
+
+        for (esp_log_level_t level = ESP_LOG_ERROR; level <= ESP_LOG_VERBOSE; level++) {
+            if (!(levels & (1 << level))) {
+                continue;
+            }
+
+            size_t len = 0;
+            size_t offset = 0;
+            for (int j = 0; j < batch.count; j++) {
+                if (batch.level[j] <= level) {
+                    memcpy(&frame[len], &batch.text[offset], batch.len[j]);
+                    len += batch.len[j];
+                }
+                offset += batch.len[j];
+            }
+            if (len == 0) {
+                continue;
+            }
+
+            httpd_ws_frame_t ws_pkt;
+            memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+            ws_pkt.payload = (uint8_t *)frame;
+            ws_pkt.len = len;
+            ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+
+            for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
+                int client_fd = clients[i];
+                if (client_fd != -1 && client_levels[i] == level) {
+                    if (httpd_ws_send_frame_async(https_handle, client_fd, &ws_pkt) != ESP_OK) {
+                        ESP_LOGW(TAG, "Failed to send WebSocket frame to fd: %d", client_fd);
+                        remove_client(client_fd);
+                    }
+                }
+            }
+        }
+    } while (batch.count == LOG_BATCH_LINES || batch.size > LOG_FRAME_SIZE - LOG_LINE_MAX);
+}
+
 void websocket_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "websocket_task starting");
     httpd_handle_t https_handle = (httpd_handle_t)pvParameters;
 
-    log_queue = xQueueCreate(MESSAGE_QUEUE_SIZE, sizeof(char*));
-    if (log_queue == NULL) {
-        ESP_LOGE(TAG, "Error creating queue");
-        vTaskDelete(NULL);
-        return;
-    }
+    websocket_task_handle = xTaskGetCurrentTaskHandle();
 
     memset(clients, -1, sizeof(clients));
 
@@ -214,33 +505,24 @@ void websocket_task(void *pvParameters)
         ESP_LOGE(TAG, "Failed to create clients mutex");
     }
 
+    uint32_t telemetry_tick_ms = 0;
+
     while (true) {
         if (active_clients == 0) {
             vTaskDelay(pdMS_TO_TICKS(100));
             continue;
         }
 
-        char *message;
-        if (xQueueReceive(log_queue, &message, pdMS_TO_TICKS(1000)) != pdPASS) {
-            continue;
+        // Log lines and telemetry ticks share this task
+        uint32_t now_ms = esp_timer_get_time() / 1000;
+        if (telemetry_is_active() && now_ms - telemetry_tick_ms >= TELEMETRY_TICK_MS) {
+            telemetry_tick_ms = now_ms;
+            send_telemetry(https_handle, now_ms);
         }
 
-        for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
-            int client_fd = clients[i];
-            if (client_fd != -1) {
-                httpd_ws_frame_t ws_pkt;
-                memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-                ws_pkt.payload = (uint8_t *)message;
-                ws_pkt.len = strlen(message);
-                ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-
-                if (httpd_ws_send_frame_async(https_handle, client_fd, &ws_pkt) != ESP_OK) {
-                    ESP_LOGW(TAG, "Failed to send WebSocket frame to fd: %d", client_fd);
-                    remove_client(client_fd);
-                }
-            }
-        }
+        send_logs(https_handle);
 
-        free(message);
+        // Lines written meanwhile go out together, unless the ring fills up
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOG_FLUSH_MS));
     }
 }
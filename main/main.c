@@ -7,11 +7,13 @@
 #include "asic_task.h"
 #include "create_jobs_task.h"
 #include "hashrate_monitor_task.h"
+#include "core_monitor.h"
 #include "statistics_task.h"
 #include "system.h"
 #include "http_server.h"
 #include "serial.h"
 #include "stratum_task.h"
+#include "mining_trace.h"
 #include "i2c_bitaxe.h"
 #include "adc.h"
 #include "nvs_device.h"
@@ -21,7 +23,9 @@
 #include "device_config.h"
 #include "connect.h"
 #include "asic_reset.h"
+#include "baud_tuning.h"
 #include "nonce_generator.h"
+#include "event_log.h"
 
 static GlobalState GLOBAL_STATE;
 
@@ -69,6 +73,7 @@ void app_main(void)
 
     SYSTEM_init_peripherals(&GLOBAL_STATE);
 
+    xTaskCreate(sensor_task, "sensor", 4096, (void *) &GLOBAL_STATE, 11, NULL);
     xTaskCreate(POWER_MANAGEMENT_task, "power management", 8192, (void *) &GLOBAL_STATE, 10, NULL);
 
     //start the API for AxeOS
@@ -104,17 +109,23 @@ void app_main(void)
         return;
     }
 
-    SERIAL_set_baud(ASIC_set_max_baud(&GLOBAL_STATE));
+    SERIAL_set_baud(BAUD_tune(&GLOBAL_STATE));
     SERIAL_clear_buffer();
 
     GLOBAL_STATE.ASIC_initalized = true;
 
+    core_monitor_init(&GLOBAL_STATE);
+
     // Initialize nonce generator
     // Default to SEQUENTIAL (backward compatible), or use PRIME_SKEW for experiment
     nonce_gen_strategy_t strategy = NONCE_GEN_SEQUENTIAL;
     nonce_generator_init(strategy);
     ESP_LOGI(TAG, "Nonce generator initialized with strategy %d", strategy);
 
+    // Mining hot paths record events, formatted in the background
+    event_log_init();
+    mining_trace_init(&GLOBAL_STATE);
+
     if (xTaskCreate(stratum_task, "stratum admin", 8192, (void *) &GLOBAL_STATE, 5, NULL) != pdPASS) {
         ESP_LOGE(TAG, "Error creating stratum admin task");
     }
@@ -130,6 +141,12 @@ void app_main(void)
     if (xTaskCreate(hashrate_monitor_task, "hashrate monitor", 4096, (void *) &GLOBAL_STATE, 5, NULL) != pdPASS) {
         ESP_LOGE(TAG, "Error creating hashrate monitor task");
     }
+    if (xTaskCreate(frequency_ramp_task, "frequency ramp", 4096, (void *) &GLOBAL_STATE, 10, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Error creating frequency ramp task");
+    }
+    if (xTaskCreate(autotune_task, "autotune", 4096, (void *) &GLOBAL_STATE, 5, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Error creating autotune task");
+    }
     if (xTaskCreate(statistics_task, "statistics", 8192, (void *) &GLOBAL_STATE, 3, NULL) != pdPASS) {
         ESP_LOGE(TAG, "Error creating statistics task");
     }
@@ -1,180 +1,589 @@
 #include "nvs_config.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "nvs.h"
+#include "nvs_flash.h"
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <string.h>
 
 #define NVS_CONFIG_NAMESPACE "main"
 
 #define FLOAT_STR_LEN 32
 
+#define CONFIG_CACHE_SIZE 128
+#define CONFIG_MAX_SUBSCRIBERS 64
+#define CONFIG_MAX_RETIRED 16
+
+// Changes are written in one transaction once a burst of them settled,
+// and never more often than the minimum interval to spare the flash
+#define CONFIG_WRITE_DELAY_MS 1000
+#define CONFIG_MIN_WRITE_INTERVAL_MS 5000
+
+// Keys that change all the time are only written with the periodic snapshot
+#define CONFIG_SNAPSHOT_INTERVAL_MS (10 * 60 * 1000)
+
 static const char * TAG = "nvs_config";
 
-char * nvs_config_get_string(const char * key, const char * default_value)
+static const char * const SNAPSHOT_KEYS[] = {
+    NVS_CONFIG_TOTAL_SHARES_ACCEPTED,
+    NVS_CONFIG_TOTAL_SHARES_REJECTED,
+    NVS_CONFIG_TOTAL_UPTIME,
+    NVS_CONFIG_TOTAL_ENERGY,
+};
+
+typedef union {
+    uint16_t u16;
+    int32_t i32;
+    uint64_t u64;
+    char * str;
+} config_value_t;
+
+// Every key of the namespace, loaded once at boot. Entries are only ever
+// appended, readers scan up to the published count without taking a lock.
+typedef struct {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    config_value_t value;
+    atomic_uint sequence; // odd while the value is being replaced
+    bool dirty;           // not written to NVS yet
+    bool snapshot;        // written with the periodic snapshot only
+} config_entry_t;
+
+typedef struct {
+    char key[NVS_KEY_NAME_MAX_SIZE]; // empty for every key
+    nvs_config_callback_t callback;
+    void * context;
+} config_subscriber_t;
+
+static config_entry_t entries[CONFIG_CACHE_SIZE];
+static atomic_int entry_count;
+
+static config_subscriber_t subscribers[CONFIG_MAX_SUBSCRIBERS];
+static atomic_int subscriber_count;
+
+// Replaced strings stay allocated until no reader can still be copying them
+static char * retired_strings[CONFIG_MAX_RETIRED];
+static int retired_count;
+static atomic_int string_readers;
+
+static portMUX_TYPE entry_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t write_mutex;
+static SemaphoreHandle_t flush_mutex;
+static TaskHandle_t writer_task;
+
+static config_entry_t * find_entry(const char * key)
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READONLY, &handle);
-    if (err != ESP_OK) {
-        return strdup(default_value);
+    int count = atomic_load_explicit(&entry_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
     }
+    return NULL;
+}
 
-    size_t size = 0;
-    err = nvs_get_str(handle, key, NULL, &size);
-
-    if (err != ESP_OK) {
-        nvs_close(handle);
-        return strdup(default_value);
+static bool read_value(const char * key, nvs_type_t type, config_value_t * out)
+{
+    config_entry_t * entry = find_entry(key);
+    if (entry == NULL) {
+        return false;
     }
 
-    char * out = malloc(size);
-    err = nvs_get_str(handle, key, out, &size);
+    while (true) {
+        unsigned begin = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        if (begin & 1) {
+            continue;
+        }
+        bool found = entry->type == type;
+        if (found) {
+            *out = entry->value;
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&entry->sequence, memory_order_relaxed) == begin) {
+            return found;
+        }
+    }
+}
 
-    if (err != ESP_OK) {
-        free(out);
-        nvs_close(handle);
-        return strdup(default_value);
+// Copies a string value into buffer, or into a new allocation when buffer is NULL
+static char * read_string(const char * key, char * buffer, size_t size)
+{
+    config_entry_t * entry = find_entry(key);
+    if (entry == NULL) {
+        return NULL;
     }
 
-    nvs_close(handle);
+    char * out = NULL;
+    atomic_fetch_add(&string_readers, 1);
+    while (true) {
+        unsigned begin = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        if (begin & 1) {
+            continue;
+        }
+        if (entry->type == NVS_TYPE_STR) {
+            const char * value = entry->value.str;
+            if (buffer == NULL) {
+                out = strdup(value);
+            } else {
+                strlcpy(buffer, value, size);
+                out = buffer;
+            }
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&entry->sequence, memory_order_relaxed) == begin) {
+            break;
+        }
+        if (out != buffer) {
+            free(out);
+        }
+        out = NULL;
+    }
+    atomic_fetch_sub(&string_readers, 1);
     return out;
 }
 
-void nvs_config_set_string(const char * key, const char * value)
+// Called with write_mutex held
+static void release_retired_strings(bool wait)
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not open nvs");
-        return;
+    atomic_thread_fence(memory_order_seq_cst);
+    while (atomic_load(&string_readers) != 0) {
+        if (!wait) {
+            return;
+        }
+        vTaskDelay(1);
     }
+    for (int i = 0; i < retired_count; i++) {
+        free(retired_strings[i]);
+    }
+    retired_count = 0;
+}
 
-    err = nvs_set_str(handle, key, value);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not write nvs key: %s, value: %s", key, value);
+static void retire_string(char * str)
+{
+    if (retired_count == CONFIG_MAX_RETIRED) {
+        release_retired_strings(true);
     }
+    retired_strings[retired_count++] = str;
+}
 
-    nvs_close(handle);
+static bool is_equal(const config_entry_t * entry, nvs_type_t type, const config_value_t * value)
+{
+    if (entry->type != type) {
+        return false;
+    }
+    switch (type) {
+        case NVS_TYPE_U16: return entry->value.u16 == value->u16;
+        case NVS_TYPE_I32: return entry->value.i32 == value->i32;
+        case NVS_TYPE_U64: return entry->value.u64 == value->u64;
+        case NVS_TYPE_STR: return strcmp(entry->value.str, value->str) == 0;
+        default: return false;
+    }
 }
 
-uint16_t nvs_config_get_u16(const char * key, const uint16_t default_value)
+// Called with write_mutex held, takes ownership of a string value
+static void publish(config_entry_t * entry, nvs_type_t type, config_value_t value, bool dirty)
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READONLY, &handle);
-    if (err != ESP_OK) {
-        return default_value;
+    char * old_str = entry->type == NVS_TYPE_STR ? entry->value.str : NULL;
+
+    portENTER_CRITICAL(&entry_spinlock);
+    atomic_fetch_add_explicit(&entry->sequence, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry->type = type;
+    entry->value = value;
+    entry->dirty = dirty;
+    atomic_fetch_add_explicit(&entry->sequence, 1, memory_order_release);
+    portEXIT_CRITICAL(&entry_spinlock);
+
+    if (old_str != NULL) {
+        retire_string(old_str);
     }
+}
 
-    uint16_t out;
-    err = nvs_get_u16(handle, key, &out);
-    nvs_close(handle);
+static bool is_snapshot_key(const char * key)
+{
+    for (int i = 0; i < sizeof(SNAPSHOT_KEYS) / sizeof(SNAPSHOT_KEYS[0]); i++) {
+        if (strcmp(SNAPSHOT_KEYS[i], key) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (err != ESP_OK) {
-        return default_value;
+// Called with write_mutex held
+static config_entry_t * add_entry(const char * key)
+{
+    int count = atomic_load_explicit(&entry_count, memory_order_relaxed);
+    if (count == CONFIG_CACHE_SIZE) {
+        ESP_LOGE(TAG, "Config cache full, dropping key: %s", key);
+        return NULL;
     }
-    return out;
+
+    config_entry_t * entry = &entries[count];
+    strlcpy(entry->key, key, sizeof(entry->key));
+    entry->type = NVS_TYPE_ANY;
+    entry->snapshot = is_snapshot_key(key);
+    atomic_store_explicit(&entry_count, count + 1, memory_order_release);
+    return entry;
 }
 
-void nvs_config_set_u16(const char * key, const uint16_t value)
+static void notify_subscribers(const char * key)
+{
+    int count = atomic_load_explicit(&subscriber_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        if (subscribers[i].key[0] == '\0' || strcmp(subscribers[i].key, key) == 0) {
+            subscribers[i].callback(key, subscribers[i].context);
+        }
+    }
+}
+
+static void store(const char * key, nvs_type_t type, config_value_t value)
+{
+    if (write_mutex == NULL) {
+        ESP_LOGW(TAG, "Config not initialized, dropping key: %s", key);
+        return;
+    }
+    if (strlen(key) >= NVS_KEY_NAME_MAX_SIZE) {
+        ESP_LOGW(TAG, "Key too long: %s", key);
+        return;
+    }
+
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+
+    config_entry_t * entry = find_entry(key);
+    if (entry == NULL) {
+        entry = add_entry(key);
+    }
+    bool changed = entry != NULL && !is_equal(entry, type, &value);
+    // Counters change on every poll, subscribers only hear about settings
+    bool write_now = changed && !entry->snapshot;
+    if (changed) {
+        if (type == NVS_TYPE_STR) {
+            value.str = strdup(value.str);
+        }
+        publish(entry, type, value, true);
+    }
+
+    xSemaphoreGive(write_mutex);
+
+    if (write_now) {
+        notify_subscribers(key);
+    }
+    if (write_now && writer_task != NULL) {
+        xTaskNotifyGive(writer_task);
+    }
+}
+
+static esp_err_t write_value(nvs_handle handle, const char * key, nvs_type_t type, const config_value_t * value)
 {
-    nvs_handle handle;
     esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    switch (type) {
+        case NVS_TYPE_U16:
+            err = nvs_set_u16(handle, key, value->u16);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Could not write nvs key: %s, value: %u", key, value->u16);
+            }
+            return err;
+        case NVS_TYPE_I32:
+            err = nvs_set_i32(handle, key, value->i32);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Could not write nvs key: %s, value: %li", key, value->i32);
+            }
+            return err;
+        case NVS_TYPE_U64:
+            err = nvs_set_u64(handle, key, value->u64);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Could not write nvs key: %s, value: %llu", key, value->u64);
+            }
+            return err;
+        case NVS_TYPE_STR:
+            err = nvs_set_str(handle, key, value->str);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Could not write nvs key: %s, value: %s", key, value->str);
+            }
+            return err;
+        default:
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+}
+
+// Writes the dirty entries and commits them in one go, snapshot keys only when all is set
+static void flush(bool all)
+{
+    if (flush_mutex == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+
+    nvs_handle handle;
+    esp_err_t err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
     if (err != ESP_OK) {
         ESP_LOGW(TAG, "Could not open nvs");
+        xSemaphoreGive(flush_mutex);
         return;
     }
 
-    err = nvs_set_u16(handle, key, value);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not write nvs key: %s, value: %u", key, value);
+    int written = 0;
+    int count = atomic_load_explicit(&entry_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        config_entry_t * entry = &entries[i];
+
+        // Copy under the lock, write without it so setters never wait on flash
+        xSemaphoreTake(write_mutex, portMAX_DELAY);
+        if (!entry->dirty || (entry->snapshot && !all)) {
+            xSemaphoreGive(write_mutex);
+            continue;
+        }
+        nvs_type_t type = entry->type;
+        config_value_t value = entry->value;
+        unsigned sequence = atomic_load_explicit(&entry->sequence, memory_order_relaxed);
+        if (type == NVS_TYPE_STR) {
+            value.str = strdup(value.str);
+        }
+        xSemaphoreGive(write_mutex);
+
+        // A failed write stays dirty for the next flush, and so does a value replaced meanwhile
+        if (write_value(handle, entry->key, type, &value) == ESP_OK) {
+            xSemaphoreTake(write_mutex, portMAX_DELAY);
+            if (atomic_load_explicit(&entry->sequence, memory_order_relaxed) == sequence) {
+                entry->dirty = false;
+            }
+            xSemaphoreGive(write_mutex);
+            written++;
+        }
+
+        if (type == NVS_TYPE_STR) {
+            free(value.str);
+        }
     }
 
+    if (written > 0) {
+        err = nvs_commit(handle);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Could not commit nvs");
+        }
+        ESP_LOGD(TAG, "Wrote %d config keys", written);
+    }
     nvs_close(handle);
+
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+    release_retired_strings(false);
+    xSemaphoreGive(write_mutex);
+
+    xSemaphoreGive(flush_mutex);
 }
 
-int32_t nvs_config_get_i32(const char * key, const int32_t default_value)
+static void nvs_config_task(void * pvParameters)
+{
+    TickType_t last_write = xTaskGetTickCount();
+    TickType_t last_snapshot = xTaskGetTickCount();
+
+    while (1) {
+        TickType_t snapshot_interval = CONFIG_SNAPSHOT_INTERVAL_MS / portTICK_PERIOD_MS;
+        TickType_t since_snapshot = xTaskGetTickCount() - last_snapshot;
+        TickType_t until_snapshot = since_snapshot < snapshot_interval ? snapshot_interval - since_snapshot : 0;
+
+        if (ulTaskNotifyTake(pdTRUE, until_snapshot) != 0) {
+            // Let the burst settle, the changes made meanwhile go in the same transaction
+            TickType_t min_interval = CONFIG_MIN_WRITE_INTERVAL_MS / portTICK_PERIOD_MS;
+            TickType_t since_write = xTaskGetTickCount() - last_write;
+            TickType_t delay = CONFIG_WRITE_DELAY_MS / portTICK_PERIOD_MS;
+            if (since_write + delay < min_interval) {
+                delay = min_interval - since_write;
+            }
+            vTaskDelay(delay);
+            ulTaskNotifyTake(pdTRUE, 0);
+        }
+
+        // A snapshot falling due during a burst goes out with it instead of waiting for a quiet moment
+        bool snapshot = xTaskGetTickCount() - last_snapshot >= snapshot_interval;
+        flush(snapshot);
+        last_write = xTaskGetTickCount();
+        if (snapshot) {
+            last_snapshot = last_write;
+        }
+    }
+}
+
+static esp_err_t load_value(nvs_handle handle, const nvs_entry_info_t * info, config_value_t * value)
+{
+    switch (info->type) {
+        case NVS_TYPE_U16:
+            return nvs_get_u16(handle, info->key, &value->u16);
+        case NVS_TYPE_I32:
+            return nvs_get_i32(handle, info->key, &value->i32);
+        case NVS_TYPE_U64:
+            return nvs_get_u64(handle, info->key, &value->u64);
+        case NVS_TYPE_STR: {
+            size_t size = 0;
+            esp_err_t err = nvs_get_str(handle, info->key, NULL, &size);
+            if (err != ESP_OK) {
+                return err;
+            }
+            value->str = malloc(size);
+            if (value->str == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+            err = nvs_get_str(handle, info->key, value->str, &size);
+            if (err != ESP_OK) {
+                free(value->str);
+            }
+            return err;
+        }
+        default:
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+}
+
+static void load_entries(void)
 {
     nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READONLY, &handle);
-    if (err != ESP_OK) {
-        return default_value;
+    if (nvs_open(NVS_CONFIG_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        // Nothing stored yet
+        return;
     }
 
-    int32_t out;
-    err = nvs_get_i32(handle, key, &out);
+    nvs_iterator_t it = NULL;
+    esp_err_t err = nvs_entry_find(NVS_DEFAULT_PART_NAME, NVS_CONFIG_NAMESPACE, NVS_TYPE_ANY, &it);
+    while (err == ESP_OK) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        config_value_t value;
+        if (load_value(handle, &info, &value) == ESP_OK) {
+            config_entry_t * entry = add_entry(info.key);
+            if (entry != NULL) {
+                publish(entry, info.type, value, false);
+            } else if (info.type == NVS_TYPE_STR) {
+                free(value.str);
+            }
+        } else {
+            ESP_LOGW(TAG, "Skipping nvs key: %s, type: %d", info.key, info.type);
+        }
+
+        err = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
     nvs_close(handle);
+}
 
-    if (err != ESP_OK) {
-        return default_value;
+static void nvs_config_shutdown(void)
+{
+    flush(true);
+}
+
+esp_err_t nvs_config_init(void)
+{
+    write_mutex = xSemaphoreCreateMutex();
+    flush_mutex = xSemaphoreCreateMutex();
+    if (write_mutex == NULL || flush_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
     }
-    return out;
+
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+    load_entries();
+    xSemaphoreGive(write_mutex);
+
+    ESP_LOGI(TAG, "Loaded %d config keys", atomic_load(&entry_count));
+
+    if (xTaskCreate(nvs_config_task, "nvs config", 4096, NULL, 3, &writer_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Pending writes must reach flash before esp_restart
+    return esp_register_shutdown_handler(nvs_config_shutdown);
 }
 
-void nvs_config_set_i32(const char * key, const int32_t value)
+esp_err_t nvs_config_subscribe(const char * key, nvs_config_callback_t callback, void * context)
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not open nvs");
-        return;
+    if (write_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    err = nvs_set_i32(handle, key, value);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not write nvs key: %s, value: %li", key, value);
+    xSemaphoreTake(write_mutex, portMAX_DELAY);
+
+    int count = atomic_load_explicit(&subscriber_count, memory_order_relaxed);
+    if (count == CONFIG_MAX_SUBSCRIBERS) {
+        xSemaphoreGive(write_mutex);
+        return ESP_ERR_NO_MEM;
     }
 
-    nvs_close(handle);
+    config_subscriber_t * subscriber = &subscribers[count];
+    strlcpy(subscriber->key, key != NULL ? key : "", sizeof(subscriber->key));
+    subscriber->callback = callback;
+    subscriber->context = context;
+    atomic_store_explicit(&subscriber_count, count + 1, memory_order_release);
+
+    xSemaphoreGive(write_mutex);
+    return ESP_OK;
 }
 
-uint64_t nvs_config_get_u64(const char * key, const uint64_t default_value)
+char * nvs_config_get_string(const char * key, const char * default_value)
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READONLY, &handle);
-    if (err != ESP_OK) {
-        return default_value;
+    char * out = read_string(key, NULL, 0);
+    if (out == NULL) {
+        return strdup(default_value);
     }
+    return out;
+}
 
-    uint64_t out;
-    err = nvs_get_u64(handle, key, &out);
+void nvs_config_set_string(const char * key, const char * value)
+{
+    store(key, NVS_TYPE_STR, (config_value_t) { .str = (char *) value });
+}
 
-    if (err != ESP_OK) {
-        nvs_close(handle);
+uint16_t nvs_config_get_u16(const char * key, const uint16_t default_value)
+{
+    config_value_t value;
+    if (!read_value(key, NVS_TYPE_U16, &value)) {
         return default_value;
     }
+    return value.u16;
+}
 
-    nvs_close(handle);
-    return out;
+void nvs_config_set_u16(const char * key, const uint16_t value)
+{
+    store(key, NVS_TYPE_U16, (config_value_t) { .u16 = value });
 }
 
-void nvs_config_set_u64(const char * key, const uint64_t value)
+int32_t nvs_config_get_i32(const char * key, const int32_t default_value)
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not open nvs");
-        return;
+    config_value_t value;
+    if (!read_value(key, NVS_TYPE_I32, &value)) {
+        return default_value;
     }
+    return value.i32;
+}
 
-    err = nvs_set_u64(handle, key, value);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not write nvs key: %s, value: %llu", key, value);
+void nvs_config_set_i32(const char * key, const int32_t value)
+{
+    store(key, NVS_TYPE_I32, (config_value_t) { .i32 = value });
+}
+
+uint64_t nvs_config_get_u64(const char * key, const uint64_t default_value)
+{
+    config_value_t value;
+    if (!read_value(key, NVS_TYPE_U64, &value)) {
+        return default_value;
     }
-    nvs_close(handle);
+    return value.u64;
 }
 
-float nvs_config_get_float(const char *key, float default_value)
+void nvs_config_set_u64(const char * key, const uint64_t value)
 {
-    char default_str[FLOAT_STR_LEN];
-    snprintf(default_str, sizeof(default_str), "%.6f", default_value);
+    store(key, NVS_TYPE_U64, (config_value_t) { .u64 = value });
+}
 
-    char *str_value = nvs_config_get_string(key, default_str);
+float nvs_config_get_float(const char *key, float default_value)
+{
+    char str_value[FLOAT_STR_LEN];
+    if (read_string(key, str_value, sizeof(str_value)) == NULL) {
+        return default_value;
+    }
 
     char *endptr;
     float value = strtof(str_value, &endptr);
@@ -183,7 +592,6 @@ float nvs_config_get_float(const char *key, float default_value)
         value = default_value;
     }
 
-    free(str_value);
     return value;
 }
 
@@ -197,17 +605,5 @@ void nvs_config_set_float(const char *key, float value)
 
 void nvs_config_commit()
 {
-    nvs_handle handle;
-    esp_err_t err;
-    err = nvs_open(NVS_CONFIG_NAMESPACE, NVS_READWRITE, &handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not open nvs");
-        return;
-    }
-
-    err = nvs_commit(handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Could not commit nvs");
-    }
-    nvs_close(handle);
+    flush(true);
 }
@@ -2,6 +2,7 @@
 #define MAIN_NVS_CONFIG_H
 
 #include <stdint.h>
+#include "esp_err.h"
 
 // Max length 15
 
@@ -24,6 +25,7 @@
 #define NVS_CONFIG_ASIC_FREQUENCY "asicfrequency"
 #define NVS_CONFIG_ASIC_FREQUENCY_FLOAT "asicfrequency_f"
 #define NVS_CONFIG_ASIC_VOLTAGE "asicvoltage"
+#define NVS_CONFIG_ASIC_CHIP_FREQUENCIES "chipfrequencies"
 #define NVS_CONFIG_ASIC_MODEL "asicmodel"
 #define NVS_CONFIG_DEVICE_MODEL "devicemodel"
 #define NVS_CONFIG_BOARD_VERSION "boardversion"
@@ -35,12 +37,26 @@
 #define NVS_CONFIG_FAN_SPEED "fanspeed"
 #define NVS_CONFIG_MIN_FAN_SPEED "minfanspeed"
 #define NVS_CONFIG_TEMP_TARGET "temptarget"
+#define NVS_CONFIG_POWER_LIMIT "powerlimit"
+#define NVS_CONFIG_DIE_TEMP_CONTROL "dietempctl"
+#define NVS_CONFIG_DIE_TEMP_TARGET "dietemptarget"
+#define NVS_CONFIG_FAN_FEED_FORWARD "fanfeedfwd"
 #define NVS_CONFIG_BEST_DIFF "bestdiff"
 #define NVS_CONFIG_SELF_TEST "selftest"
 #define NVS_CONFIG_OVERHEAT_MODE "overheat_mode"
+#define NVS_CONFIG_THROTTLE_LEVEL "throttlelevel"
 #define NVS_CONFIG_OVERCLOCK_ENABLED "oc_enabled"
 #define NVS_CONFIG_SWARM "swarmconfig"
 #define NVS_CONFIG_STATISTICS_FREQUENCY "statsFrequency"
+#define NVS_CONFIG_ASIC_BAUD "asicbaud"
+#define NVS_CONFIG_AUTOTUNE_PROGRESS "autotune"
+#define NVS_CONFIG_AUTOTUNE_RESULT "autotune_res"
+
+// Lifetime counters, written with the periodic snapshot only
+#define NVS_CONFIG_TOTAL_SHARES_ACCEPTED "totalaccepted"
+#define NVS_CONFIG_TOTAL_SHARES_REJECTED "totalrejected"
+#define NVS_CONFIG_TOTAL_UPTIME "totaluptime"
+#define NVS_CONFIG_TOTAL_ENERGY "totalenergy"
 
 // Theme configuration
 #define NVS_CONFIG_THEME_SCHEME "themescheme"
@@ -60,6 +76,31 @@
 #define NVS_CONFIG_TPS546 "TPS546"
 #define NVS_CONFIG_POWER_CONSUMPTION_TARGET "power_cons_tgt"
 
+/**
+ * @brief Called after a key changed, in the context of the task that set it.
+ *
+ * Must not block, e.g. notify the task that uses the key.
+ */
+typedef void (*nvs_config_callback_t)(const char * key, void * context);
+
+/**
+ * @brief Load every key of the namespace into RAM.
+ *
+ * Reads are served from RAM without locking, writes update RAM and are
+ * written to NVS by a background task in batches. The lifetime counters
+ * are only written every 10 minutes. Call once after nvs_flash_init.
+ */
+esp_err_t nvs_config_init(void);
+
+/**
+ * @brief Get called when a key changes.
+ *
+ * The lifetime counters change on every poll and notify nobody.
+ *
+ * @param key NULL for every key
+ */
+esp_err_t nvs_config_subscribe(const char * key, nvs_config_callback_t callback, void * context);
+
 char * nvs_config_get_string(const char * key, const char * default_value);
 void nvs_config_set_string(const char * key, const char * default_value);
 uint16_t nvs_config_get_u16(const char * key, const uint16_t default_value);
@@ -70,6 +111,7 @@ uint64_t nvs_config_get_u64(const char * key, const uint64_t default_value);
 void nvs_config_set_u64(const char * key, const uint64_t value);
 float nvs_config_get_float(const char *key, float default_value);
 void nvs_config_set_float(const char *key, float value);
+// Write pending changes to NVS before returning
 void nvs_config_commit(void);
 
 #endif // MAIN_NVS_CONFIG_H
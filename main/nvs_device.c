@@ -16,5 +16,8 @@ esp_err_t NVSDevice_init(void) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         err = nvs_flash_init();
     }
-    return err;
+    if (err != ESP_OK) {
+        return err;
+    }
+    return nvs_config_init();
 }
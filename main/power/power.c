@@ -56,6 +56,27 @@ float Power_get_input_voltage(GlobalState * GLOBAL_STATE)
     return 0.0;
 }
 
+void Power_get_readings(GlobalState * GLOBAL_STATE, float * voltage, float * current, float * power)
+{
+    *voltage = 0.0;
+    *current = 0.0;
+    *power = 0.0;
+
+    // Same values as the single getters, but every register is read only once
+    if (GLOBAL_STATE->DEVICE_CONFIG.TPS546) {
+        *voltage = TPS546_get_vin() * 1000.0;
+        *current = TPS546_get_iout() * 1000.0;
+        *power = (TPS546_get_vout() * *current) / 1000.0 + GLOBAL_STATE->DEVICE_CONFIG.family.power_offset;
+    }
+    if (GLOBAL_STATE->DEVICE_CONFIG.INA260) {
+        if (INA260_installed() == true) {
+            *voltage = INA260_read_voltage();
+            *current = INA260_read_current();
+            *power = INA260_read_power() / 1000.0;
+        }
+    }
+}
+
 float Power_get_vreg_temp(GlobalState * GLOBAL_STATE)
 {
     if (GLOBAL_STATE->DEVICE_CONFIG.TPS546) {
@@ -7,6 +7,8 @@
 float Power_get_current(GlobalState * GLOBAL_STATE);
 float Power_get_power(GlobalState * GLOBAL_STATE);
 float Power_get_input_voltage(GlobalState * GLOBAL_STATE);
+// Input voltage in mV, current in mA and power in W in one pass over the bus
+void Power_get_readings(GlobalState * GLOBAL_STATE, float * voltage, float * current, float * power);
 float Power_get_vreg_temp(GlobalState * GLOBAL_STATE);
 
 #endif // POWER_H
@@ -0,0 +1,161 @@
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "global_state.h"
+#include "power_telemetry.h"
+
+static const char * TAG = "power_telemetry";
+
+// Guards the finished summaries and capture against readers copying them
+static portMUX_TYPE telemetry_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static void stat_add(power_stat_t * stat, float value, uint16_t count)
+{
+    if (count == 0) {
+        stat->min = value;
+        stat->max = value;
+        stat->mean = value;
+        return;
+    }
+
+    if (value < stat->min) stat->min = value;
+    if (value > stat->max) stat->max = value;
+    stat->mean += (value - stat->mean) / (count + 1);
+}
+
+static void summarize(PowerTelemetryModule * telemetry, const power_sample_t * sample)
+{
+    power_summary_t * summary = &telemetry->summary;
+
+    if (summary->count == 0) {
+        summary->time_ms = sample->time_ms;
+    }
+    stat_add(&summary->input_voltage, sample->input_voltage, summary->count);
+    stat_add(&summary->current, sample->current, summary->count);
+    stat_add(&summary->power, sample->power, summary->count);
+    stat_add(&summary->core_voltage, sample->core_voltage, summary->count);
+    summary->count++;
+
+    if (summary->count < POWER_TELEMETRY_DECIMATION) {
+        return;
+    }
+
+    portENTER_CRITICAL(&telemetry_spinlock);
+    telemetry->summaries[telemetry->summary_index] = *summary;
+    telemetry->summary_index = (telemetry->summary_index + 1) % POWER_TELEMETRY_SUMMARY_SIZE;
+    if (telemetry->summary_count < POWER_TELEMETRY_SUMMARY_SIZE) {
+        telemetry->summary_count++;
+    }
+    portEXIT_CRITICAL(&telemetry_spinlock);
+
+    summary->count = 0;
+}
+
+static void finish_capture(PowerTelemetryModule * telemetry)
+{
+    uint32_t first = telemetry->trigger_sample >= POWER_TELEMETRY_PRE_SAMPLES ? telemetry->trigger_sample - POWER_TELEMETRY_PRE_SAMPLES : 0;
+    uint32_t count = telemetry->sample_count - first;
+    power_capture_t * capture = &telemetry->capture;
+
+    portENTER_CRITICAL(&telemetry_spinlock);
+    capture->trigger = telemetry->capture_trigger;
+    capture->trigger_time_ms = telemetry->ring[telemetry->trigger_sample % POWER_TELEMETRY_RING_SIZE].time_ms;
+    capture->trigger_index = telemetry->trigger_sample - first;
+    capture->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        capture->samples[i] = telemetry->ring[(first + i) % POWER_TELEMETRY_RING_SIZE];
+    }
+    telemetry->capture_state = POWER_CAPTURE_DONE;
+    portEXIT_CRITICAL(&telemetry_spinlock);
+
+    ESP_LOGI(TAG, "Captured %lu samples around a %s trigger", count, Power_telemetry_get_trigger_string(capture->trigger));
+}
+
+void Power_telemetry_add_sample(void * pvParameters, const power_sample_t * sample)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    PowerTelemetryModule * telemetry = &GLOBAL_STATE->POWER_TELEMETRY_MODULE;
+
+    uint32_t index = telemetry->sample_count;
+    telemetry->ring[index % POWER_TELEMETRY_RING_SIZE] = *sample;
+    telemetry->sample_count = index + 1;
+
+    summarize(telemetry, sample);
+
+    if (telemetry->capture_state != POWER_CAPTURE_RECORDING && telemetry->pending_trigger != POWER_TRIGGER_NONE) {
+        // The capture of the previous trigger stays readable until this one is done
+        telemetry->capture_trigger = telemetry->pending_trigger;
+        telemetry->pending_trigger = POWER_TRIGGER_NONE;
+        telemetry->trigger_sample = index;
+        telemetry->capture_state = POWER_CAPTURE_RECORDING;
+    }
+
+    if (telemetry->capture_state == POWER_CAPTURE_RECORDING
+        && telemetry->sample_count - telemetry->trigger_sample >= POWER_TELEMETRY_POST_SAMPLES) {
+        finish_capture(telemetry);
+    }
+}
+
+void Power_telemetry_trigger(void * pvParameters, power_trigger_t trigger)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    PowerTelemetryModule * telemetry = &GLOBAL_STATE->POWER_TELEMETRY_MODULE;
+
+    if (telemetry->capture_state == POWER_CAPTURE_RECORDING || telemetry->pending_trigger != POWER_TRIGGER_NONE) {
+        return;
+    }
+    telemetry->pending_trigger = trigger;
+}
+
+bool Power_telemetry_get_capture(void * pvParameters, power_capture_t * capture)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    PowerTelemetryModule * telemetry = &GLOBAL_STATE->POWER_TELEMETRY_MODULE;
+
+    portENTER_CRITICAL(&telemetry_spinlock);
+    bool captured = telemetry->capture.count > 0;
+    if (captured) {
+        memcpy(capture, &telemetry->capture, sizeof(power_capture_t));
+    }
+    portEXIT_CRITICAL(&telemetry_spinlock);
+
+    return captured;
+}
+
+int Power_telemetry_get_summaries(void * pvParameters, power_summary_t * summaries, int max_count)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    PowerTelemetryModule * telemetry = &GLOBAL_STATE->POWER_TELEMETRY_MODULE;
+
+    portENTER_CRITICAL(&telemetry_spinlock);
+    int count = telemetry->summary_count < max_count ? telemetry->summary_count : max_count;
+    int oldest = (telemetry->summary_index + POWER_TELEMETRY_SUMMARY_SIZE - count) % POWER_TELEMETRY_SUMMARY_SIZE;
+    for (int i = 0; i < count; i++) {
+        summaries[i] = telemetry->summaries[(oldest + i) % POWER_TELEMETRY_SUMMARY_SIZE];
+    }
+    portEXIT_CRITICAL(&telemetry_spinlock);
+
+    return count;
+}
+
+const char * Power_telemetry_get_trigger_string(power_trigger_t trigger)
+{
+    switch (trigger) {
+        case POWER_TRIGGER_MANUAL: return "manual";
+        case POWER_TRIGGER_FAULT: return "fault";
+        case POWER_TRIGGER_FREQUENCY: return "frequency";
+        case POWER_TRIGGER_VOLTAGE: return "voltage";
+        case POWER_TRIGGER_NONE:
+        default: return "none";
+    }
+}
+
+const char * Power_telemetry_get_capture_state_string(power_capture_state_t state)
+{
+    switch (state) {
+        case POWER_CAPTURE_RECORDING: return "recording";
+        case POWER_CAPTURE_DONE: return "done";
+        case POWER_CAPTURE_IDLE:
+        default: return "idle";
+    }
+}
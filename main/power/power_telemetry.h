@@ -0,0 +1,109 @@
+#ifndef POWER_TELEMETRY_H_
+#define POWER_TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define POWER_TELEMETRY_PERIOD_MS 50
+
+// Raw samples, enough for a capture window
+#define POWER_TELEMETRY_RING_SIZE 256
+
+// Capture window around a trigger
+#define POWER_TELEMETRY_PRE_SAMPLES 64
+#define POWER_TELEMETRY_POST_SAMPLES 128
+#define POWER_TELEMETRY_CAPTURE_SIZE (POWER_TELEMETRY_PRE_SAMPLES + POWER_TELEMETRY_POST_SAMPLES)
+
+// One summary per second over the last minute
+#define POWER_TELEMETRY_DECIMATION 20
+#define POWER_TELEMETRY_SUMMARY_SIZE 60
+
+typedef enum {
+    POWER_TRIGGER_NONE = 0,
+    POWER_TRIGGER_MANUAL,
+    POWER_TRIGGER_FAULT,
+    POWER_TRIGGER_FREQUENCY,
+    POWER_TRIGGER_VOLTAGE,
+} power_trigger_t;
+
+typedef enum {
+    POWER_CAPTURE_IDLE = 0,
+    POWER_CAPTURE_RECORDING,     // waiting for the samples after the trigger
+    POWER_CAPTURE_DONE,
+} power_capture_state_t;
+
+typedef struct {
+    uint32_t time_ms;
+    float input_voltage;         // mV
+    float current;               // mA
+    float power;                 // W
+    float core_voltage;          // mV
+} power_sample_t;
+
+typedef struct {
+    float min;
+    float max;
+    float mean;
+} power_stat_t;
+
+typedef struct {
+    uint32_t time_ms;            // first sample
+    uint16_t count;
+    power_stat_t input_voltage;
+    power_stat_t current;
+    power_stat_t power;
+    power_stat_t core_voltage;
+} power_summary_t;
+
+typedef struct {
+    power_trigger_t trigger;
+    uint32_t trigger_time_ms;
+    uint16_t trigger_index;      // index of the trigger sample in samples
+    uint16_t count;
+    power_sample_t samples[POWER_TELEMETRY_CAPTURE_SIZE];
+} power_capture_t;
+
+typedef struct {
+    power_sample_t ring[POWER_TELEMETRY_RING_SIZE];
+    uint32_t sample_count;       // since boot, the ring index is this modulo the size
+    power_summary_t summaries[POWER_TELEMETRY_SUMMARY_SIZE]; // ring buffer
+    uint8_t summary_index;
+    uint8_t summary_count;
+    power_summary_t summary;     // being accumulated
+    power_capture_state_t capture_state;
+    power_trigger_t pending_trigger;
+    power_trigger_t capture_trigger; // of the capture being recorded
+    uint32_t trigger_sample;
+    power_capture_t capture;
+} PowerTelemetryModule;
+
+/**
+ * @brief Add a sample of the sensor task to the ring, the summaries and the capture.
+ */
+void Power_telemetry_add_sample(void * pvParameters, const power_sample_t * sample);
+
+/**
+ * @brief Capture the samples before and after this moment.
+ *
+ * Ignored while a capture is still recording, the earlier trigger wins.
+ */
+void Power_telemetry_trigger(void * pvParameters, power_trigger_t trigger);
+
+/**
+ * @brief Copy the last finished capture.
+ *
+ * @return false when nothing was captured yet
+ */
+bool Power_telemetry_get_capture(void * pvParameters, power_capture_t * capture);
+
+/**
+ * @brief Copy the summaries, oldest first.
+ *
+ * @return number of summaries copied
+ */
+int Power_telemetry_get_summaries(void * pvParameters, power_summary_t * summaries, int max_count);
+
+const char * Power_telemetry_get_trigger_string(power_trigger_t trigger);
+const char * Power_telemetry_get_capture_state_string(power_capture_state_t state);
+
+#endif /* POWER_TELEMETRY_H_ */
@@ -49,6 +49,10 @@ void SYSTEM_init_system(GlobalState * GLOBAL_STATE)
     module->screen_page = 0;
     module->shares_accepted = 0;
     module->shares_rejected = 0;
+    module->total_shares_accepted = nvs_config_get_u64(NVS_CONFIG_TOTAL_SHARES_ACCEPTED, 0);
+    module->total_shares_rejected = nvs_config_get_u64(NVS_CONFIG_TOTAL_SHARES_REJECTED, 0);
+    module->total_uptime_base = nvs_config_get_u64(NVS_CONFIG_TOTAL_UPTIME, 0);
+    module->total_energy = nvs_config_get_u64(NVS_CONFIG_TOTAL_ENERGY, 0);
     module->best_nonce_diff = nvs_config_get_u64(NVS_CONFIG_BEST_DIFF, 0);
     module->best_session_nonce_diff = 0;
     module->start_time = esp_timer_get_time();
@@ -131,6 +135,25 @@ void SYSTEM_notify_accepted_share(GlobalState * GLOBAL_STATE)
     SystemModule * module = &GLOBAL_STATE->SYSTEM_MODULE;
 
     module->shares_accepted++;
+    module->total_shares_accepted++;
+}
+
+void SYSTEM_update_totals(GlobalState * GLOBAL_STATE)
+{
+    SystemModule * module = &GLOBAL_STATE->SYSTEM_MODULE;
+
+    // Only kept in RAM, the config store writes them every few minutes
+    nvs_config_set_u64(NVS_CONFIG_TOTAL_SHARES_ACCEPTED, module->total_shares_accepted);
+    nvs_config_set_u64(NVS_CONFIG_TOTAL_SHARES_REJECTED, module->total_shares_rejected);
+    nvs_config_set_u64(NVS_CONFIG_TOTAL_UPTIME, SYSTEM_get_total_uptime(GLOBAL_STATE));
+    nvs_config_set_u64(NVS_CONFIG_TOTAL_ENERGY, (uint64_t) module->total_energy);
+}
+
+uint64_t SYSTEM_get_total_uptime(GlobalState * GLOBAL_STATE)
+{
+    SystemModule * module = &GLOBAL_STATE->SYSTEM_MODULE;
+
+    return module->total_uptime_base + (esp_timer_get_time() - module->start_time) / 1000000;
 }
 
 static int compare_rejected_reason_stats(const void *a, const void *b) {
@@ -144,6 +167,7 @@ void SYSTEM_notify_rejected_share(GlobalState * GLOBAL_STATE, char * error_msg)
     SystemModule * module = &GLOBAL_STATE->SYSTEM_MODULE;
 
     module->shares_rejected++;
+    module->total_shares_rejected++;
 
     for (int i = 0; i < module->rejected_reason_stats_count; i++) {
         if (strncmp(module->rejected_reason_stats[i].message, error_msg, sizeof(module->rejected_reason_stats[i].message) - 1) == 0) {
@@ -190,6 +214,23 @@ void SYSTEM_notify_new_ntime(GlobalState * GLOBAL_STATE, uint32_t ntime)
     settimeofday(&tv, NULL);
 }
 
+const uint16_t SYSTEM_response_time_bounds[RESPONSE_TIME_BUCKET_COUNT - 1] = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000 };
+
+void SYSTEM_notify_response_time(GlobalState * GLOBAL_STATE, double response_time_ms)
+{
+    SystemModule * module = &GLOBAL_STATE->SYSTEM_MODULE;
+
+    int bucket = 0;
+    while (bucket < RESPONSE_TIME_BUCKET_COUNT - 1 && response_time_ms > SYSTEM_response_time_bounds[bucket]) {
+        bucket++;
+    }
+
+    module->response_time = response_time_ms;
+    module->response_time_buckets[bucket]++;
+    module->response_time_count++;
+    module->response_time_sum += response_time_ms;
+}
+
 void SYSTEM_notify_found_nonce(GlobalState * GLOBAL_STATE, double found_diff, uint8_t job_id)
 {
     SystemModule * module = &GLOBAL_STATE->SYSTEM_MODULE;
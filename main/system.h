@@ -24,5 +24,13 @@ void SYSTEM_notify_rejected_share(GlobalState * GLOBAL_STATE, char * error_msg);
 void SYSTEM_notify_found_nonce(GlobalState * GLOBAL_STATE, double found_diff, uint8_t job_id);
 void SYSTEM_notify_mining_started(GlobalState * GLOBAL_STATE);
 void SYSTEM_notify_new_ntime(GlobalState * GLOBAL_STATE, uint32_t ntime);
+void SYSTEM_notify_response_time(GlobalState * GLOBAL_STATE, double response_time_ms);
+
+// Upper bounds of the response time buckets in ms
+extern const uint16_t SYSTEM_response_time_bounds[RESPONSE_TIME_BUCKET_COUNT - 1];
+
+// Store the lifetime counters, cheap enough to call on every poll
+void SYSTEM_update_totals(GlobalState * GLOBAL_STATE);
+uint64_t SYSTEM_get_total_uptime(GlobalState * GLOBAL_STATE);
 
 #endif /* SYSTEM_H_ */
@@ -9,7 +9,11 @@
 #include "utils.h"
 #include "stratum_task.h"
 #include "hashrate_monitor_task.h"
+#include "core_monitor.h"
 #include "asic.h"
+#include "event_log.h"
+#include "esp_timer.h"
+#include "mining_trace.h"
 
 static const char *TAG = "asic_result";
 
@@ -21,6 +25,7 @@ void ASIC_result_task(void *pvParameters)
     {
         //task_result *asic_result = (*GLOBAL_STATE->ASIC_functions.receive_result_fn)(GLOBAL_STATE);
         task_result *asic_result = ASIC_process_work(GLOBAL_STATE);
+        int64_t received_us = esp_timer_get_time();
 
         if (asic_result == NULL)
         {
@@ -40,19 +45,29 @@ void ASIC_result_task(void *pvParameters)
             continue;
         }
 
+        uint32_t trace_id = mining_trace_result_received(received_us);
+
+        core_monitor_nonce_found(GLOBAL_STATE, asic_result->asic_nr, asic_result->core_id, asic_result->small_core_id);
+
         bm_job *active_job = GLOBAL_STATE->ASIC_TASK_MODULE.active_jobs[job_id];
         // check the nonce difficulty
         double nonce_diff = test_nonce_value(active_job, asic_result->nonce, asic_result->rolled_version);
+        mining_trace_result_verified(trace_id);
 
-        //log the ASIC response
-        ESP_LOGI(TAG, "ID: %s, ver: %08" PRIX32 " Nonce %08" PRIX32 " diff %.1f of %ld.", active_job->jobid, asic_result->rolled_version, asic_result->nonce, nonce_diff, active_job->pool_diff);
+        //log the ASIC response, the job may be freed before the record is printed
+        uint32_t pool_job[EVENT_LOG_STRING_WORDS];
+        event_log_string(active_job->jobid, pool_job);
+        EVENT_LOG(EVENT_RESULT_NONCE, job_id, asic_result->rolled_version, asic_result->nonce,
+                  event_log_float(nonce_diff), active_job->pool_diff,
+                  pool_job[0], pool_job[1], pool_job[2], pool_job[3]);
 
         if (nonce_diff >= active_job->pool_diff)
         {
             char * user = GLOBAL_STATE->SYSTEM_MODULE.is_using_fallback ? GLOBAL_STATE->SYSTEM_MODULE.fallback_pool_user : GLOBAL_STATE->SYSTEM_MODULE.pool_user;
+            int message_id = GLOBAL_STATE->send_uid++;
             int ret = STRATUM_V1_submit_share(
                 GLOBAL_STATE->sock,
-                GLOBAL_STATE->send_uid++,
+                message_id,
                 user,
                 active_job->jobid,
                 active_job->extranonce2,
@@ -63,6 +78,8 @@ void ASIC_result_task(void *pvParameters)
             if (ret < 0) {
                 ESP_LOGI(TAG, "Unable to write share to socket. Closing connection. Ret: %d (errno %d: %s)", ret, errno, strerror(errno));
                 stratum_close_connection(GLOBAL_STATE);
+            } else {
+                mining_trace_share_sent(trace_id, message_id);
             }
         }
 
@@ -8,6 +8,7 @@
 #include "freertos/task.h"
 
 #include "asic.h"
+#include "mining_trace.h"
 
 static const char *TAG = "asic_task";
 
@@ -37,9 +38,11 @@ void ASIC_task(void *pvParameters)
     while (1)
     {
         bm_job *next_bm_job = (bm_job *)queue_dequeue(&GLOBAL_STATE->ASIC_jobs_queue);
+        uint32_t trace_id = next_bm_job->trace_id;
 
         //(*GLOBAL_STATE->ASIC_functions.send_work_fn)(GLOBAL_STATE, next_bm_job); // send the job to the ASIC
         ASIC_send_work(GLOBAL_STATE, next_bm_job);
+        mining_trace_job_sent(trace_id);
 
         // Time to execute the above code is ~0.3ms
         // Delay for ASIC(s) to finish the job
@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "global_state.h"
+#include "nvs_config.h"
+#include "autotune.h"
+#include "autotune_task.h"
+
+#define FREQUENCY_STEP 25.0  // MHz
+#define VOLTAGE_STEP 25      // mV
+
+#define MAX_ERROR_PERCENT 1.0
+#define MIN_HASHRATE_RATIO 0.9
+
+// Stay below the overheat limits of the power management task
+#define MAX_CHIP_TEMP 70.0
+#define MAX_VR_TEMP 95.0
+
+#define RAMP_TIMEOUT_MS 60000
+#define SETTLE_MS 15000
+#define SAMPLE_MS 5000       // hash counter registers are read every 5 s
+#define SAMPLE_COUNT 12
+
+static const char * TAG = "autotune";
+
+static TaskHandle_t autotune_task_handle;
+
+static void get_config(GlobalState * GLOBAL_STATE, autotune_goal_t goal, float power_cap, autotune_config_t * config)
+{
+    const AsicConfig * asic = &GLOBAL_STATE->DEVICE_CONFIG.family.asic;
+
+    memset(config, 0, sizeof(autotune_config_t));
+    config->goal = goal;
+    config->power_cap = power_cap;
+    config->frequency_step = FREQUENCY_STEP;
+    config->voltage_step = VOLTAGE_STEP;
+    config->max_error_percent = MAX_ERROR_PERCENT;
+    config->min_hashrate_ratio = MIN_HASHRATE_RATIO;
+    config->max_chip_temp = MAX_CHIP_TEMP;
+    config->max_vr_temp = MAX_VR_TEMP;
+    config->ghs_per_mhz = asic->small_core_count * GLOBAL_STATE->DEVICE_CONFIG.family.asic_count / 1000.0f;
+
+    // The option tables hold the safe bounds of the search
+    config->frequency_min = asic->frequency_options[0];
+    for (int i = 0; asic->frequency_options[i] != 0; i++) {
+        config->frequency_max = asic->frequency_options[i];
+    }
+    config->voltage_min = asic->voltage_options[0];
+    for (int i = 0; asic->voltage_options[i] != 0; i++) {
+        config->voltage_max = asic->voltage_options[i];
+    }
+}
+
+// Saved with the marker set before a point is measured and cleared once it was reported,
+// so a point that crashes the board is not measured again after the reset
+static void save_progress(AutotuneModule * AUTOTUNE_MODULE, bool in_measurement)
+{
+    const autotune_t * autotune = &AUTOTUNE_MODULE->autotune;
+    const autotune_progress_t * progress = &autotune->progress;
+    char str[128];
+
+    snprintf(str, sizeof(str), "%d,%g,%g,%u,%g,%u,%g,%u,%g,%g,%d,%d",
+             autotune->config.goal, autotune->config.power_cap,
+             AUTOTUNE_MODULE->original_frequency, AUTOTUNE_MODULE->original_voltage,
+             progress->point.frequency, progress->point.voltage,
+             progress->best.frequency, progress->best.voltage,
+             progress->best_hashrate, progress->best_power, progress->has_best,
+             in_measurement);
+    nvs_config_set_string(NVS_CONFIG_AUTOTUNE_PROGRESS, str);
+    nvs_config_commit();
+}
+
+static bool load_progress(GlobalState * GLOBAL_STATE)
+{
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+    autotune_config_t config;
+    autotune_progress_t progress = { 0 };
+    int goal, has_best, in_measurement = 0;
+    unsigned int original_voltage, voltage, best_voltage;
+    float power_cap;
+
+    char * str = nvs_config_get_string(NVS_CONFIG_AUTOTUNE_PROGRESS, "");
+    int count = sscanf(str, "%d,%f,%f,%u,%f,%u,%f,%u,%f,%f,%d,%d",
+                       &goal, &power_cap,
+                       &AUTOTUNE_MODULE->original_frequency, &original_voltage,
+                       &progress.point.frequency, &voltage,
+                       &progress.best.frequency, &best_voltage,
+                       &progress.best_hashrate, &progress.best_power, &has_best,
+                       &in_measurement);
+    free(str);
+
+    // Progress saved before the marker was added has 11 fields
+    if (count != 11 && count != 12) {
+        return false;
+    }
+
+    AUTOTUNE_MODULE->original_voltage = original_voltage;
+    progress.point.voltage = voltage;
+    progress.best.voltage = best_voltage;
+    progress.has_best = has_best;
+    progress.in_measurement = in_measurement;
+
+    get_config(GLOBAL_STATE, goal, power_cap, &config);
+    autotune_resume(&AUTOTUNE_MODULE->autotune, &config, &progress);
+    return true;
+}
+
+static void apply_point(float frequency, uint16_t voltage)
+{
+    // Applied by the power management task, the frequency is ramped
+    nvs_config_set_u16(NVS_CONFIG_ASIC_VOLTAGE, voltage);
+    nvs_config_set_u16(NVS_CONFIG_ASIC_FREQUENCY, (uint16_t) frequency);
+    nvs_config_set_float(NVS_CONFIG_ASIC_FREQUENCY_FLOAT, frequency);
+}
+
+static bool wait_for_frequency(GlobalState * GLOBAL_STATE, float frequency)
+{
+    for (int elapsed_ms = 0; elapsed_ms < RAMP_TIMEOUT_MS; elapsed_ms += 1000) {
+        if (GLOBAL_STATE->AUTOTUNE_MODULE.abort_requested) {
+            return false;
+        }
+        if (!GLOBAL_STATE->FREQUENCY_RAMP_MODULE.is_ramping && GLOBAL_STATE->POWER_MANAGEMENT_MODULE.frequency_value == frequency) {
+            return true;
+        }
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    }
+    return false;
+}
+
+static float sum_register_hashrate(measurement_t * measurement, int asic_count)
+{
+    float total = 0;
+    for (int i = 0; i < asic_count; i++) {
+        total += measurement[i].hashrate;
+    }
+    return total;
+}
+
+static void measure(GlobalState * GLOBAL_STATE, autotune_point_t point, autotune_measurement_t * measurement)
+{
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+    PowerManagementModule * POWER_MANAGEMENT_MODULE = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+    HashrateMonitorModule * HASHRATE_MONITOR_MODULE = &GLOBAL_STATE->HASHRATE_MONITOR_MODULE;
+    int asic_count = GLOBAL_STATE->DEVICE_CONFIG.family.asic_count;
+
+    memset(measurement, 0, sizeof(autotune_measurement_t));
+
+    apply_point(point.frequency, point.voltage);
+
+    // A ramp that does not reach the frequency counts as unstable
+    if (!wait_for_frequency(GLOBAL_STATE, point.frequency)) {
+        measurement->error_percent = 100;
+        return;
+    }
+
+    vTaskDelay(SETTLE_MS / portTICK_PERIOD_MS);
+
+    float hashrate = 0;
+    float error_hashrate = 0;
+    float power = 0;
+
+    for (int i = 0; i < SAMPLE_COUNT && !AUTOTUNE_MODULE->abort_requested; i++) {
+        vTaskDelay(SAMPLE_MS / portTICK_PERIOD_MS);
+
+        hashrate += sum_register_hashrate(HASHRATE_MONITOR_MODULE->total_measurement, asic_count);
+        error_hashrate += sum_register_hashrate(HASHRATE_MONITOR_MODULE->error_measurement, asic_count);
+        power += POWER_MANAGEMENT_MODULE->power;
+
+        float chip_temp = POWER_MANAGEMENT_MODULE->chip_temp_max >= 0 ? POWER_MANAGEMENT_MODULE->chip_temp_max : POWER_MANAGEMENT_MODULE->chip_temp_avg;
+        if (chip_temp > measurement->chip_temp) {
+            measurement->chip_temp = chip_temp;
+        }
+        if (POWER_MANAGEMENT_MODULE->vr_temp > measurement->vr_temp) {
+            measurement->vr_temp = POWER_MANAGEMENT_MODULE->vr_temp;
+        }
+        if (GLOBAL_STATE->SYSTEM_MODULE.power_fault > 0) {
+            measurement->fault = true;
+            return;
+        }
+        // Report the limits right away instead of at the end of the measurement
+        if (measurement->chip_temp > MAX_CHIP_TEMP || measurement->vr_temp > MAX_VR_TEMP) {
+            return;
+        }
+    }
+
+    float expected_hashrate = point.frequency * AUTOTUNE_MODULE->autotune.config.ghs_per_mhz;
+
+    measurement->hashrate = hashrate / SAMPLE_COUNT;
+    measurement->power = power / SAMPLE_COUNT;
+    measurement->error_percent = expected_hashrate > 0 ? error_hashrate / SAMPLE_COUNT / expected_hashrate * 100 : 0;
+}
+
+static void finish(GlobalState * GLOBAL_STATE)
+{
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+    autotune_t * autotune = &AUTOTUNE_MODULE->autotune;
+    autotune_point_t best;
+
+    if (autotune->state == AUTOTUNE_STATE_DONE && autotune_get_best(autotune, &best)) {
+        char result[64];
+        snprintf(result, sizeof(result), "%g,%u,%g,%g",
+                 best.frequency, best.voltage, autotune->progress.best_hashrate, autotune->progress.best_power);
+        nvs_config_set_string(NVS_CONFIG_AUTOTUNE_RESULT, result);
+
+        ESP_LOGI(TAG, "Done: %g MHz at %umV, %.1f GH/s, %.2f J/TH", best.frequency, best.voltage,
+                 autotune->progress.best_hashrate, autotune_efficiency(autotune->progress.best_power, autotune->progress.best_hashrate));
+        apply_point(best.frequency, best.voltage);
+    } else {
+        ESP_LOGW(TAG, "%s (%s), restoring %g MHz at %umV",
+                 AUTOTUNE_get_state_string(autotune->state), AUTOTUNE_get_abort_reason_string(autotune->abort_reason),
+                 AUTOTUNE_MODULE->original_frequency, AUTOTUNE_MODULE->original_voltage);
+        apply_point(AUTOTUNE_MODULE->original_frequency, AUTOTUNE_MODULE->original_voltage);
+    }
+
+    nvs_config_set_string(NVS_CONFIG_AUTOTUNE_PROGRESS, "");
+}
+
+static void start(GlobalState * GLOBAL_STATE)
+{
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+    autotune_t * autotune = &AUTOTUNE_MODULE->autotune;
+    autotune_config_t config;
+
+    get_config(GLOBAL_STATE, autotune->config.goal, autotune->config.power_cap, &config);
+
+    AUTOTUNE_MODULE->original_frequency = nvs_config_get_float(NVS_CONFIG_ASIC_FREQUENCY_FLOAT, CONFIG_ASIC_FREQUENCY);
+    AUTOTUNE_MODULE->original_voltage = nvs_config_get_u16(NVS_CONFIG_ASIC_VOLTAGE, CONFIG_ASIC_VOLTAGE);
+
+    autotune_start(autotune, &config);
+
+    ESP_LOGI(TAG, "Starting: %g-%g MHz, %u-%umV, power cap %gW", config.frequency_min, config.frequency_max,
+             config.voltage_min, config.voltage_max, config.power_cap);
+}
+
+void autotune_task(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+    autotune_t * autotune = &AUTOTUNE_MODULE->autotune;
+
+    if (!AUTOTUNE_is_supported(GLOBAL_STATE)) {
+        ESP_LOGI(TAG, "Not supported for this ASIC");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    autotune_task_handle = xTaskGetCurrentTaskHandle();
+
+    if (load_progress(GLOBAL_STATE)) {
+        if (autotune->state == AUTOTUNE_STATE_RUNNING) {
+            ESP_LOGI(TAG, "Resuming at %g MHz, %umV", autotune->progress.point.frequency, autotune->progress.point.voltage);
+        } else {
+            ESP_LOGW(TAG, "Reset while measuring %g MHz at %umV, not measuring it again",
+                     autotune->progress.point.frequency, autotune->progress.point.voltage);
+            finish(GLOBAL_STATE);
+        }
+    }
+
+    while (1) {
+        if (autotune->state != AUTOTUNE_STATE_RUNNING) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        if (AUTOTUNE_MODULE->start_requested) {
+            AUTOTUNE_MODULE->start_requested = false;
+            start(GLOBAL_STATE);
+        }
+
+        autotune_point_t point;
+        while (autotune_next(autotune, &point)) {
+            save_progress(AUTOTUNE_MODULE, true);
+
+            ESP_LOGI(TAG, "Measuring %g MHz at %umV", point.frequency, point.voltage);
+            measure(GLOBAL_STATE, point, &AUTOTUNE_MODULE->last_measurement);
+
+            if (AUTOTUNE_MODULE->abort_requested) {
+                autotune_abort(autotune, AUTOTUNE_ABORT_USER);
+                break;
+            }
+
+            autotune_measurement_t * measurement = &AUTOTUNE_MODULE->last_measurement;
+            ESP_LOGI(TAG, "%g MHz at %umV: %.1f GH/s, %.2f%% errors, %.1fW, %.1f°C", point.frequency, point.voltage,
+                     measurement->hashrate, measurement->error_percent, measurement->power, measurement->chip_temp);
+
+            autotune_report(autotune, measurement);
+            save_progress(AUTOTUNE_MODULE, false);
+        }
+        AUTOTUNE_MODULE->abort_requested = false;
+
+        if (autotune->state == AUTOTUNE_STATE_DONE || autotune->state == AUTOTUNE_STATE_ABORTED) {
+            finish(GLOBAL_STATE);
+        }
+    }
+}
+
+bool AUTOTUNE_is_supported(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+
+    return GLOBAL_STATE->DEVICE_CONFIG.family.asic.id != BM1397;
+}
+
+void AUTOTUNE_start(void * pvParameters, autotune_goal_t goal, float power_cap)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+
+    if (autotune_task_handle == NULL || AUTOTUNE_MODULE->autotune.state == AUTOTUNE_STATE_RUNNING) {
+        return;
+    }
+
+    AUTOTUNE_MODULE->autotune.config.goal = goal;
+    AUTOTUNE_MODULE->autotune.config.power_cap = power_cap;
+    AUTOTUNE_MODULE->start_requested = true;
+    xTaskNotifyGive(autotune_task_handle);
+}
+
+void AUTOTUNE_abort(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    AutotuneModule * AUTOTUNE_MODULE = &GLOBAL_STATE->AUTOTUNE_MODULE;
+
+    if (AUTOTUNE_MODULE->autotune.state == AUTOTUNE_STATE_RUNNING) {
+        AUTOTUNE_MODULE->abort_requested = true;
+    }
+}
+
+const char * AUTOTUNE_get_state_string(autotune_state_t state)
+{
+    switch (state) {
+        case AUTOTUNE_STATE_RUNNING: return "running";
+        case AUTOTUNE_STATE_DONE:    return "done";
+        case AUTOTUNE_STATE_ABORTED: return "aborted";
+        case AUTOTUNE_STATE_IDLE:
+        default:                     return "idle";
+    }
+}
+
+const char * AUTOTUNE_get_abort_reason_string(autotune_abort_reason_t reason)
+{
+    switch (reason) {
+        case AUTOTUNE_ABORT_CHIP_TEMP: return "chip temperature";
+        case AUTOTUNE_ABORT_VR_TEMP:   return "voltage regulator temperature";
+        case AUTOTUNE_ABORT_FAULT:     return "power fault";
+        case AUTOTUNE_ABORT_USER:      return "user";
+        case AUTOTUNE_ABORT_RESET:     return "reset";
+        case AUTOTUNE_ABORT_NONE:
+        default:                       return "none";
+    }
+}
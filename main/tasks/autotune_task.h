@@ -0,0 +1,43 @@
+#ifndef AUTOTUNE_TASK_H_
+#define AUTOTUNE_TASK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "autotune.h"
+
+typedef struct {
+    autotune_t autotune;
+    autotune_measurement_t last_measurement;
+    float original_frequency;   // restored when the search does not finish
+    uint16_t original_voltage;
+    bool start_requested;
+    bool abort_requested;
+} AutotuneModule;
+
+void autotune_task(void * pvParameters);
+
+/**
+ * @brief Whether the ASIC can be measured, BM1397 has no hash counter registers.
+ */
+bool AUTOTUNE_is_supported(void * pvParameters);
+
+/**
+ * @brief Start a search over the frequency and voltage options of the ASIC.
+ *
+ * Every pair is measured for a while on the hash counter registers, the
+ * error counter and the power meter. The best pair is written to the
+ * frequency and voltage settings when the search is done.
+ *
+ * @param power_cap W, 0 for no cap
+ */
+void AUTOTUNE_start(void * pvParameters, autotune_goal_t goal, float power_cap);
+
+/**
+ * @brief Stop a search in progress and restore the original settings.
+ */
+void AUTOTUNE_abort(void * pvParameters);
+
+const char * AUTOTUNE_get_state_string(autotune_state_t state);
+const char * AUTOTUNE_get_abort_reason_string(autotune_abort_reason_t reason);
+
+#endif /* AUTOTUNE_TASK_H_ */
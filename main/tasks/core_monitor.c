@@ -0,0 +1,104 @@
+#include <math.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "global_state.h"
+#include "core_monitor.h"
+
+// Do not judge cores before this many nonces are expected per core
+#define MIN_EXPECTED_NONCES 10.0
+#define WEAK_PROBABILITY 1e-4
+
+static const char *TAG = "core_monitor";
+
+static double log_add_exp(double a, double b)
+{
+    double max = fmax(a, b);
+    return max + log1p(exp(-fabs(a - b)));
+}
+
+// log P(X <= k) for X ~ Poisson(lambda)
+static double poisson_log_cdf(uint32_t k, double lambda)
+{
+    double log_term = -lambda;
+    double log_sum = log_term;
+
+    for (uint32_t i = 1; i <= k; i++) {
+        log_term += log(lambda / i);
+        log_sum = log_add_exp(log_sum, log_term);
+    }
+
+    return log_sum;
+}
+
+void core_monitor_init(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    CoreMonitorModule * CORE_MONITOR_MODULE = &GLOBAL_STATE->CORE_MONITOR_MODULE;
+
+    // Only BM1370 results are decoded into chip, core and small core
+    if (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id != BM1370) {
+        return;
+    }
+
+    int asic_count = GLOBAL_STATE->DEVICE_CONFIG.family.asic_count;
+
+    CORE_MONITOR_MODULE->core_count = GLOBAL_STATE->DEVICE_CONFIG.family.asic.core_count;
+    CORE_MONITOR_MODULE->small_core_count = CORE_MONITOR_MAX_SMALL_CORES;
+
+    CORE_MONITOR_MODULE->asic_nonces = calloc(asic_count, sizeof(uint32_t));
+    CORE_MONITOR_MODULE->core_nonces = calloc(asic_count * CORE_MONITOR_MAX_CORES, sizeof(uint32_t));
+    CORE_MONITOR_MODULE->small_core_nonces = calloc(asic_count * CORE_MONITOR_MAX_CORES * CORE_MONITOR_MAX_SMALL_CORES, sizeof(uint16_t));
+
+    if (!CORE_MONITOR_MODULE->asic_nonces || !CORE_MONITOR_MODULE->core_nonces || !CORE_MONITOR_MODULE->small_core_nonces) {
+        ESP_LOGE(TAG, "Failed to allocate core counters");
+        free(CORE_MONITOR_MODULE->asic_nonces);
+        free(CORE_MONITOR_MODULE->core_nonces);
+        free(CORE_MONITOR_MODULE->small_core_nonces);
+        return;
+    }
+
+    CORE_MONITOR_MODULE->is_initialized = true;
+}
+
+void core_monitor_nonce_found(void * pvParameters, uint8_t asic_nr, uint8_t core_id, uint8_t small_core_id)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    CoreMonitorModule * CORE_MONITOR_MODULE = &GLOBAL_STATE->CORE_MONITOR_MODULE;
+
+    if (!CORE_MONITOR_MODULE->is_initialized) {
+        return;
+    }
+
+    if (asic_nr >= GLOBAL_STATE->DEVICE_CONFIG.family.asic_count
+        || core_id >= CORE_MONITOR_MAX_CORES
+        || small_core_id >= CORE_MONITOR_MAX_SMALL_CORES) {
+        ESP_LOGW(TAG, "Nonce from unknown core %d/%d/%d", asic_nr, core_id, small_core_id);
+        return;
+    }
+
+    int core_index = asic_nr * CORE_MONITOR_MAX_CORES + core_id;
+    int small_core_index = core_index * CORE_MONITOR_MAX_SMALL_CORES + small_core_id;
+
+    CORE_MONITOR_MODULE->asic_nonces[asic_nr]++;
+    CORE_MONITOR_MODULE->core_nonces[core_index]++;
+    if (CORE_MONITOR_MODULE->small_core_nonces[small_core_index] < UINT16_MAX) {
+        CORE_MONITOR_MODULE->small_core_nonces[small_core_index]++;
+    }
+}
+
+core_health_t core_monitor_get_core_health(CoreMonitorModule * CORE_MONITOR_MODULE, int asic_nr, int core_id)
+{
+    double expected = (double) CORE_MONITOR_MODULE->asic_nonces[asic_nr] / CORE_MONITOR_MODULE->core_count;
+    if (expected < MIN_EXPECTED_NONCES) {
+        return CORE_HEALTH_UNKNOWN;
+    }
+
+    uint32_t observed = CORE_MONITOR_MODULE->core_nonces[asic_nr * CORE_MONITOR_MAX_CORES + core_id];
+    if (observed == 0) {
+        return CORE_HEALTH_DEAD;
+    }
+    if (observed < expected && poisson_log_cdf(observed, expected) < log(WEAK_PROBABILITY)) {
+        return CORE_HEALTH_WEAK;
+    }
+    return CORE_HEALTH_OK;
+}
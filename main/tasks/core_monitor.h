@@ -0,0 +1,39 @@
+#ifndef CORE_MONITOR_H_
+#define CORE_MONITOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Core and small core ids are coded on 7 and 4 bits in the nonce response
+#define CORE_MONITOR_MAX_CORES 128
+#define CORE_MONITOR_MAX_SMALL_CORES 16
+
+typedef enum {
+    CORE_HEALTH_UNKNOWN = 0, // not enough nonces yet to tell
+    CORE_HEALTH_OK,
+    CORE_HEALTH_WEAK,
+    CORE_HEALTH_DEAD,
+} core_health_t;
+
+typedef struct {
+    uint32_t * asic_nonces;       // [asic]
+    uint32_t * core_nonces;       // [asic][core]
+    uint16_t * small_core_nonces; // [asic][core][small core], saturating
+    uint16_t core_count;
+    uint8_t small_core_count;
+    bool is_initialized;
+} CoreMonitorModule;
+
+void core_monitor_init(void * pvParameters);
+void core_monitor_nonce_found(void * pvParameters, uint8_t asic_nr, uint8_t core_id, uint8_t small_core_id);
+
+/**
+ * @brief Check the nonces of a core against the Poisson expectation.
+ *
+ * Every core of a chip is expected to find an equal share of the chip nonces.
+ * A core is weak when the probability of seeing this few nonces is below
+ * 1e-4, and dead when it found none at all.
+ */
+core_health_t core_monitor_get_core_health(CoreMonitorModule * CORE_MONITOR_MODULE, int asic_nr, int core_id);
+
+#endif /* CORE_MONITOR_H_ */
@@ -9,6 +9,7 @@
 #include "string.h"
 
 #include "asic.h"
+#include "mining_trace.h"
 
 static const char *TAG = "create_jobs_task";
 
@@ -119,7 +120,9 @@ static void generate_work(GlobalState *GLOBAL_STATE, mining_notify *notification
     queued_next_job->extranonce2 = extranonce_2_str; // Transfer ownership
     queued_next_job->jobid = strdup(notification->job_id);
     queued_next_job->version_mask = GLOBAL_STATE->version_mask;
+    queued_next_job->trace_id = notification->trace_id;
 
+    mining_trace_job_built(notification->trace_id);
     queue_enqueue(&GLOBAL_STATE->ASIC_jobs_queue, queued_next_job);
 
     free(coinbase_tx);
@@ -0,0 +1,430 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "global_state.h"
+#include "asic.h"
+#include "common.h"
+#include "frequency_ramp_task.h"
+
+#define EPSILON 0.0001f
+
+// Step size grows while the chips stay stable and falls back when they do not
+#define MIN_STEP 6.25 // MHz
+#define MAX_STEP 25.0 // MHz
+
+#define MIN_DWELL_MS 100
+#define MAX_DWELL_MS 2000
+
+// A power change larger than this within one step counts as unstable
+#define POWER_JUMP_PERCENT 10
+
+// An error rate above this within one step counts as unstable, a short step is judged as if it
+// had seen this many frames or hash counts, so a single stray error does not count as a rate
+#define MAX_ERROR_PERCENT 2
+#define MIN_ERROR_RATE_COUNT 100
+
+// How often a caller waiting for a ramp checks on it
+#define RAMP_WAIT_MS 50
+
+// How long a snapshot waits for the register reads and the power poll it requested
+#define SNAPSHOT_TIMEOUT_MS 250
+#define SNAPSHOT_WAIT_MS 10
+
+// Highest frequency accepted per chip, as for the chain frequency setting
+#define MAX_CHIP_FREQUENCY 65535
+
+static const char * TAG = "frequency_ramp";
+
+static TaskHandle_t ramp_task_handle;
+
+// Readings taken before and after a step, not older than the step itself
+typedef struct {
+    uint32_t rx_frames;
+    uint32_t rx_errors;
+    uint32_t total_count;
+    uint32_t error_count;
+    bool has_error_count;
+    float power;
+    bool has_power;
+} stability_snapshot_t;
+
+static bool is_newer(uint32_t time_ms, uint32_t since_ms)
+{
+    return time_ms != 0 && (int32_t) (time_ms - since_ms) >= 0;
+}
+
+// The hash and error counter registers of all chips, when every chip answered both since the given time
+static bool read_error_count(GlobalState * GLOBAL_STATE, uint32_t since_ms, uint32_t * total_count, uint32_t * error_count)
+{
+    measurement_t * total_measurement = GLOBAL_STATE->HASHRATE_MONITOR_MODULE.total_measurement;
+    measurement_t * error_measurement = GLOBAL_STATE->HASHRATE_MONITOR_MODULE.error_measurement;
+
+    *total_count = 0;
+    *error_count = 0;
+    for (int asic_nr = 0; asic_nr < GLOBAL_STATE->DEVICE_CONFIG.family.asic_count; asic_nr++) {
+        if (!is_newer(total_measurement[asic_nr].time_ms, since_ms) || !is_newer(error_measurement[asic_nr].time_ms, since_ms)) {
+            return false;
+        }
+        *total_count += total_measurement[asic_nr].value;
+        *error_count += error_measurement[asic_nr].value;
+    }
+    return true;
+}
+
+// The hashrate monitor reads the error counters every 5 s and clears them on every
+// frequency change, so they are read here for every snapshot, together with the power
+static void take_snapshot(GlobalState * GLOBAL_STATE, stability_snapshot_t * snapshot)
+{
+    uint32_t since_ms = esp_timer_get_time() / 1000;
+
+    // BM1397 has no error counter register
+    bool read_registers = GLOBAL_STATE->HASHRATE_MONITOR_MODULE.is_initialized
+        && GLOBAL_STATE->DEVICE_CONFIG.family.asic.id != BM1397;
+
+    snapshot->has_error_count = false;
+    snapshot->has_power = false;
+
+    if (read_registers) {
+        ASIC_read_registers(GLOBAL_STATE);
+    }
+    SENSOR_request(GLOBAL_STATE, SENSOR_POLL_POWER);
+
+    for (int waited_ms = 0; waited_ms < SNAPSHOT_TIMEOUT_MS; waited_ms += SNAPSHOT_WAIT_MS) {
+        if (read_registers && !snapshot->has_error_count) {
+            snapshot->has_error_count = read_error_count(GLOBAL_STATE, since_ms, &snapshot->total_count, &snapshot->error_count);
+        }
+        if (!snapshot->has_power) {
+            SensorSample power = SENSOR_get_sample(GLOBAL_STATE, SENSOR_POWER);
+            snapshot->has_power = is_newer(power.time_ms, since_ms);
+            snapshot->power = power.value;
+        }
+        if ((snapshot->has_error_count || !read_registers) && snapshot->has_power) {
+            break;
+        }
+        vTaskDelay(SNAPSHOT_WAIT_MS / portTICK_PERIOD_MS);
+    }
+
+    get_receive_work_stats(&snapshot->rx_frames, &snapshot->rx_errors);
+}
+
+// Counter differences handle the uint32_t wraparound
+static bool is_error_rate_high(uint32_t errors, uint32_t total)
+{
+    return (uint64_t) errors * 100 > (uint64_t) MAX_ERROR_PERCENT * MAX(total, MIN_ERROR_RATE_COUNT);
+}
+
+static bool is_stable(GlobalState * GLOBAL_STATE, stability_snapshot_t * before)
+{
+    stability_snapshot_t after;
+    take_snapshot(GLOBAL_STATE, &after);
+
+    if (is_error_rate_high(after.rx_errors - before->rx_errors, after.rx_frames - before->rx_frames)) {
+        return false;
+    }
+    if (before->has_error_count && after.has_error_count
+        && is_error_rate_high(after.error_count - before->error_count, after.total_count - before->total_count)) {
+        return false;
+    }
+    if (before->has_power && after.has_power && before->power > 0
+        && fabsf(after.power - before->power) * 100 > before->power * POWER_JUMP_PERCENT) {
+        return false;
+    }
+    return true;
+}
+
+static int get_chip_count(GlobalState * GLOBAL_STATE)
+{
+    return MIN(GLOBAL_STATE->DEVICE_CONFIG.family.asic_count, FREQUENCY_RAMP_MAX_CHIPS);
+}
+
+static float get_chip_target(FrequencyRampModule * FREQUENCY_RAMP_MODULE, int asic_nr)
+{
+    float target = FREQUENCY_RAMP_MODULE->chip_target_frequency[asic_nr];
+    return target > 0 ? target : FREQUENCY_RAMP_MODULE->current_frequency;
+}
+
+static bool chips_at_target(GlobalState * GLOBAL_STATE)
+{
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    // A single chip is controlled through the chain frequency
+    if (GLOBAL_STATE->DEVICE_CONFIG.family.asic_count < 2) {
+        return true;
+    }
+
+    for (int asic_nr = 0; asic_nr < get_chip_count(GLOBAL_STATE); asic_nr++) {
+        if (fabsf(get_chip_target(FREQUENCY_RAMP_MODULE, asic_nr) - FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr]) > EPSILON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keep every chip at the frequency it has reached
+static void hold_chips(GlobalState * GLOBAL_STATE)
+{
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    for (int asic_nr = 0; asic_nr < get_chip_count(GLOBAL_STATE); asic_nr++) {
+        float frequency = FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr];
+        bool follows_chain = fabsf(frequency - FREQUENCY_RAMP_MODULE->current_frequency) <= EPSILON;
+        FREQUENCY_RAMP_MODULE->chip_target_frequency[asic_nr] = follows_chain ? 0 : frequency;
+    }
+}
+
+// Step every chip that is not at its own frequency yet, on the 6.25 MHz grid
+static void ramp_chips(GlobalState * GLOBAL_STATE)
+{
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    while (!chips_at_target(GLOBAL_STATE)) {
+        if (FREQUENCY_RAMP_MODULE->cancel_requested) {
+            ESP_LOGW(TAG, "Chip ramp cancelled");
+            hold_chips(GLOBAL_STATE);
+            break;
+        }
+        // The chain frequency takes precedence, chips are applied after it
+        if (fabsf(FREQUENCY_RAMP_MODULE->target_frequency - FREQUENCY_RAMP_MODULE->current_frequency) > EPSILON) {
+            break;
+        }
+
+        for (int asic_nr = 0; asic_nr < get_chip_count(GLOBAL_STATE); asic_nr++) {
+            float target = get_chip_target(FREQUENCY_RAMP_MODULE, asic_nr);
+            float current = FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr];
+            if (fabsf(target - current) <= EPSILON) {
+                continue;
+            }
+
+            float next = target > current
+                ? fminf(floorf((current + MIN_STEP) / MIN_STEP) * MIN_STEP, target)
+                : fmaxf(ceilf((current - MIN_STEP) / MIN_STEP) * MIN_STEP, target);
+
+            if (!ASIC_set_chip_frequency(GLOBAL_STATE, asic_nr, next)) {
+                hold_chips(GLOBAL_STATE);
+                return;
+            }
+            FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr] = next;
+        }
+
+        // A new request or a cancel wakes the ramp up early
+        ulTaskNotifyTake(pdTRUE, MIN_DWELL_MS / portTICK_PERIOD_MS);
+    }
+}
+
+static void ramp(GlobalState * GLOBAL_STATE)
+{
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+    PowerManagementModule * POWER_MANAGEMENT_MODULE = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+
+    FREQUENCY_RAMP_MODULE->step = MIN_STEP;
+    FREQUENCY_RAMP_MODULE->dwell_ms = MIN_DWELL_MS;
+
+    ESP_LOGI(TAG, "Ramping frequency from %g MHz to %g MHz", FREQUENCY_RAMP_MODULE->current_frequency, FREQUENCY_RAMP_MODULE->target_frequency);
+
+    while (fabsf(FREQUENCY_RAMP_MODULE->target_frequency - FREQUENCY_RAMP_MODULE->current_frequency) > EPSILON) {
+        if (FREQUENCY_RAMP_MODULE->cancel_requested) {
+            ESP_LOGW(TAG, "Ramp cancelled at %g MHz", FREQUENCY_RAMP_MODULE->current_frequency);
+            FREQUENCY_RAMP_MODULE->target_frequency = FREQUENCY_RAMP_MODULE->current_frequency;
+            break;
+        }
+
+        float target = FREQUENCY_RAMP_MODULE->target_frequency;
+        float current = FREQUENCY_RAMP_MODULE->current_frequency;
+        // Stay on the 6.25 MHz grid, its PLL settings are precomputed
+        float next = target > current
+            ? fminf(floorf((current + FREQUENCY_RAMP_MODULE->step) / MIN_STEP) * MIN_STEP, target)
+            : fmaxf(ceilf((current - FREQUENCY_RAMP_MODULE->step) / MIN_STEP) * MIN_STEP, target);
+
+        stability_snapshot_t snapshot;
+        take_snapshot(GLOBAL_STATE, &snapshot);
+
+        if (!ASIC_set_frequency_step(GLOBAL_STATE, next)) {
+            ESP_LOGE(TAG, "Failed to set frequency to %g MHz", next);
+            FREQUENCY_RAMP_MODULE->target_frequency = current;
+            break;
+        }
+        FREQUENCY_RAMP_MODULE->current_frequency = next;
+        POWER_MANAGEMENT_MODULE->frequency_value = next;
+
+        // The chain frequency is broadcast, every chip follows it during the ramp
+        for (int asic_nr = 0; asic_nr < get_chip_count(GLOBAL_STATE); asic_nr++) {
+            FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr] = next;
+        }
+
+        // A new request or a cancel wakes the ramp up early
+        if (ulTaskNotifyTake(pdTRUE, FREQUENCY_RAMP_MODULE->dwell_ms / portTICK_PERIOD_MS) > 0) {
+            continue;
+        }
+
+        if (is_stable(GLOBAL_STATE, &snapshot)) {
+            FREQUENCY_RAMP_MODULE->step = fminf(FREQUENCY_RAMP_MODULE->step * 2, MAX_STEP);
+            FREQUENCY_RAMP_MODULE->dwell_ms = MAX(FREQUENCY_RAMP_MODULE->dwell_ms / 2, MIN_DWELL_MS);
+        } else {
+            FREQUENCY_RAMP_MODULE->step = MIN_STEP;
+            FREQUENCY_RAMP_MODULE->dwell_ms = MIN(FREQUENCY_RAMP_MODULE->dwell_ms * 2, MAX_DWELL_MS);
+            ESP_LOGI(TAG, "Unstable at %g MHz, step %g MHz, dwell %u ms", next, FREQUENCY_RAMP_MODULE->step, FREQUENCY_RAMP_MODULE->dwell_ms);
+        }
+    }
+
+    ESP_LOGI(TAG, "Frequency at %g MHz", FREQUENCY_RAMP_MODULE->current_frequency);
+}
+
+void frequency_ramp_task(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    ramp_task_handle = xTaskGetCurrentTaskHandle();
+
+    // ASIC_init left the chips at the configured frequency
+    FREQUENCY_RAMP_MODULE->current_frequency = GLOBAL_STATE->POWER_MANAGEMENT_MODULE.frequency_value;
+    FREQUENCY_RAMP_MODULE->start_frequency = FREQUENCY_RAMP_MODULE->current_frequency;
+    for (int asic_nr = 0; asic_nr < get_chip_count(GLOBAL_STATE); asic_nr++) {
+        FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr] = FREQUENCY_RAMP_MODULE->current_frequency;
+    }
+    if (FREQUENCY_RAMP_MODULE->target_frequency <= 0) {
+        FREQUENCY_RAMP_MODULE->target_frequency = FREQUENCY_RAMP_MODULE->current_frequency;
+    }
+
+    while (1) {
+        if (fabsf(FREQUENCY_RAMP_MODULE->target_frequency - FREQUENCY_RAMP_MODULE->current_frequency) > EPSILON || !chips_at_target(GLOBAL_STATE)) {
+            FREQUENCY_RAMP_MODULE->cancel_requested = false;
+            FREQUENCY_RAMP_MODULE->is_ramping = true;
+            ramp(GLOBAL_STATE);
+            ramp_chips(GLOBAL_STATE);
+            FREQUENCY_RAMP_MODULE->is_ramping = false;
+
+            // Requests that came in during the ramp may have consumed the notification
+            continue;
+        }
+
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void FREQUENCY_RAMP_request(void * pvParameters, float target_frequency)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    if (!FREQUENCY_RAMP_MODULE->is_ramping) {
+        FREQUENCY_RAMP_MODULE->start_frequency = FREQUENCY_RAMP_MODULE->current_frequency;
+    }
+    FREQUENCY_RAMP_MODULE->target_frequency = target_frequency;
+    FREQUENCY_RAMP_MODULE->cancel_requested = false;
+
+    if (ramp_task_handle != NULL) {
+        xTaskNotifyGive(ramp_task_handle);
+    }
+}
+
+bool FREQUENCY_RAMP_set(void * pvParameters, float target_frequency, uint32_t timeout_ms)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    FREQUENCY_RAMP_request(GLOBAL_STATE, target_frequency);
+
+    for (uint32_t waited_ms = 0; waited_ms < timeout_ms; waited_ms += RAMP_WAIT_MS) {
+        vTaskDelay(RAMP_WAIT_MS / portTICK_PERIOD_MS);
+
+        if (FREQUENCY_RAMP_MODULE->is_ramping) {
+            continue;
+        }
+        if (fabsf(FREQUENCY_RAMP_MODULE->current_frequency - target_frequency) <= EPSILON) {
+            return true;
+        }
+        // A failed step or a cancel moves the target to the frequency reached, a new request replaces it
+        if (fabsf(FREQUENCY_RAMP_MODULE->target_frequency - target_frequency) > EPSILON) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void FREQUENCY_RAMP_request_chips(void * pvParameters, const float * frequencies, int count)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    for (int asic_nr = 0; asic_nr < FREQUENCY_RAMP_MAX_CHIPS; asic_nr++) {
+        FREQUENCY_RAMP_MODULE->chip_target_frequency[asic_nr] = asic_nr < count ? frequencies[asic_nr] : 0;
+    }
+    FREQUENCY_RAMP_MODULE->cancel_requested = false;
+
+    if (ramp_task_handle != NULL) {
+        xTaskNotifyGive(ramp_task_handle);
+    }
+}
+
+int FREQUENCY_RAMP_parse_chip_frequencies(const char * str, float * frequencies, int max_count)
+{
+    int count = 0;
+    const char * pos = str;
+
+    while (*pos != '\0') {
+        char * end;
+        float frequency = strtof(pos, &end);
+        if (end == pos || frequency < 0 || frequency > MAX_CHIP_FREQUENCY || count >= max_count) {
+            return -1;
+        }
+        frequencies[count++] = frequency;
+
+        pos = end;
+        while (*pos == ' ') pos++;
+        if (*pos == ',') {
+            pos++;
+        } else if (*pos != '\0') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+float FREQUENCY_RAMP_get_average_frequency(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    int chip_count = get_chip_count(GLOBAL_STATE);
+    if (chip_count < 2 || FREQUENCY_RAMP_MODULE->chip_frequency[0] == 0) {
+        return GLOBAL_STATE->POWER_MANAGEMENT_MODULE.frequency_value;
+    }
+
+    float sum = 0;
+    for (int asic_nr = 0; asic_nr < chip_count; asic_nr++) {
+        sum += FREQUENCY_RAMP_MODULE->chip_frequency[asic_nr];
+    }
+    return sum / chip_count;
+}
+
+void FREQUENCY_RAMP_cancel(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *)pvParameters;
+    FrequencyRampModule * FREQUENCY_RAMP_MODULE = &GLOBAL_STATE->FREQUENCY_RAMP_MODULE;
+
+    if (!FREQUENCY_RAMP_MODULE->is_ramping) {
+        return;
+    }
+
+    FREQUENCY_RAMP_MODULE->cancel_requested = true;
+    if (ramp_task_handle != NULL) {
+        xTaskNotifyGive(ramp_task_handle);
+    }
+}
+
+float FREQUENCY_RAMP_get_progress(FrequencyRampModule * FREQUENCY_RAMP_MODULE)
+{
+    float total = FREQUENCY_RAMP_MODULE->target_frequency - FREQUENCY_RAMP_MODULE->start_frequency;
+    if (!FREQUENCY_RAMP_MODULE->is_ramping || fabsf(total) < EPSILON) {
+        return 100;
+    }
+
+    float progress = (FREQUENCY_RAMP_MODULE->current_frequency - FREQUENCY_RAMP_MODULE->start_frequency) * 100 / total;
+    return fminf(fmaxf(progress, 0), 100);
+}
@@ -0,0 +1,70 @@
+#ifndef FREQUENCY_RAMP_TASK_H_
+#define FREQUENCY_RAMP_TASK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Largest chain that can run every chip at its own frequency
+#define FREQUENCY_RAMP_MAX_CHIPS 6
+
+typedef struct {
+    float start_frequency;
+    float current_frequency;
+    float target_frequency;
+    float step;           // MHz, adapted to the measured stability
+    uint16_t dwell_ms;    // time spent on each step, adapted to the measured stability
+    float chip_frequency[FREQUENCY_RAMP_MAX_CHIPS];
+    float chip_target_frequency[FREQUENCY_RAMP_MAX_CHIPS]; // 0 follows the chain frequency
+    bool is_ramping;
+    bool cancel_requested;
+} FrequencyRampModule;
+
+void frequency_ramp_task(void * pvParameters);
+
+/**
+ * @brief Ramp the ASIC frequency to a target in the background.
+ *
+ * Returns immediately. A ramp in progress continues from its current
+ * frequency towards the new target.
+ */
+void FREQUENCY_RAMP_request(void * pvParameters, float target_frequency);
+
+/**
+ * @brief Ramp the ASIC frequency to a target and wait for the ramp.
+ *
+ * @return true when the target was reached within the timeout, false when a
+ * step failed, the ramp was cancelled or replaced, or it is still ramping
+ */
+bool FREQUENCY_RAMP_set(void * pvParameters, float target_frequency, uint32_t timeout_ms);
+
+/**
+ * @brief Ramp single chips to their own frequency in the background.
+ *
+ * A frequency of 0 makes the chip follow the chain frequency. The chip
+ * frequencies are applied after every ramp of the chain frequency.
+ */
+void FREQUENCY_RAMP_request_chips(void * pvParameters, const float * frequencies, int count);
+
+/**
+ * @brief Parse a comma separated list of chip frequencies in MHz.
+ *
+ * @return The number of frequencies, or -1 when the list is invalid
+ */
+int FREQUENCY_RAMP_parse_chip_frequencies(const char * str, float * frequencies, int max_count);
+
+/**
+ * @brief Average frequency over all chips, for the expected hashrate.
+ */
+float FREQUENCY_RAMP_get_average_frequency(void * pvParameters);
+
+/**
+ * @brief Stop a ramp in progress at the frequency reached so far.
+ */
+void FREQUENCY_RAMP_cancel(void * pvParameters);
+
+/**
+ * @brief Progress of the current ramp in percent, 100 when idle.
+ */
+float FREQUENCY_RAMP_get_progress(FrequencyRampModule * FREQUENCY_RAMP_MODULE);
+
+#endif /* FREQUENCY_RAMP_TASK_H_ */
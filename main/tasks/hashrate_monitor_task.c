@@ -4,6 +4,7 @@
 #include "system.h"
 #include "common.h"
 #include "asic.h"
+#include "baud_tuning.h"
 
 #define POLL_RATE 5000
 #define EMA_ALPHA 12
@@ -35,6 +36,23 @@ static uint32_t sum_values(measurement_t * measurement, int asic_count)
     return total;
 }
 
+// Temperature conversion from the NerdAxe codebase, bit 31 flags a valid reading
+static void update_die_temp(PowerManagementModule * POWER_MANAGEMENT_MODULE, uint32_t time_ms, uint32_t value, int asic_nr)
+{
+    if (asic_nr >= sizeof(POWER_MANAGEMENT_MODULE->chip_temp) / sizeof(POWER_MANAGEMENT_MODULE->chip_temp[0])) {
+        return;
+    }
+    if (!(value & 0x80000000)) {
+        return;
+    }
+
+    float temp = (float) (value & 0x0000ffff) * 0.171342f - 299.5144f;
+    ESP_LOGD(TAG, "asic %d temp: %.3f", asic_nr, temp);
+
+    POWER_MANAGEMENT_MODULE->chip_temp[asic_nr] = temp;
+    POWER_MANAGEMENT_MODULE->chip_temp_time_ms[asic_nr] = time_ms == 0 ? 1 : time_ms;
+}
+
 static void clear_measurements(HashrateMonitorModule * HASHRATE_MONITOR_MODULE, int asic_count)
 {
     memset(HASHRATE_MONITOR_MODULE->total_measurement, 0, asic_count * sizeof(measurement_t));
@@ -84,9 +102,8 @@ void hashrate_monitor_task(void *pvParameters)
 
     HASHRATE_MONITOR_MODULE->is_initialized = true;
 
-    // Only BM1370 supports register-based hashrate monitoring
-    // adding BM1366 and BM1368 later
-    bool supports_register_reading = (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id == BM1370);
+    // BM1397 has no hash counting registers
+    bool supports_register_reading = (GLOBAL_STATE->DEVICE_CONFIG.family.asic.id != BM1397);
 
     TickType_t taskWakeTime = xTaskGetTickCount();
     while (1) {
@@ -94,6 +111,8 @@ void hashrate_monitor_task(void *pvParameters)
             ASIC_read_registers(GLOBAL_STATE);
         }
 
+        BAUD_check_errors(GLOBAL_STATE);
+
         vTaskDelay(100 / portTICK_PERIOD_MS);
 
         float hashrate = sum_hashrates(HASHRATE_MONITOR_MODULE->total_measurement, asic_count);
@@ -153,18 +172,12 @@ void hashrate_monitor_register_read(void *pvParameters, register_type_t register
         case REGISTER_ERROR_COUNT:
             update_measurement(time_ms, value, HASHRATE_MONITOR_MODULE->error_measurement, asic_nr);
             break;
+        case REGISTER_TEMPERATURE:
+            update_die_temp(POWER_MANAGEMENT_MODULE, time_ms, value, asic_nr);
+            break;
         case REGISTER_INVALID:
             ESP_LOGE(TAG, "Invalid register type");
             break;
     }
 }
 
-/*
-    // From NerdAxe codebase, temparature conversion?
-    if (asic_result.data & 0x80000000) {
-        float ftemp = (float) (asic_result.data & 0x0000ffff) * 0.171342f - 299.5144f;
-        ESP_LOGI(TAG, "asic %d temp: %.3f", (int) asic_result.asic_nr, ftemp);
-        board->setChipTemp(asic_result.asic_nr, ftemp);
-    }
-    break;
-*/
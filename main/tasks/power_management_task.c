@@ -1,6 +1,8 @@
 #include <string.h>
+#include <sys/param.h>
 #include "INA260.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "global_state.h"
@@ -8,26 +10,35 @@
 #include "mining.h"
 #include "nvs_config.h"
 #include "serial.h"
+#include "system.h"
 #include "TPS546.h"
 #include "vcore.h"
 #include "thermal.h"
+#include "thermal_throttle.h"
 #include "PID.h"
+#include "fan_control.h"
 #include "power.h"
+#include "power_telemetry.h"
 #include "asic.h"
 #include "bm1370.h"
 #include "utils.h"
 
 #define POLL_RATE 1800
-#define MAX_TEMP 90.0
-#define THROTTLE_TEMP 75.0
 #define THROTTLE_TEMP_RANGE (MAX_TEMP - THROTTLE_TEMP)
 
 #define VOLTAGE_START_THROTTLE 4900
 #define VOLTAGE_MIN_THROTTLE 3500
 #define VOLTAGE_RANGE (VOLTAGE_START_THROTTLE - VOLTAGE_MIN_THROTTLE)
 
-#define TPS546_THROTTLE_TEMP 105.0
-#define TPS546_MAX_TEMP 145.0
+// Power limit steps on the PLL grid, the voltage is trimmed only at the lowest frequency
+#define POWER_LIMIT_STEP 6.25        // MHz
+#define POWER_LIMIT_MAX_STEP 25.0    // MHz
+#define POWER_LIMIT_VOLTAGE_STEP 10  // mV
+#define POWER_LIMIT_HYSTERESIS 0.05  // fraction of the limit to fall below before stepping up
+#define POWER_LIMIT_HOLDOFF 2        // polls to wait for the power to settle after a step
+
+// Temperatures this old mean the sensor task or the bus hung, the chip could be overheating unseen
+#define SENSOR_MAX_AGE_MS 10000
 
 static const char * TAG = "power_management";
 
@@ -49,11 +60,118 @@ int pid_startup_counter = 0;
 
 PIDController pid;
 
+fan_control_t fan_control;
+
+static int power_limit_holdoff = 0;
+
+// Settings read by the control loop
+static const char * const POWER_MANAGEMENT_CONFIG_KEYS[] = {
+    NVS_CONFIG_TEMP_TARGET,
+    NVS_CONFIG_DIE_TEMP_CONTROL,
+    NVS_CONFIG_DIE_TEMP_TARGET,
+    NVS_CONFIG_FAN_FEED_FORWARD,
+    NVS_CONFIG_AUTO_FAN_SPEED,
+    NVS_CONFIG_FAN_SPEED,
+    NVS_CONFIG_ASIC_VOLTAGE,
+    NVS_CONFIG_ASIC_FREQUENCY_FLOAT,
+    NVS_CONFIG_ASIC_CHIP_FREQUENCIES,
+    NVS_CONFIG_POWER_LIMIT,
+    NVS_CONFIG_OVERHEAT_MODE,
+};
+
+static void config_changed(const char * key, void * context)
+{
+    xTaskNotifyGive((TaskHandle_t) context);
+}
+
 static float expected_hashrate(GlobalState * GLOBAL_STATE, float frequency)
 {
     return frequency * GLOBAL_STATE->DEVICE_CONFIG.family.asic.small_core_count * GLOBAL_STATE->DEVICE_CONFIG.family.asic_count / 1000.0;
 }
 
+static uint16_t get_power_limit(GlobalState * GLOBAL_STATE)
+{
+    uint16_t max_power = GLOBAL_STATE->DEVICE_CONFIG.family.max_power;
+    uint16_t power_limit = nvs_config_get_u16(NVS_CONFIG_POWER_LIMIT, 0);
+
+    // The board maximum applies when no lower limit is set
+    if (max_power > 0 && (power_limit == 0 || power_limit > max_power)) {
+        return max_power;
+    }
+    return power_limit;
+}
+
+// Trim frequency, then voltage, in small steps to hold the measured power at the limit
+static void power_limit_update(GlobalState * GLOBAL_STATE, float asic_frequency, uint16_t core_voltage, bool is_full_poll)
+{
+    PowerManagementModule * power_management = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+    const AsicConfig * asic = &GLOBAL_STATE->DEVICE_CONFIG.family.asic;
+    // BM1397 has no frequency transition, so only the voltage is trimmed there
+    float min_frequency = asic->id == BM1397 ? asic_frequency : fminf(asic->frequency_options[0], asic_frequency);
+    uint16_t min_voltage = MIN(asic->voltage_options[0], core_voltage);
+
+    power_management->power_limit = get_power_limit(GLOBAL_STATE);
+
+    // Never run above the settings, also when they were lowered meanwhile
+    if (power_management->power_limit_frequency == 0 || power_management->power_limit_frequency > asic_frequency) {
+        power_management->power_limit_frequency = asic_frequency;
+    }
+    if (core_voltage - power_management->power_limit_voltage_trim < min_voltage) {
+        power_management->power_limit_voltage_trim = core_voltage - min_voltage;
+    }
+
+    // The autotune has its own power cap
+    if (power_management->power_limit == 0 || GLOBAL_STATE->AUTOTUNE_MODULE.autotune.state == AUTOTUNE_STATE_RUNNING) {
+        power_management->power_limit_frequency = asic_frequency;
+        power_management->power_limit_voltage_trim = 0;
+        power_management->is_power_limited = false;
+        return;
+    }
+
+    if (power_limit_holdoff > 0) {
+        if (is_full_poll) {
+            power_limit_holdoff--;
+        }
+        return;
+    }
+    if (GLOBAL_STATE->FREQUENCY_RAMP_MODULE.is_ramping || power_management->power <= 0) {
+        return;
+    }
+
+    float over_power = power_management->power - power_management->power_limit;
+
+    // Raising the clock while the fan PID is saturated only makes it hotter
+    bool fan_saturated = nvs_config_get_u16(NVS_CONFIG_AUTO_FAN_SPEED, 1) == 1 && pid_output >= 100 && pid_input > pid_setPoint;
+
+    if (over_power > 0) {
+        if (power_management->power_limit_frequency > min_frequency) {
+            // Power scales about linearly with the frequency
+            float step = over_power / power_management->power * power_management->power_limit_frequency;
+            step = ceilf(step / POWER_LIMIT_STEP) * POWER_LIMIT_STEP;
+            step = fminf(fmaxf(step, POWER_LIMIT_STEP), POWER_LIMIT_MAX_STEP);
+            power_management->power_limit_frequency = fmaxf(power_management->power_limit_frequency - step, min_frequency);
+        } else if (core_voltage - power_management->power_limit_voltage_trim - POWER_LIMIT_VOLTAGE_STEP >= min_voltage) {
+            power_management->power_limit_voltage_trim += POWER_LIMIT_VOLTAGE_STEP;
+        } else {
+            return;
+        }
+        ESP_LOGI(TAG, "Power %.1fW over the %uW limit, trimming to %g MHz at %umV", power_management->power, power_management->power_limit,
+                 power_management->power_limit_frequency, core_voltage - power_management->power_limit_voltage_trim);
+        power_limit_holdoff = POWER_LIMIT_HOLDOFF;
+    } else if (power_management->power < power_management->power_limit * (1 - POWER_LIMIT_HYSTERESIS) && !fan_saturated) {
+        if (power_management->power_limit_voltage_trim > 0) {
+            power_management->power_limit_voltage_trim -= MIN(power_management->power_limit_voltage_trim, POWER_LIMIT_VOLTAGE_STEP);
+        } else if (power_management->power_limit_frequency < asic_frequency) {
+            power_management->power_limit_frequency = fminf(power_management->power_limit_frequency + POWER_LIMIT_STEP, asic_frequency);
+        } else {
+            return;
+        }
+        power_limit_holdoff = POWER_LIMIT_HOLDOFF;
+    }
+
+    power_management->is_power_limited = power_management->power_limit_frequency < asic_frequency || power_management->power_limit_voltage_trim > 0;
+}
+
 void POWER_MANAGEMENT_init_frequency(void * pvParameters)
 {
     GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
@@ -83,8 +201,10 @@ void POWER_MANAGEMENT_task(void * pvParameters)
     SystemModule * sys_module = &GLOBAL_STATE->SYSTEM_MODULE;
 
     POWER_MANAGEMENT_init_frequency(GLOBAL_STATE);
-    
+    Thermal_throttle_init(GLOBAL_STATE);
+
     float last_asic_frequency = power_management->frequency_value;
+    char * last_chip_frequencies = NULL;
 
     pid_setPoint = (double)nvs_config_get_u16(NVS_CONFIG_TEMP_TARGET, pid_setPoint);
     min_fan_pct = (double)nvs_config_get_u16(NVS_CONFIG_MIN_FAN_SPEED, min_fan_pct);
@@ -95,39 +215,91 @@ void POWER_MANAGEMENT_task(void * pvParameters)
     pid_set_output_limits(&pid, min_fan_pct, 100);
     pid_set_mode(&pid, AUTOMATIC);        // This calls pid_initialize() internally
 
+    fan_control_init(&fan_control, fan_control_schedule, fan_control_schedule_count);
+
+    // Apply settings changed through the API right away instead of on the next poll
+    for (int i = 0; i < sizeof(POWER_MANAGEMENT_CONFIG_KEYS) / sizeof(POWER_MANAGEMENT_CONFIG_KEYS[0]); i++) {
+        nvs_config_subscribe(POWER_MANAGEMENT_CONFIG_KEYS[i], config_changed, xTaskGetCurrentTaskHandle());
+    }
+
     vTaskDelay(500 / portTICK_PERIOD_MS);
     uint16_t last_core_voltage = 0.0;
+    int64_t last_poll_time = esp_timer_get_time();
+    int64_t last_full_poll_time = last_poll_time;
 
     while (1) {
+        int64_t poll_time = esp_timer_get_time();
+        float poll_interval = (poll_time - last_poll_time) / 1e6f;
+        last_poll_time = poll_time;
+
+        // Config changes wake the loop early, counters of polls only advance on full ones
+        bool is_full_poll = poll_time - last_full_poll_time >= (POLL_RATE - 1) * 1000LL;
+        if (is_full_poll) {
+            last_full_poll_time = poll_time;
+        }
 
         // Refresh PID setpoint from NVS in case it was changed via API
         pid_setPoint = (double)nvs_config_get_u16(NVS_CONFIG_TEMP_TARGET, pid_setPoint);
 
-        power_management->voltage = Power_get_input_voltage(GLOBAL_STATE);
-        power_management->power = Power_get_power(GLOBAL_STATE);
+        // Latest samples of the sensor task, the loop never waits on the bus
+        power_management->voltage = SENSOR_get(GLOBAL_STATE, SENSOR_INPUT_VOLTAGE);
+        power_management->current = SENSOR_get(GLOBAL_STATE, SENSOR_CURRENT);
+        power_management->power = SENSOR_get(GLOBAL_STATE, SENSOR_POWER);
+
+        sys_module->total_energy += power_management->power * poll_interval;
+        SYSTEM_update_totals(GLOBAL_STATE);
 
-        power_management->fan_rpm = Thermal_get_fan_speed(&GLOBAL_STATE->DEVICE_CONFIG);
-        power_management->chip_temp_avg = Thermal_get_chip_temp(GLOBAL_STATE);
-        power_management->chip_temp2_avg = Thermal_get_chip_temp2(GLOBAL_STATE);
+        power_management->fan_rpm = SENSOR_get(GLOBAL_STATE, SENSOR_FAN_RPM);
+        power_management->chip_temp_avg = SENSOR_get(GLOBAL_STATE, SENSOR_CHIP_TEMP);
+        power_management->chip_temp2_avg = SENSOR_get(GLOBAL_STATE, SENSOR_CHIP_TEMP2);
+        power_management->chip_temp_max = Thermal_get_die_temp_max(GLOBAL_STATE);
+
+        // Control on the hottest die instead of the board diode when enabled and available
+        bool die_temp_control = nvs_config_get_u16(NVS_CONFIG_DIE_TEMP_CONTROL, 0) == 1 && power_management->chip_temp_max >= 0;
+        if (die_temp_control) {
+            // The die runs hotter than the board sensor, so it has its own setpoint
+            pid_setPoint = (double)nvs_config_get_u16(NVS_CONFIG_DIE_TEMP_TARGET, 68);
+        }
 
-        power_management->vr_temp = Power_get_vreg_temp(GLOBAL_STATE);
+        power_management->vr_temp = SENSOR_get(GLOBAL_STATE, SENSOR_VR_TEMP);
 
         // ASIC Thermal Diode will give bad readings if the ASIC is turned off
         // if(power_management->voltage < tps546_config.TPS546_INIT_VOUT_MIN){
         //     goto looper;
         // }
 
-        //overheat mode if the voltage regulator or ASIC is too hot
-        bool asic_overheat = 
-            power_management->chip_temp_avg > THROTTLE_TEMP
-            || power_management->chip_temp2_avg > THROTTLE_TEMP;
-        
-        if ((power_management->vr_temp > TPS546_THROTTLE_TEMP || asic_overheat) && (power_management->frequency_value > 50 || power_management->voltage > 1000)) {
+        float asic_temp = fmaxf(power_management->chip_temp_avg, power_management->chip_temp2_avg);
+        if (die_temp_control) {
+            asic_temp = fmaxf(asic_temp, power_management->chip_temp_max);
+        }
+
+        // A sample never read is as old as the uptime, the sensor task gets the same time for its first read
+        uint32_t now_ms = poll_time / 1000;
+        uint32_t vr_temp_age_ms = now_ms - SENSOR_get_sample(GLOBAL_STATE, SENSOR_VR_TEMP).time_ms;
+        uint32_t chip_temp_age_ms = now_ms - SENSOR_get_sample(GLOBAL_STATE, SENSOR_CHIP_TEMP).time_ms;
+        bool is_stale = vr_temp_age_ms > SENSOR_MAX_AGE_MS || chip_temp_age_ms > SENSOR_MAX_AGE_MS;
+
+        // A sensor or bus stall is no overheat, the pause turns the core voltage off and restarts the system later
+        if (is_stale && !Thermal_throttle_is_paused(GLOBAL_STATE)) {
+            ESP_LOGE(TAG, "Temperatures not read for VR: %lums ASIC: %lums, pausing", vr_temp_age_ms, chip_temp_age_ms);
+            Thermal_throttle_pause(GLOBAL_STATE, asic_temp, power_management->vr_temp);
+        }
+        if (Thermal_throttle_is_paused(GLOBAL_STATE)) {
+            asic_temp = -1;
+        }
+
+        // Shut down as a last resort if throttling did not keep the voltage regulator or ASIC cool
+        if ((power_management->vr_temp > TPS546_MAX_TEMP || asic_temp > MAX_TEMP) && (power_management->frequency_value > 50 || power_management->voltage > 1000)) {
             if (power_management->chip_temp2_avg > 0) {
                 ESP_LOGE(TAG, "OVERHEAT! VR: %fC ASIC1: %fC ASIC2: %fC", power_management->vr_temp, power_management->chip_temp_avg, power_management->chip_temp2_avg);
             } else {
                 ESP_LOGE(TAG, "OVERHEAT! VR: %fC ASIC: %fC", power_management->vr_temp, power_management->chip_temp_avg);
             }
+            if (die_temp_control) {
+                ESP_LOGE(TAG, "OVERHEAT! Hottest die: %fC", power_management->chip_temp_max);
+            }
+            FREQUENCY_RAMP_cancel(GLOBAL_STATE);
+
             power_management->fan_perc = 100;
             Thermal_set_fan_percent(&GLOBAL_STATE->DEVICE_CONFIG, 1);
 
@@ -140,20 +312,39 @@ void POWER_MANAGEMENT_task(void * pvParameters)
             nvs_config_set_u16(NVS_CONFIG_FAN_SPEED, 100);
             nvs_config_set_u16(NVS_CONFIG_AUTO_FAN_SPEED, 0);
             nvs_config_set_u16(NVS_CONFIG_OVERHEAT_MODE, 1);
+            nvs_config_commit();
             exit(EXIT_FAILURE);
         }
 
+        Thermal_throttle_update(GLOBAL_STATE, asic_temp, power_management->vr_temp);
+        bool is_paused = Thermal_throttle_is_paused(GLOBAL_STATE);
+
+        bool fan_feed_forward = nvs_config_get_u16(NVS_CONFIG_FAN_FEED_FORWARD, 0) == 1;
+
         //enable the PID auto control for the FAN if set
         if (nvs_config_get_u16(NVS_CONFIG_AUTO_FAN_SPEED, 1) == 1) {
-            if (power_management->chip_temp_avg >= 0) { // Ignore invalid temperature readings (-1)
-                if (power_management->chip_temp2_avg > 0) {
+            if (fan_feed_forward && asic_temp >= 0) {
+                // Hottest sensor, the power term acts before a power change shows up in it
+                pid_input = die_temp_control ? power_management->chip_temp_max : asic_temp;
+
+                fan_control_set_limits(&fan_control, pid_setPoint, min_fan_pct, 100);
+                pid_output = fan_control_update(&fan_control, pid_input, power_management->power, poll_interval);
+
+                power_management->fan_perc = (uint16_t) pid_output;
+                Thermal_set_fan_percent(&GLOBAL_STATE->DEVICE_CONFIG, pid_output / 100.0);
+                ESP_LOGI(TAG, "Temp: %.1f °C, SetPoint: %.1f °C, Power: %.1f W, Output: %.1f%% (FF:%.1f I:%.1f)",
+                         pid_input, pid_setPoint, power_management->power, pid_output, fan_control.feed_forward, fan_control.integral);
+            } else if (die_temp_control || power_management->chip_temp_avg >= 0) { // Ignore invalid temperature readings (-1)
+                if (die_temp_control) {
+                    pid_input = power_management->chip_temp_max;
+                } else if (power_management->chip_temp2_avg > 0) {
                     pid_input = (power_management->chip_temp_avg + power_management->chip_temp2_avg) / 2.0; // TODO: Or max of both?
                 } else {
                     pid_input = power_management->chip_temp_avg;
                 }
                 
                 // Hold and Ramp logic for startup D value
-                if (pid_startup_phase) {
+                if (pid_startup_phase && is_full_poll) {
                     pid_startup_counter++; // Increment counter at the start of each startup phase cycle
                     
                     if (pid_startup_counter >= (PID_STARTUP_HOLD_DURATION + PID_STARTUP_RAMP_DURATION)) {
@@ -202,27 +393,60 @@ void POWER_MANAGEMENT_task(void * pvParameters)
             Thermal_set_fan_percent(&GLOBAL_STATE->DEVICE_CONFIG, (float) fs / 100.0);
         }
 
+        if (is_paused) {
+            power_management->fan_perc = 100;
+            Thermal_set_fan_percent(&GLOBAL_STATE->DEVICE_CONFIG, 1);
+        }
+
         uint16_t core_voltage = nvs_config_get_u16(NVS_CONFIG_ASIC_VOLTAGE, CONFIG_ASIC_VOLTAGE);
         float asic_frequency = nvs_config_get_float(NVS_CONFIG_ASIC_FREQUENCY_FLOAT, CONFIG_ASIC_FREQUENCY);
 
-        if (core_voltage != last_core_voltage) {
+        power_limit_update(GLOBAL_STATE, asic_frequency, core_voltage, is_full_poll);
+        core_voltage -= power_management->power_limit_voltage_trim;
+        asic_frequency = fminf(asic_frequency, power_management->power_limit_frequency);
+        Thermal_throttle_apply(GLOBAL_STATE, &asic_frequency, &core_voltage);
+
+        if (is_paused) {
+            // Core voltage stays off until the throttle ladder restarts the system
+            if (last_core_voltage != 0) {
+                FREQUENCY_RAMP_cancel(GLOBAL_STATE);
+                VCORE_set_voltage(GLOBAL_STATE, 0.0f);
+                last_core_voltage = 0;
+            }
+        } else if (core_voltage != last_core_voltage) {
             ESP_LOGI(TAG, "setting new vcore voltage to %umV", core_voltage);
+            Power_telemetry_trigger(GLOBAL_STATE, POWER_TRIGGER_VOLTAGE);
             VCORE_set_voltage(GLOBAL_STATE, (double) core_voltage / 1000.0);
             last_core_voltage = core_voltage;
+            SENSOR_request(GLOBAL_STATE, SENSOR_POLL_POWER);
         }
 
-        if (asic_frequency != last_asic_frequency) {
+        if (!is_paused && asic_frequency != last_asic_frequency) {
             ESP_LOGI(TAG, "New ASIC frequency requested: %g MHz (current: %g MHz)", asic_frequency, last_asic_frequency);
-            
-            bool success = ASIC_set_frequency(GLOBAL_STATE, asic_frequency);
-            
-            if (success) {
-                power_management->frequency_value = asic_frequency;
-                power_management->expected_hashrate = expected_hashrate(GLOBAL_STATE, asic_frequency);
-            }
-            
+
+            // Ramps in the background, frequency_value follows every step
+            Power_telemetry_trigger(GLOBAL_STATE, POWER_TRIGGER_FREQUENCY);
+            FREQUENCY_RAMP_request(GLOBAL_STATE, asic_frequency);
+
             last_asic_frequency = asic_frequency;
         }
+        char * chip_frequencies = nvs_config_get_string(NVS_CONFIG_ASIC_CHIP_FREQUENCIES, "");
+        if (last_chip_frequencies == NULL || strcmp(chip_frequencies, last_chip_frequencies) != 0) {
+            float frequencies[FREQUENCY_RAMP_MAX_CHIPS];
+            int count = FREQUENCY_RAMP_parse_chip_frequencies(chip_frequencies, frequencies, FREQUENCY_RAMP_MAX_CHIPS);
+            if (count >= 0) {
+                ESP_LOGI(TAG, "Chip frequencies requested: [%s]", chip_frequencies);
+                FREQUENCY_RAMP_request_chips(GLOBAL_STATE, frequencies, count);
+            } else {
+                ESP_LOGW(TAG, "Ignoring invalid chip frequencies: [%s]", chip_frequencies);
+            }
+            free(last_chip_frequencies);
+            last_chip_frequencies = chip_frequencies;
+        } else {
+            free(chip_frequencies);
+        }
+
+        power_management->expected_hashrate = expected_hashrate(GLOBAL_STATE, FREQUENCY_RAMP_get_average_frequency(GLOBAL_STATE));
 
         // Check for changing of overheat mode
         uint16_t new_overheat_mode = nvs_config_get_u16(NVS_CONFIG_OVERHEAT_MODE, 0);
@@ -232,9 +456,7 @@ void POWER_MANAGEMENT_task(void * pvParameters)
             ESP_LOGI(TAG, "Overheat mode updated to: %d", sys_module->overheat_mode);
         }
 
-        VCORE_check_fault(GLOBAL_STATE);
-
         // looper:
-        vTaskDelay(POLL_RATE / portTICK_PERIOD_MS);
+        ulTaskNotifyTake(pdTRUE, POLL_RATE / portTICK_PERIOD_MS);
     }
 }
@@ -5,7 +5,9 @@ typedef struct
 {
     uint16_t fan_perc;
     uint16_t fan_rpm;
-    float chip_temp[6];
+    float chip_temp[6];              // die temperature per chip, read from the ASIC registers
+    uint32_t chip_temp_time_ms[6];
+    float chip_temp_max;             // hottest die, -1 when no recent reading
     float chip_temp_avg;
     float chip_temp2_avg;
     float vr_temp;
@@ -14,6 +16,10 @@ typedef struct
     float expected_hashrate;
     float power;
     float current;
+    uint16_t power_limit;            // W, 0 when not limited
+    float power_limit_frequency;     // highest frequency allowed by the power limit
+    uint16_t power_limit_voltage_trim; // mV below the core voltage setting
+    bool is_power_limited;
 } PowerManagementModule;
 
 void POWER_MANAGEMENT_init_frequency(void * pvParameters);
@@ -0,0 +1,158 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "global_state.h"
+#include "power.h"
+#include "power_telemetry.h"
+#include "thermal.h"
+#include "vcore.h"
+#include "sensor_task.h"
+
+static const char * TAG = "sensor";
+
+static const uint32_t DEFAULT_PERIOD_MS[SENSOR_POLL_COUNT] = {
+    [SENSOR_POLL_VR_FAULT] = 500,
+    [SENSOR_POLL_VR_TEMP] = 500,
+    [SENSOR_POLL_POWER] = POWER_TELEMETRY_PERIOD_MS,
+    [SENSOR_POLL_CHIP_TEMP] = 1000,
+    [SENSOR_POLL_FAN] = 2000,
+};
+
+static TaskHandle_t sensor_task_handle;
+
+static void publish(SensorModule * sensor_module, sensor_t sensor, float value, uint32_t time_ms)
+{
+    // Both fields are single words, readers never see a torn value
+    sensor_module->samples[sensor].value = value;
+    sensor_module->samples[sensor].time_ms = time_ms;
+}
+
+static void run_poll(GlobalState * GLOBAL_STATE, sensor_poll_t poll, uint32_t time_ms)
+{
+    SensorModule * sensor_module = &GLOBAL_STATE->SENSOR_MODULE;
+
+    switch (poll) {
+        case SENSOR_POLL_VR_FAULT: {
+            uint16_t power_fault = GLOBAL_STATE->SYSTEM_MODULE.power_fault;
+            VCORE_check_fault(GLOBAL_STATE);
+            if (!power_fault && GLOBAL_STATE->SYSTEM_MODULE.power_fault) {
+                Power_telemetry_trigger(GLOBAL_STATE, POWER_TRIGGER_FAULT);
+            }
+            break;
+        }
+        case SENSOR_POLL_VR_TEMP:
+            publish(sensor_module, SENSOR_VR_TEMP, Power_get_vreg_temp(GLOBAL_STATE), time_ms);
+            break;
+        case SENSOR_POLL_POWER: {
+            float voltage, current, power;
+            Power_get_readings(GLOBAL_STATE, &voltage, &current, &power);
+            publish(sensor_module, SENSOR_INPUT_VOLTAGE, voltage, time_ms);
+            publish(sensor_module, SENSOR_CURRENT, current, time_ms);
+            publish(sensor_module, SENSOR_POWER, power, time_ms);
+
+            int16_t core_voltage = VCORE_get_voltage_mv(GLOBAL_STATE);
+            publish(sensor_module, SENSOR_CORE_VOLTAGE, core_voltage, time_ms);
+
+            power_sample_t sample = {
+                .time_ms = time_ms,
+                .input_voltage = voltage,
+                .current = current,
+                .power = power,
+                .core_voltage = core_voltage,
+            };
+            Power_telemetry_add_sample(GLOBAL_STATE, &sample);
+            break;
+        }
+        case SENSOR_POLL_CHIP_TEMP:
+            publish(sensor_module, SENSOR_CHIP_TEMP, Thermal_get_chip_temp(GLOBAL_STATE), time_ms);
+            publish(sensor_module, SENSOR_CHIP_TEMP2, Thermal_get_chip_temp2(GLOBAL_STATE), time_ms);
+            break;
+        case SENSOR_POLL_FAN:
+            publish(sensor_module, SENSOR_FAN_RPM, Thermal_get_fan_speed(&GLOBAL_STATE->DEVICE_CONFIG), time_ms);
+            break;
+        default:
+            break;
+    }
+}
+
+void sensor_task(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    SensorModule * sensor_module = &GLOBAL_STATE->SENSOR_MODULE;
+
+    sensor_task_handle = xTaskGetCurrentTaskHandle();
+
+    for (int i = 0; i < SENSOR_POLL_COUNT; i++) {
+        if (sensor_module->poll_period_ms[i] == 0) {
+            sensor_module->poll_period_ms[i] = DEFAULT_PERIOD_MS[i];
+        }
+        sensor_module->poll_requested[i] = true;
+    }
+
+    ESP_LOGI(TAG, "Polling sensors");
+
+    while (1) {
+        uint32_t time_ms = esp_timer_get_time() / 1000;
+        uint32_t next_ms = UINT32_MAX;
+
+        // Due polls run back to back in priority order
+        for (int i = 0; i < SENSOR_POLL_COUNT; i++) {
+            uint32_t elapsed_ms = time_ms - sensor_module->poll_time_ms[i];
+            if (sensor_module->poll_requested[i] || elapsed_ms >= sensor_module->poll_period_ms[i]) {
+                sensor_module->poll_requested[i] = false;
+
+                int64_t start_us = esp_timer_get_time();
+                run_poll(GLOBAL_STATE, i, time_ms);
+                sensor_module->poll_duration_us[i] = esp_timer_get_time() - start_us;
+
+                sensor_module->poll_time_ms[i] = time_ms;
+                elapsed_ms = 0;
+            }
+
+            uint32_t wait_ms = sensor_module->poll_period_ms[i] - elapsed_ms;
+            if (wait_ms < next_ms) {
+                next_ms = wait_ms;
+            }
+        }
+
+        // Sleeps until the next poll is due or one is requested
+        uint32_t busy_ms = esp_timer_get_time() / 1000 - time_ms;
+        uint32_t sleep_ms = next_ms > busy_ms ? next_ms - busy_ms : 0;
+        ulTaskNotifyTake(pdTRUE, (sleep_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+    }
+}
+
+float SENSOR_get(void * pvParameters, sensor_t sensor)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+
+    return GLOBAL_STATE->SENSOR_MODULE.samples[sensor].value;
+}
+
+SensorSample SENSOR_get_sample(void * pvParameters, sensor_t sensor)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+
+    return GLOBAL_STATE->SENSOR_MODULE.samples[sensor];
+}
+
+void SENSOR_set_period(void * pvParameters, sensor_poll_t poll, uint32_t period_ms)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+
+    GLOBAL_STATE->SENSOR_MODULE.poll_period_ms[poll] = period_ms > 0 ? period_ms : DEFAULT_PERIOD_MS[poll];
+    if (sensor_task_handle != NULL) {
+        xTaskNotifyGive(sensor_task_handle);
+    }
+}
+
+void SENSOR_request(void * pvParameters, sensor_poll_t poll)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+
+    GLOBAL_STATE->SENSOR_MODULE.poll_requested[poll] = true;
+    if (sensor_task_handle != NULL) {
+        xTaskNotifyGive(sensor_task_handle);
+    }
+}
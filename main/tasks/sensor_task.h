@@ -0,0 +1,61 @@
+#ifndef SENSOR_TASK_H_
+#define SENSOR_TASK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    SENSOR_VR_TEMP = 0,
+    SENSOR_INPUT_VOLTAGE,  // mV
+    SENSOR_CURRENT,        // mA
+    SENSOR_POWER,          // W
+    SENSOR_CORE_VOLTAGE,   // mV, measured
+    SENSOR_CHIP_TEMP,
+    SENSOR_CHIP_TEMP2,
+    SENSOR_FAN_RPM,
+    SENSOR_COUNT,
+} sensor_t;
+
+// Bus transactions polled together, in order of priority
+typedef enum {
+    SENSOR_POLL_VR_FAULT = 0,  // regulator status word
+    SENSOR_POLL_VR_TEMP,
+    SENSOR_POLL_POWER,         // input voltage, current, power and core voltage, also fed to the power telemetry
+    SENSOR_POLL_CHIP_TEMP,
+    SENSOR_POLL_FAN,
+    SENSOR_POLL_COUNT,
+} sensor_poll_t;
+
+typedef struct {
+    float value;
+    uint32_t time_ms;          // when it was read, 0 before the first read
+} SensorSample;
+
+typedef struct {
+    SensorSample samples[SENSOR_COUNT];
+    uint32_t poll_period_ms[SENSOR_POLL_COUNT];
+    uint32_t poll_time_ms[SENSOR_POLL_COUNT];
+    uint32_t poll_duration_us[SENSOR_POLL_COUNT]; // bus time of the last poll
+    bool poll_requested[SENSOR_POLL_COUNT];
+} SensorModule;
+
+/**
+ * @brief Own the periodic I2C reads of the regulator, power meter and fan controller.
+ *
+ * Every poll runs at its own rate. When several are due, they run in the
+ * order of sensor_poll_t so the fault protection reads go first. Readers
+ * get the latest sample without touching the bus.
+ */
+void sensor_task(void * pvParameters);
+
+float SENSOR_get(void * pvParameters, sensor_t sensor);
+SensorSample SENSOR_get_sample(void * pvParameters, sensor_t sensor);
+
+void SENSOR_set_period(void * pvParameters, sensor_poll_t poll, uint32_t period_ms);
+
+/**
+ * @brief Run a poll as soon as possible, e.g. after the core voltage changed.
+ */
+void SENSOR_request(void * pvParameters, sensor_poll_t poll);
+
+#endif /* SENSOR_TASK_H_ */
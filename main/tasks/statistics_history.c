@@ -0,0 +1,350 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "crc.h"
+#include "statistics_history.h"
+
+#define HISTORY_PARTITION_LABEL "history"
+#define HISTORY_SECTOR_SIZE 4096
+
+// Samples are only bucketed once the clock was set by the pool
+#define HISTORY_CLOCK_VALID 1700000000
+
+#define HISTORY_SEQUENCE_ERASED 0xffffffff
+
+static const char * TAG = "statistics_history";
+
+// Same encodings as the statistics columns, 44 bytes
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t time;                 // unix time of the last sample
+    uint16_t crc;
+    uint8_t samples;
+    uint8_t reserved;
+    float hashrate;
+    float hashrateRegister;
+    uint32_t errorCountRegister;   // last
+    uint32_t freeHeap;             // minimum
+    uint16_t chipTemperature;      // float16
+    uint16_t vrTemperature;        // float16
+    uint16_t power;                // float16
+    uint16_t current;              // float16
+    uint16_t voltage;              // mV
+    int16_t coreVoltageActual;
+    uint16_t fanRPM;
+    uint8_t fanSpeed;
+    int8_t wifiRSSI;
+} HistoryRecord;
+
+_Static_assert(sizeof(HistoryRecord) == 44, "HistoryRecord layout");
+
+#define RECORDS_PER_SECTOR (HISTORY_SECTOR_SIZE / sizeof(HistoryRecord))
+
+// Every tier is a circular log of whole sectors. Writing the first record of a
+// sector erases it, so one sector more than the retention is reserved.
+typedef struct
+{
+    uint32_t period_s;
+    uint32_t first_sector;
+    uint32_t sectors;
+} HistoryLayout;
+
+static const HistoryLayout layouts[HISTORY_TIER_COUNT] = {
+    [HISTORY_TIER_MINUTE] = { .period_s = 60, .first_sector = 0, .sectors = 17 },
+    [HISTORY_TIER_QUARTER] = { .period_s = 900, .first_sector = 17, .sectors = 33 },
+};
+
+// Means of the samples in the current period
+typedef struct
+{
+    uint32_t bucket;               // unix time / period
+    uint32_t time;
+    uint32_t count;
+    double hashrate;
+    double hashrateRegister;
+    double chipTemperature;
+    double vrTemperature;
+    double power;
+    double current;
+    double voltage;
+    double coreVoltageActual;
+    double fanRPM;
+    double fanSpeed;
+    double wifiRSSI;
+    uint32_t errorCountRegister;
+    uint32_t freeHeap;
+} HistoryBucket;
+
+typedef struct
+{
+    HistoryBucket bucket;
+    atomic_uint head;
+    atomic_uint tail;
+} HistoryTier;
+
+static const esp_partition_t * partition;
+static HistoryTier tiers[HISTORY_TIER_COUNT];
+
+static uint32_t slot_count(history_tier_t tier)
+{
+    return layouts[tier].sectors * RECORDS_PER_SECTOR;
+}
+
+static size_t slot_offset(history_tier_t tier, uint32_t sequence)
+{
+    uint32_t slot = sequence % slot_count(tier);
+
+    return (layouts[tier].first_sector + slot / RECORDS_PER_SECTOR) * HISTORY_SECTOR_SIZE
+        + (slot % RECORDS_PER_SECTOR) * sizeof(HistoryRecord);
+}
+
+static uint16_t record_crc(HistoryRecord * record)
+{
+    uint16_t crc = record->crc;
+    record->crc = 0;
+    uint16_t result = crc16_false((uint8_t *) record, sizeof(HistoryRecord));
+    record->crc = crc;
+    return result;
+}
+
+static bool read_record(history_tier_t tier, uint32_t sequence, HistoryRecord * record)
+{
+    if (esp_partition_read(partition, slot_offset(tier, sequence), record, sizeof(HistoryRecord)) != ESP_OK) {
+        return false;
+    }
+    return record->sequence == sequence && record->crc == record_crc(record);
+}
+
+static void scan_tier(history_tier_t tier, uint8_t * sector)
+{
+    const HistoryLayout * layout = &layouts[tier];
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t oldest = 0;
+
+    for (uint32_t i = 0; i < layout->sectors; i++) {
+        if (esp_partition_read(partition, (layout->first_sector + i) * HISTORY_SECTOR_SIZE, sector, HISTORY_SECTOR_SIZE) != ESP_OK) {
+            continue;
+        }
+        for (uint32_t j = 0; j < RECORDS_PER_SECTOR; j++) {
+            HistoryRecord * record = (HistoryRecord *) (sector + j * sizeof(HistoryRecord));
+            if (record->sequence == HISTORY_SEQUENCE_ERASED || record->crc != record_crc(record)) {
+                continue;
+            }
+            if (!found || record->sequence > newest) newest = record->sequence;
+            if (!found || record->sequence < oldest) oldest = record->sequence;
+            found = true;
+        }
+    }
+
+    atomic_store(&tiers[tier].head, found ? newest + 1 : 0);
+    atomic_store(&tiers[tier].tail, found ? oldest : 0);
+
+    if (found) {
+        ESP_LOGI(TAG, "%lus tier: %lu records", layout->period_s, newest + 1 - oldest);
+    }
+}
+
+void statistics_history_init(void)
+{
+    const HistoryLayout * last = &layouts[HISTORY_TIER_COUNT - 1];
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, HISTORY_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No %s partition, history disabled", HISTORY_PARTITION_LABEL);
+        return;
+    }
+    if (partition->size < (last->first_sector + last->sectors) * HISTORY_SECTOR_SIZE) {
+        ESP_LOGE(TAG, "The %s partition is too small, history disabled", HISTORY_PARTITION_LABEL);
+        partition = NULL;
+        return;
+    }
+
+    uint8_t * sector = malloc(HISTORY_SECTOR_SIZE);
+    if (sector == NULL) {
+        partition = NULL;
+        return;
+    }
+    for (int tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        scan_tier(tier, sector);
+    }
+    free(sector);
+}
+
+static void append(history_tier_t tier, HistoryRecord * record)
+{
+    HistoryTier * state = &tiers[tier];
+    uint32_t sequence = atomic_load(&state->head);
+    size_t offset = slot_offset(tier, sequence);
+
+    if (offset % HISTORY_SECTOR_SIZE == 0) {
+        // Readers stop at the new tail before the sector is gone
+        if (sequence + RECORDS_PER_SECTOR > slot_count(tier)) {
+            uint32_t tail = sequence + RECORDS_PER_SECTOR - slot_count(tier);
+            if (tail > atomic_load(&state->tail)) {
+                atomic_store(&state->tail, tail);
+            }
+        }
+        if (esp_partition_erase_range(partition, offset, HISTORY_SECTOR_SIZE) != ESP_OK) {
+            ESP_LOGE(TAG, "Could not erase sector at 0x%x", (unsigned int) offset);
+        }
+    }
+
+    record->sequence = sequence;
+    record->crc = record_crc(record);
+    if (esp_partition_write(partition, offset, record, sizeof(HistoryRecord)) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not write record %lu", sequence);
+    }
+
+    // A failed slot is skipped, readers reject it by the crc
+    atomic_store(&state->head, sequence + 1);
+}
+
+static void finish_bucket(history_tier_t tier)
+{
+    HistoryBucket * bucket = &tiers[tier].bucket;
+    double count = bucket->count;
+
+    HistoryRecord record = {
+        .time = bucket->time,
+        .samples = bucket->count > UINT8_MAX ? UINT8_MAX : bucket->count,
+        .hashrate = bucket->hashrate / count,
+        .hashrateRegister = bucket->hashrateRegister / count,
+        .errorCountRegister = bucket->errorCountRegister,
+        .freeHeap = bucket->freeHeap,
+        .chipTemperature = statistics_float_to_half(bucket->chipTemperature / count),
+        .vrTemperature = statistics_float_to_half(bucket->vrTemperature / count),
+        .power = statistics_float_to_half(bucket->power / count),
+        .current = statistics_float_to_half(bucket->current / count),
+        .voltage = bucket->voltage / count + 0.5,
+        .coreVoltageActual = bucket->coreVoltageActual / count,
+        .fanRPM = bucket->fanRPM / count + 0.5,
+        .fanSpeed = bucket->fanSpeed / count + 0.5,
+        .wifiRSSI = bucket->wifiRSSI / count,
+    };
+    append(tier, &record);
+
+    memset(bucket, 0, sizeof(HistoryBucket));
+}
+
+void statistics_history_add(const struct StatisticsData * data)
+{
+    time_t now = time(NULL);
+
+    if (partition == NULL || now < HISTORY_CLOCK_VALID) {
+        return;
+    }
+
+    for (int tier = 0; tier < HISTORY_TIER_COUNT; tier++) {
+        HistoryBucket * bucket = &tiers[tier].bucket;
+        uint32_t id = now / layouts[tier].period_s;
+
+        if (bucket->count > 0 && bucket->bucket != id) {
+            finish_bucket(tier);
+        }
+
+        bucket->bucket = id;
+        bucket->time = now;
+        bucket->hashrate += data->hashrate;
+        bucket->hashrateRegister += data->hashrateRegister;
+        bucket->chipTemperature += data->chipTemperature;
+        bucket->vrTemperature += data->vrTemperature;
+        bucket->power += data->power;
+        bucket->current += data->current;
+        bucket->voltage += data->voltage;
+        bucket->coreVoltageActual += data->coreVoltageActual;
+        bucket->fanRPM += data->fanRPM;
+        bucket->fanSpeed += data->fanSpeed;
+        bucket->wifiRSSI += data->wifiRSSI;
+        bucket->errorCountRegister = data->errorCountRegister;
+        if (bucket->count == 0 || data->freeHeap < bucket->freeHeap) {
+            bucket->freeHeap = data->freeHeap;
+        }
+        bucket->count++;
+    }
+}
+
+history_tier_t statistics_history_tier(uint32_t resolution_s)
+{
+    // The statistics ring is finer than the first tier
+    if (partition == NULL || resolution_s < layouts[0].period_s) {
+        return HISTORY_TIER_COUNT;
+    }
+    for (int tier = 0; tier < HISTORY_TIER_COUNT - 1; tier++) {
+        if (resolution_s <= layouts[tier].period_s) {
+            return tier;
+        }
+    }
+    return HISTORY_TIER_COUNT - 1;
+}
+
+// Unix time of the boot in ms, to convert record times to the timestamps of the statistics ring
+static int64_t boot_time_ms(void)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    return (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000 - esp_timer_get_time() / 1000;
+}
+
+uint32_t statistics_history_range_since(history_tier_t tier, int64_t timestamp, uint32_t * first)
+{
+    uint32_t head = atomic_load(&tiers[tier].head);
+    *first = atomic_load(&tiers[tier].tail);
+
+    if (partition == NULL || time(NULL) < HISTORY_CLOCK_VALID) {
+        *first = head;
+        return head;
+    }
+    // The wall clock can be stepped back, so record times are not sorted and a
+    // binary search could skip new records. Walking back from the newest one
+    // returns everything appended after the latest record at or before the
+    // timestamp, and reads about as many records as the response sends anyway.
+    int64_t boot_ms = boot_time_ms();
+    uint32_t tail = *first;
+    uint32_t sequence = head;
+    while (sequence != tail) {
+        HistoryRecord record;
+        if (read_record(tier, sequence - 1, &record) && (int64_t) record.time * 1000 - boot_ms <= timestamp) {
+            break;
+        }
+        sequence--;
+    }
+    *first = sequence;
+    return head;
+}
+
+bool statistics_history_get(history_tier_t tier, uint32_t sequence, struct StatisticsData * dataOut)
+{
+    HistoryRecord record;
+
+    if (partition == NULL || (int32_t) (sequence - atomic_load(&tiers[tier].tail)) < 0) {
+        return false;
+    }
+    if (!read_record(tier, sequence, &record)) {
+        return false;
+    }
+
+    dataOut->timestamp = (int64_t) record.time * 1000 - boot_time_ms();
+    dataOut->hashrate = record.hashrate;
+    dataOut->hashrateRegister = record.hashrateRegister;
+    dataOut->errorCountRegister = record.errorCountRegister;
+    dataOut->freeHeap = record.freeHeap;
+    dataOut->chipTemperature = statistics_half_to_float(record.chipTemperature);
+    dataOut->vrTemperature = statistics_half_to_float(record.vrTemperature);
+    dataOut->power = statistics_half_to_float(record.power);
+    dataOut->current = statistics_half_to_float(record.current);
+    dataOut->voltage = record.voltage;
+    dataOut->coreVoltageActual = record.coreVoltageActual;
+    dataOut->fanRPM = record.fanRPM;
+    dataOut->fanSpeed = record.fanSpeed;
+    dataOut->wifiRSSI = record.wifiRSSI;
+
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef STATISTICS_HISTORY_H_
+#define STATISTICS_HISTORY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "statistics_task.h"
+
+// Downsampled tiers kept in the "history" partition, the finest tier is the statistics ring in RAM
+typedef enum {
+    HISTORY_TIER_MINUTE = 0,     // 24 hours
+    HISTORY_TIER_QUARTER,        // 30 days
+    HISTORY_TIER_COUNT,
+} history_tier_t;
+
+/**
+ * @brief Find the history partition and the newest record of every tier.
+ *
+ * Without the partition, e.g. on a device updated over the air with the
+ * old partition table, the history stays disabled.
+ */
+void statistics_history_init(void);
+
+/**
+ * @brief Add a sample to the buckets of every tier, a finished bucket is appended to flash.
+ *
+ * Buckets are aligned to the wall clock, samples are dropped until the clock is synced.
+ */
+void statistics_history_add(const struct StatisticsData * data);
+
+/**
+ * @brief Pick the finest tier with at least the given period.
+ *
+ * @return HISTORY_TIER_COUNT when the statistics ring has a fine enough resolution
+ */
+history_tier_t statistics_history_tier(uint32_t resolution_s);
+
+/**
+ * @brief Get the range of records of a tier newer than a timestamp.
+ *
+ * The range starts after the newest record at or before the timestamp. After
+ * the clock was stepped back it can hold older records, readers still check
+ * the timestamp of each.
+ *
+ * @param timestamp in ms since boot, negative before the boot
+ * @param first sequence number of the first record
+ * @return sequence number after the newest record
+ */
+uint32_t statistics_history_range_since(history_tier_t tier, int64_t timestamp, uint32_t * first);
+
+/**
+ * @brief Read one record of the range.
+ *
+ * The timestamp is converted to ms since boot, negative for records of earlier boots.
+ *
+ * @return false when the record was erased meanwhile or is corrupt
+ */
+bool statistics_history_get(history_tier_t tier, uint32_t sequence, struct StatisticsData * dataOut);
+
+#endif // STATISTICS_HISTORY_H_
@@ -1,113 +1,237 @@
+#include <stdatomic.h>
 #include <stdint.h>
-#include <pthread.h>
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "statistics_task.h"
+#include "statistics_history.h"
 #include "global_state.h"
 #include "nvs_config.h"
 #include "power.h"
 #include "connect.h"
-#include "vcore.h"
 #include "bm1370.h"
 
 #define DEFAULT_POLL_RATE 5000
 
 static const char * TAG = "statistics_task";
 
-static StatisticsNodePtr statisticsDataStart = NULL;
-static StatisticsNodePtr statisticsDataEnd = NULL;
-static pthread_mutex_t statisticsDataLock = PTHREAD_MUTEX_INITIALIZER;
+static StatisticsModule * statistics;
+
+// Samples are written at sequence head, the slot of sequence n is n % capacity.
+// The writer announces a slot in reserved before overwriting it, readers
+// check it after copying, as in a sequence lock.
+static atomic_uint statisticsHead;
+static atomic_uint statisticsReserved;
+static atomic_uint statisticsTail;
 
-static const uint16_t maxDataCount = 720;
-static uint16_t currentDataCount;
 static uint16_t statsFrequency;
 
-StatisticsNodePtr addStatisticData(StatisticsNodePtr data)
+// IEEE 754 half precision, values below 6e-5 are flushed to zero
+uint16_t statistics_float_to_half(float value)
 {
-    if ((NULL == data) || (0 == statsFrequency)) {
-        return NULL;
+    union { float f; uint32_t u; } bits = { .f = value };
+    uint16_t sign = (bits.u >> 16) & 0x8000;
+    int32_t exponent = (int32_t) ((bits.u >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits.u & 0x7fffff;
+
+    if (exponent <= 0) {
+        return sign;
+    }
+    if (exponent >= 31) {
+        return sign | 0x7c00;
     }
 
-    StatisticsNodePtr newData = NULL;
+    uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++; // round to nearest, a carry moves into the exponent
+    }
+    return half;
+}
 
-    // create new data block or reuse first data block
-    if (currentDataCount < maxDataCount) {
-        newData = (StatisticsNodePtr)malloc(sizeof(struct StatisticsData));
-        currentDataCount++;
+float statistics_half_to_float(uint16_t half)
+{
+    union { float f; uint32_t u; } bits;
+    uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0) {
+        bits.u = sign;
+    } else if (exponent == 31) {
+        bits.u = sign | 0x7f800000 | (mantissa << 13);
     } else {
-        newData = statisticsDataStart;
+        bits.u = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
     }
+    return bits.f;
+}
 
-    // set data
-    if (NULL != newData) {
-        pthread_mutex_lock(&statisticsDataLock);
-
-        if (NULL == statisticsDataStart) {
-            statisticsDataStart = newData; // set first new data block
-        } else {
-            if ((statisticsDataStart == newData) && (NULL != statisticsDataStart->next)) {
-                statisticsDataStart = statisticsDataStart->next; // move DataStart to next (first data block reused)
-            }
-        }
+static uint16_t clamp_u16(float value)
+{
+    if (value < 0) return 0;
+    if (value > UINT16_MAX) return UINT16_MAX;
+    return (uint16_t) (value + 0.5f);
+}
 
-        *newData = *data;
-        newData->next = NULL;
+// Row size of all columns, in order of alignment
+#define STATISTICS_ROW_SIZE (5 * sizeof(uint32_t) + 7 * sizeof(uint16_t) + 2 * sizeof(uint8_t))
 
-        if ((NULL != statisticsDataEnd) && (newData != statisticsDataEnd)) {
-            statisticsDataEnd->next = newData; // link data block
-        }
-        statisticsDataEnd = newData; // set DataEnd to new data
+static bool allocate_columns(void)
+{
+    uint32_t capacity = statistics->use_psram ? STATISTICS_PSRAM_CAPACITY : STATISTICS_CAPACITY;
+    uint32_t caps = statistics->use_psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL;
 
-        pthread_mutex_unlock(&statisticsDataLock);
+    uint8_t * block = heap_caps_malloc(capacity * STATISTICS_ROW_SIZE, caps | MALLOC_CAP_8BIT);
+    if (block == NULL) {
+        ESP_LOGE(TAG, "Could not allocate %lu samples", capacity);
+        return false;
     }
 
-    return newData;
+    StatisticsColumns * columns = &statistics->columns;
+    columns->timestamp = (uint32_t *) block;
+    columns->hashrate = (float *) (columns->timestamp + capacity);
+    columns->hashrateRegister = columns->hashrate + capacity;
+    columns->errorCountRegister = (uint32_t *) (columns->hashrateRegister + capacity);
+    columns->freeHeap = columns->errorCountRegister + capacity;
+    columns->chipTemperature = (uint16_t *) (columns->freeHeap + capacity);
+    columns->vrTemperature = columns->chipTemperature + capacity;
+    columns->power = columns->vrTemperature + capacity;
+    columns->current = columns->power + capacity;
+    columns->voltage = columns->current + capacity;
+    columns->coreVoltageActual = (int16_t *) (columns->voltage + capacity);
+    columns->fanRPM = (uint16_t *) (columns->coreVoltageActual + capacity);
+    columns->fanSpeed = (uint8_t *) (columns->fanRPM + capacity);
+    columns->wifiRSSI = (int8_t *) (columns->fanSpeed + capacity);
+
+    // Readers only look at the columns once the capacity is set
+    atomic_thread_fence(memory_order_release);
+    statistics->capacity = capacity;
+
+    ESP_LOGI(TAG, "Keeping %lu samples in %s", capacity, statistics->use_psram ? "PSRAM" : "internal RAM");
+    return true;
 }
 
-StatisticsNextNodePtr statisticData(StatisticsNodePtr nodeIn, StatisticsNodePtr dataOut)
+void addStatisticData(const struct StatisticsData * data)
 {
-    pthread_mutex_lock(&statisticsDataLock);
-
-    if ((NULL == nodeIn) || (NULL == dataOut)) {
-        pthread_mutex_unlock(&statisticsDataLock);
-        return NULL;
+    if ((NULL == data) || (0 == statsFrequency)) {
+        return;
+    }
+    if (0 == statistics->capacity && !allocate_columns()) {
+        return;
     }
 
-    StatisticsNextNodePtr nextNode = nodeIn->next;
-    *dataOut = *nodeIn;
+    StatisticsColumns * columns = &statistics->columns;
+    uint32_t sequence = atomic_load_explicit(&statisticsHead, memory_order_relaxed);
+    uint32_t row = sequence % statistics->capacity;
+
+    atomic_store_explicit(&statisticsReserved, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    columns->timestamp[row] = data->timestamp / 100;
+    columns->hashrate[row] = data->hashrate;
+    columns->hashrateRegister[row] = data->hashrateRegister;
+    columns->errorCountRegister[row] = data->errorCountRegister;
+    columns->freeHeap[row] = data->freeHeap;
+    columns->chipTemperature[row] = statistics_float_to_half(data->chipTemperature);
+    columns->vrTemperature[row] = statistics_float_to_half(data->vrTemperature);
+    columns->power[row] = statistics_float_to_half(data->power);
+    columns->current[row] = statistics_float_to_half(data->current);
+    columns->voltage[row] = clamp_u16(data->voltage);
+    columns->coreVoltageActual[row] = data->coreVoltageActual;
+    columns->fanRPM[row] = data->fanRPM;
+    columns->fanSpeed[row] = data->fanSpeed;
+    columns->wifiRSSI[row] = data->wifiRSSI;
+
+    atomic_store_explicit(&statisticsHead, sequence + 1, memory_order_release);
+}
 
-    pthread_mutex_unlock(&statisticsDataLock);
+uint32_t statisticDataRange(uint32_t * first)
+{
+    uint32_t head = atomic_load_explicit(&statisticsHead, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&statisticsTail, memory_order_acquire);
+    uint32_t capacity = statistics->capacity;
 
-    return nextNode;
+    if (head - tail > capacity) {
+        tail = head - capacity;
+    }
+    *first = tail;
+    return head;
 }
 
-void clearStatisticData()
+uint32_t statisticDataRangeSince(int64_t timestamp, uint32_t * first)
 {
-    if (NULL != statisticsDataStart) {
-        pthread_mutex_lock(&statisticsDataLock);
-
-        StatisticsNextNodePtr nextNode = statisticsDataStart;
+    uint32_t end = statisticDataRange(first);
+    if (timestamp < 0 || *first == end) {
+        return end;
+    }
 
-        while (NULL != nextNode) {
-            StatisticsNodePtr node = nextNode;
-            nextNode = node->next;
-            free(node);
+    // Timestamps grow with the sequence, a racing writer only makes the
+    // result too early, readers still check each sample
+    const uint32_t * timestamps = statistics->columns.timestamp;
+    uint32_t capacity = statistics->capacity;
+    uint32_t low = *first;
+    uint32_t high = end;
+    while (low != high) {
+        uint32_t middle = low + (high - low) / 2;
+        if ((int64_t) timestamps[middle % capacity] * 100 <= timestamp) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
+    }
+    *first = low;
+    return end;
+}
 
-        statisticsDataStart = NULL;
-        statisticsDataEnd = NULL;
-        currentDataCount = 0;
-
-        pthread_mutex_unlock(&statisticsDataLock);
+bool statisticData(uint32_t sequence, struct StatisticsData * dataOut)
+{
+    uint32_t capacity = statistics->capacity;
+    if ((NULL == dataOut) || (0 == capacity)) {
+        return false;
     }
+    atomic_thread_fence(memory_order_acquire);
+
+    const StatisticsColumns * columns = &statistics->columns;
+    uint32_t row = sequence % capacity;
+
+    dataOut->timestamp = (int64_t) columns->timestamp[row] * 100;
+    dataOut->hashrate = columns->hashrate[row];
+    dataOut->hashrateRegister = columns->hashrateRegister[row];
+    dataOut->errorCountRegister = columns->errorCountRegister[row];
+    dataOut->freeHeap = columns->freeHeap[row];
+    dataOut->chipTemperature = statistics_half_to_float(columns->chipTemperature[row]);
+    dataOut->vrTemperature = statistics_half_to_float(columns->vrTemperature[row]);
+    dataOut->power = statistics_half_to_float(columns->power[row]);
+    dataOut->current = statistics_half_to_float(columns->current[row]);
+    dataOut->voltage = columns->voltage[row];
+    dataOut->coreVoltageActual = columns->coreVoltageActual[row];
+    dataOut->fanRPM = columns->fanRPM[row];
+    dataOut->fanSpeed = columns->fanSpeed[row];
+    dataOut->wifiRSSI = columns->wifiRSSI[row];
+
+    // Still valid when the writer did not start to overwrite the slot meanwhile
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t reserved = atomic_load_explicit(&statisticsReserved, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&statisticsTail, memory_order_relaxed);
+    return (int32_t) (sequence - tail) >= 0 && reserved - sequence <= capacity;
+}
+
+void clearStatisticData()
+{
+    // The columns stay allocated, the samples before the head are dropped
+    atomic_store_explicit(&statisticsTail, atomic_load(&statisticsHead), memory_order_release);
 }
 
 void statistics_init(void * pvParameters)
 {
     GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
-    GLOBAL_STATE->STATISTICS_MODULE.statisticsList = &statisticsDataStart;
+
+    statistics = &GLOBAL_STATE->STATISTICS_MODULE;
+    statistics->capacity = 0;
+    statistics->use_psram = GLOBAL_STATE->psram_is_available;
+
+    statistics_history_init();
 }
 
 void statistics_task(void * pvParameters)
@@ -119,6 +243,7 @@ void statistics_task(void * pvParameters)
     PowerManagementModule * power_management = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
     HashrateMonitorModule * hashrate_monitor = &GLOBAL_STATE->HASHRATE_MONITOR_MODULE;
     struct StatisticsData statsData = {};
+    int64_t lastStatsTime = 0;
 
     TickType_t taskWakeTime = xTaskGetTickCount();
 
@@ -126,28 +251,32 @@ void statistics_task(void * pvParameters)
         const int64_t currentTime = esp_timer_get_time() / 1000;
         statsFrequency = nvs_config_get_u16(NVS_CONFIG_STATISTICS_FREQUENCY, 0) * 1000;
 
+        int8_t wifiRSSI = -90;
+        get_wifi_current_rssi(&wifiRSSI);
+
+        statsData.timestamp = currentTime;
+        statsData.hashrate = sys_module->current_hashrate;
+        statsData.hashrateRegister = hashrate_monitor->hashrate;
+        statsData.errorCountRegister = hashrate_monitor->error_count;
+        statsData.chipTemperature = power_management->chip_temp_avg;
+        statsData.vrTemperature = power_management->vr_temp;
+        statsData.power = power_management->power;
+        statsData.voltage = power_management->voltage;
+        statsData.current = power_management->current;
+        statsData.coreVoltageActual = SENSOR_get(GLOBAL_STATE, SENSOR_CORE_VOLTAGE);
+        statsData.fanSpeed = power_management->fan_perc;
+        statsData.fanRPM = power_management->fan_rpm;
+        statsData.wifiRSSI = wifiRSSI;
+        statsData.freeHeap = esp_get_free_heap_size();
+
+        // The flash history is fed on every poll, the statistics ring only when enabled
+        statistics_history_add(&statsData);
+
         if (0 != statsFrequency) {
-            const int64_t waitingTime = statsData.timestamp + statsFrequency - (DEFAULT_POLL_RATE / 2);
+            const int64_t waitingTime = lastStatsTime + statsFrequency - (DEFAULT_POLL_RATE / 2);
 
             if (currentTime > waitingTime) {
-                int8_t wifiRSSI = -90;
-                get_wifi_current_rssi(&wifiRSSI);
-
-                statsData.timestamp = currentTime;
-                statsData.hashrate = sys_module->current_hashrate;
-                statsData.hashrateRegister = hashrate_monitor->hashrate;
-                statsData.errorCountRegister = hashrate_monitor->error_count;
-                statsData.chipTemperature = power_management->chip_temp_avg;
-                statsData.vrTemperature = power_management->vr_temp;
-                statsData.power = power_management->power;
-                statsData.voltage = power_management->voltage;
-                statsData.current = Power_get_current(GLOBAL_STATE);
-                statsData.coreVoltageActual = VCORE_get_voltage_mv(GLOBAL_STATE);
-                statsData.fanSpeed = power_management->fan_perc;
-                statsData.fanRPM = power_management->fan_rpm;
-                statsData.wifiRSSI = wifiRSSI;
-                statsData.freeHeap = esp_get_free_heap_size();
-
+                lastStatsTime = currentTime;
                 addStatisticData(&statsData);
             }
         } else {
@@ -1,8 +1,12 @@
 #ifndef STATISTICS_TASK_H_
 #define STATISTICS_TASK_H_
 
-typedef struct StatisticsData * StatisticsNodePtr;
-typedef struct StatisticsData * StatisticsNextNodePtr;
+#include <stdbool.h>
+#include <stdint.h>
+
+// 1 hour at the default 5 s in internal RAM, 2 days in PSRAM
+#define STATISTICS_CAPACITY 720
+#define STATISTICS_PSRAM_CAPACITY 34560
 
 struct StatisticsData
 {
@@ -20,19 +24,64 @@ struct StatisticsData
     uint16_t fanRPM;
     int8_t wifiRSSI;
     uint32_t freeHeap;
-
-    StatisticsNextNodePtr next;
 };
 
+// One array per metric, in the smallest encoding that keeps the useful precision
+typedef struct
+{
+    uint32_t * timestamp;          // 100 ms units since boot
+    float * hashrate;
+    float * hashrateRegister;
+    uint32_t * errorCountRegister;
+    uint32_t * freeHeap;
+    uint16_t * chipTemperature;    // float16
+    uint16_t * vrTemperature;      // float16
+    uint16_t * power;              // float16
+    uint16_t * current;            // float16
+    uint16_t * voltage;            // mV
+    int16_t * coreVoltageActual;
+    uint16_t * fanRPM;
+    uint8_t * fanSpeed;
+    int8_t * wifiRSSI;
+} StatisticsColumns;
+
 typedef struct
 {
-    StatisticsNodePtr * statisticsList;
+    StatisticsColumns columns;
+    uint32_t capacity;             // 0 until the first sample
+    bool use_psram;
 } StatisticsModule;
 
-StatisticsNodePtr addStatisticData(StatisticsNodePtr data);
-StatisticsNextNodePtr statisticData(StatisticsNodePtr nodeIn, StatisticsNodePtr dataOut);
+void addStatisticData(const struct StatisticsData * data);
+
+/**
+ * @brief Get the range of stored samples without locking.
+ *
+ * @param first sequence number of the oldest sample
+ * @return sequence number after the newest sample
+ */
+uint32_t statisticDataRange(uint32_t * first);
+
+/**
+ * @brief Like statisticDataRange, but starting after a timestamp.
+ *
+ * @param timestamp in ms since boot, negative for all samples
+ */
+uint32_t statisticDataRangeSince(int64_t timestamp, uint32_t * first);
+
+/**
+ * @brief Copy one sample of the range.
+ *
+ * @return false when the sample was overwritten meanwhile
+ */
+bool statisticData(uint32_t sequence, struct StatisticsData * dataOut);
+
 void clearStatisticData();
 
+// IEEE 754 half precision, as stored in the float16 columns
+uint16_t statistics_float_to_half(float value);
+float statistics_half_to_float(uint16_t half);
+
 void statistics_init(void * pvParameters);
 void statistics_task(void * pvParameters);
 
@@ -15,6 +15,7 @@
 #include "esp_timer.h"
 #include <stdbool.h>
 #include "utils.h"
+#include "mining_trace.h"
 
 #define MAX_RETRY_ATTEMPTS 3
 #define MAX_CRITICAL_RETRY_ATTEMPTS 5
@@ -464,6 +465,7 @@ void stratum_task(void * pvParameters)
 
         while (1) {
             char * line = STRATUM_V1_receive_jsonrpc_line(GLOBAL_STATE->sock);
+            int64_t received_us = esp_timer_get_time();
             if (!line) {
                 ESP_LOGE(TAG, "Failed to receive JSON-RPC line, reconnecting...");
                 retry_attempts++;
@@ -474,13 +476,17 @@ void stratum_task(void * pvParameters)
             double response_time_ms = STRATUM_V1_get_response_time_ms(stratum_api_v1_message.message_id);
             if (response_time_ms >= 0) {
                 ESP_LOGI(TAG, "Stratum response time: %.2f ms", response_time_ms);
-                GLOBAL_STATE->SYSTEM_MODULE.response_time = response_time_ms;
+                SYSTEM_notify_response_time(GLOBAL_STATE, response_time_ms);
             }
 
             STRATUM_V1_parse(&stratum_api_v1_message, line);
             free(line);
 
             if (stratum_api_v1_message.method == MINING_NOTIFY) {
+                uint32_t trace_id = mining_trace_notify_received(received_us);
+                mining_trace_notify_parsed(trace_id);
+                stratum_api_v1_message.mining_notification->trace_id = trace_id;
+
                 GLOBAL_STATE->SYSTEM_MODULE.work_received++;
                 SYSTEM_notify_new_ntime(GLOBAL_STATE, stratum_api_v1_message.mining_notification->ntime);
                 if (stratum_api_v1_message.should_abandon_work &&
@@ -520,6 +526,7 @@ void stratum_task(void * pvParameters)
                 stratum_close_connection(GLOBAL_STATE);
                 break;
             } else if (stratum_api_v1_message.method == STRATUM_RESULT) {
+                mining_trace_share_acknowledged(stratum_api_v1_message.message_id);
                 if (stratum_api_v1_message.response_success) {
                     ESP_LOGI(TAG, "message result accepted");
                     SYSTEM_notify_accepted_share(GLOBAL_STATE);
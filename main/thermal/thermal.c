@@ -1,9 +1,13 @@
 #include "thermal.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "EMC2101.h"
 #include "EMC2103.h"
 
+// Die readings older than this are not used, e.g. when a chip stops responding
+#define DIE_TEMP_MAX_AGE_MS 15000
+
 static const char * TAG = "thermal";
 
 esp_err_t Thermal_init(DeviceConfig * DEVICE_CONFIG)
@@ -82,3 +86,31 @@ float Thermal_get_chip_temp2(GlobalState * GLOBAL_STATE)
     }
     return -1;
 }
+
+// Hottest on-die temperature of all chips, -1 when no chip reported recently
+float Thermal_get_die_temp_max(GlobalState * GLOBAL_STATE)
+{
+    if (!GLOBAL_STATE->ASIC_initalized) {
+        return -1;
+    }
+
+    PowerManagementModule * power_management = &GLOBAL_STATE->POWER_MANAGEMENT_MODULE;
+    uint32_t time_ms = esp_timer_get_time() / 1000;
+
+    int chip_count = GLOBAL_STATE->DEVICE_CONFIG.family.asic_count;
+    int max_chips = sizeof(power_management->chip_temp) / sizeof(power_management->chip_temp[0]);
+    if (chip_count > max_chips) {
+        chip_count = max_chips;
+    }
+
+    float temp_max = -1;
+    for (int i = 0; i < chip_count; i++) {
+        if (power_management->chip_temp_time_ms[i] == 0 || time_ms - power_management->chip_temp_time_ms[i] > DIE_TEMP_MAX_AGE_MS) {
+            continue;
+        }
+        if (power_management->chip_temp[i] > temp_max) {
+            temp_max = power_management->chip_temp[i];
+        }
+    }
+    return temp_max;
+}
@@ -11,5 +11,6 @@ uint16_t Thermal_get_fan_speed(DeviceConfig * DEVICE_CONFIG);
 
 float Thermal_get_chip_temp(GlobalState * GLOBAL_STATE);
 float Thermal_get_chip_temp2(GlobalState * GLOBAL_STATE);
+float Thermal_get_die_temp_max(GlobalState * GLOBAL_STATE);
 
 #endif // THERMAL_H
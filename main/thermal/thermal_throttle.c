@@ -0,0 +1,166 @@
+#include <math.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "global_state.h"
+#include "nvs_config.h"
+#include "thermal_throttle.h"
+
+#define HYSTERESIS 5.0          // °C below the throttle temperatures to recover
+#define ESCALATE_MS 15000       // time to give a level to take effect before the next one
+#define RECOVER_MS 60000        // time to stay cool before stepping back one level
+#define PAUSE_MS 300000         // minimum time with the core voltage off
+
+#define FREQUENCY_STEP_PERCENT 10
+#define VOLTAGE_STEP 25         // mV
+#define FREQUENCY_GRID 6.25     // MHz
+
+static const char * TAG = "thermal_throttle";
+
+static uint32_t now_ms(void)
+{
+    return esp_timer_get_time() / 1000;
+}
+
+static void log_event(ThermalThrottleModule * THERMAL_THROTTLE_MODULE, float chip_temp, float vr_temp)
+{
+    throttle_event_t * event = &THERMAL_THROTTLE_MODULE->events[THERMAL_THROTTLE_MODULE->event_index];
+
+    event->time = time(NULL);
+    event->uptime_s = now_ms() / 1000;
+    event->level = THERMAL_THROTTLE_MODULE->level;
+    event->chip_temp = chip_temp;
+    event->vr_temp = vr_temp;
+
+    THERMAL_THROTTLE_MODULE->event_index = (THERMAL_THROTTLE_MODULE->event_index + 1) % THERMAL_THROTTLE_EVENT_COUNT;
+    if (THERMAL_THROTTLE_MODULE->event_count < THERMAL_THROTTLE_EVENT_COUNT) {
+        THERMAL_THROTTLE_MODULE->event_count++;
+    }
+}
+
+static void set_level(ThermalThrottleModule * THERMAL_THROTTLE_MODULE, throttle_level_t level, float chip_temp, float vr_temp)
+{
+    if (level > THERMAL_THROTTLE_MODULE->level) {
+        ESP_LOGW(TAG, "ASIC %.1f°C, VR %.1f°C: throttling to %s", chip_temp, vr_temp, Thermal_throttle_get_level_string(level));
+    } else {
+        ESP_LOGI(TAG, "ASIC %.1f°C, VR %.1f°C: recovering to %s", chip_temp, vr_temp, Thermal_throttle_get_level_string(level));
+    }
+
+    THERMAL_THROTTLE_MODULE->level = level;
+    THERMAL_THROTTLE_MODULE->level_time_ms = now_ms();
+    THERMAL_THROTTLE_MODULE->cool_time_ms = 0;
+
+    log_event(THERMAL_THROTTLE_MODULE, chip_temp, vr_temp);
+}
+
+void Thermal_throttle_init(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    ThermalThrottleModule * THERMAL_THROTTLE_MODULE = &GLOBAL_STATE->THERMAL_THROTTLE_MODULE;
+
+    // Continue below the pause after the restart that ended it
+    throttle_level_t level = nvs_config_get_u16(NVS_CONFIG_THROTTLE_LEVEL, THROTTLE_LEVEL_NONE);
+    if (level != THROTTLE_LEVEL_NONE) {
+        nvs_config_set_u16(NVS_CONFIG_THROTTLE_LEVEL, THROTTLE_LEVEL_NONE);
+
+        THERMAL_THROTTLE_MODULE->level = MIN(level, THROTTLE_LEVEL_PAUSE - 1);
+        THERMAL_THROTTLE_MODULE->level_time_ms = now_ms();
+        log_event(THERMAL_THROTTLE_MODULE, -1, -1);
+
+        ESP_LOGW(TAG, "Continuing at %s after the pause", Thermal_throttle_get_level_string(THERMAL_THROTTLE_MODULE->level));
+    }
+}
+
+void Thermal_throttle_update(void * pvParameters, float chip_temp, float vr_temp)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    ThermalThrottleModule * THERMAL_THROTTLE_MODULE = &GLOBAL_STATE->THERMAL_THROTTLE_MODULE;
+    throttle_level_t level = THERMAL_THROTTLE_MODULE->level;
+    uint32_t time_ms = now_ms();
+    uint32_t level_ms = time_ms - THERMAL_THROTTLE_MODULE->level_time_ms;
+
+    // The ASIC temperatures are not valid with the core voltage off, only time and the VR tell
+    if (level == THROTTLE_LEVEL_PAUSE) {
+        if (level_ms >= PAUSE_MS && vr_temp < TPS546_THROTTLE_TEMP - HYSTERESIS) {
+            ESP_LOGI(TAG, "Cooled down after %lus, restarting", level_ms / 1000);
+            nvs_config_set_u16(NVS_CONFIG_THROTTLE_LEVEL, THROTTLE_LEVEL_PAUSE - 1);
+            esp_restart();
+        }
+        return;
+    }
+
+    bool is_hot = chip_temp > THROTTLE_TEMP || vr_temp > TPS546_THROTTLE_TEMP;
+    bool is_cool = chip_temp < THROTTLE_TEMP - HYSTERESIS && vr_temp < TPS546_THROTTLE_TEMP - HYSTERESIS;
+
+    if (is_hot) {
+        THERMAL_THROTTLE_MODULE->cool_time_ms = 0;
+        if (level == THROTTLE_LEVEL_NONE || level_ms >= ESCALATE_MS) {
+            set_level(THERMAL_THROTTLE_MODULE, level + 1, chip_temp, vr_temp);
+        }
+        return;
+    }
+
+    if (!is_cool || level == THROTTLE_LEVEL_NONE) {
+        THERMAL_THROTTLE_MODULE->cool_time_ms = 0;
+        return;
+    }
+
+    if (THERMAL_THROTTLE_MODULE->cool_time_ms == 0) {
+        THERMAL_THROTTLE_MODULE->cool_time_ms = time_ms;
+    } else if (time_ms - THERMAL_THROTTLE_MODULE->cool_time_ms >= RECOVER_MS) {
+        set_level(THERMAL_THROTTLE_MODULE, level - 1, chip_temp, vr_temp);
+    }
+}
+
+void Thermal_throttle_apply(void * pvParameters, float * frequency, uint16_t * core_voltage)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    const AsicConfig * asic = &GLOBAL_STATE->DEVICE_CONFIG.family.asic;
+    throttle_level_t level = GLOBAL_STATE->THERMAL_THROTTLE_MODULE.level;
+
+    if (level == THROTTLE_LEVEL_NONE) {
+        return;
+    }
+
+    int frequency_steps = MIN(level, THROTTLE_LEVEL_FREQUENCY_4);
+    int voltage_steps = level > THROTTLE_LEVEL_FREQUENCY_4 ? MIN(level, THROTTLE_LEVEL_VOLTAGE_2) - THROTTLE_LEVEL_FREQUENCY_4 : 0;
+
+    // Stay on the PLL grid and within the option tables
+    float throttled_frequency = floorf(*frequency * (100 - FREQUENCY_STEP_PERCENT * frequency_steps) / 100 / FREQUENCY_GRID) * FREQUENCY_GRID;
+    *frequency = fmaxf(throttled_frequency, fminf(asic->frequency_options[0], *frequency));
+
+    uint16_t min_voltage = MIN(asic->voltage_options[0], *core_voltage);
+    *core_voltage = MAX(*core_voltage - VOLTAGE_STEP * voltage_steps, min_voltage);
+}
+
+void Thermal_throttle_pause(void * pvParameters, float chip_temp, float vr_temp)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    ThermalThrottleModule * THERMAL_THROTTLE_MODULE = &GLOBAL_STATE->THERMAL_THROTTLE_MODULE;
+
+    if (THERMAL_THROTTLE_MODULE->level != THROTTLE_LEVEL_PAUSE) {
+        set_level(THERMAL_THROTTLE_MODULE, THROTTLE_LEVEL_PAUSE, chip_temp, vr_temp);
+    }
+}
+
+bool Thermal_throttle_is_paused(void * pvParameters)
+{
+    GlobalState * GLOBAL_STATE = (GlobalState *) pvParameters;
+    return GLOBAL_STATE->THERMAL_THROTTLE_MODULE.level == THROTTLE_LEVEL_PAUSE;
+}
+
+const char * Thermal_throttle_get_level_string(throttle_level_t level)
+{
+    switch (level) {
+        case THROTTLE_LEVEL_NONE:        return "none";
+        case THROTTLE_LEVEL_FREQUENCY_1: return "frequency -10%";
+        case THROTTLE_LEVEL_FREQUENCY_2: return "frequency -20%";
+        case THROTTLE_LEVEL_FREQUENCY_3: return "frequency -30%";
+        case THROTTLE_LEVEL_FREQUENCY_4: return "frequency -40%";
+        case THROTTLE_LEVEL_VOLTAGE_1:   return "voltage -25mV";
+        case THROTTLE_LEVEL_VOLTAGE_2:   return "voltage -50mV";
+        case THROTTLE_LEVEL_PAUSE:       return "pause";
+        default:                         return "unknown";
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef THERMAL_THROTTLE_H_
+#define THERMAL_THROTTLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Throttling starts at the throttle temperatures, the system shuts down at the max temperatures
+#define THROTTLE_TEMP 75.0
+#define MAX_TEMP 90.0
+#define TPS546_THROTTLE_TEMP 105.0
+#define TPS546_MAX_TEMP 145.0
+
+#define THERMAL_THROTTLE_EVENT_COUNT 16
+
+typedef enum {
+    THROTTLE_LEVEL_NONE = 0,
+    THROTTLE_LEVEL_FREQUENCY_1,  // frequency reduced in steps of 10%
+    THROTTLE_LEVEL_FREQUENCY_2,
+    THROTTLE_LEVEL_FREQUENCY_3,
+    THROTTLE_LEVEL_FREQUENCY_4,
+    THROTTLE_LEVEL_VOLTAGE_1,    // core voltage reduced in steps of 25mV on top
+    THROTTLE_LEVEL_VOLTAGE_2,
+    THROTTLE_LEVEL_PAUSE,        // core voltage off until cooled down
+} throttle_level_t;
+
+typedef struct {
+    time_t time;                 // wall clock, 0 before the clock was synced
+    uint32_t uptime_s;
+    throttle_level_t level;      // level entered
+    float chip_temp;
+    float vr_temp;
+} throttle_event_t;
+
+typedef struct {
+    throttle_level_t level;
+    uint32_t level_time_ms;      // when the level was entered
+    uint32_t cool_time_ms;       // since when the temperatures are below the recovery threshold, 0 when hot
+    throttle_event_t events[THERMAL_THROTTLE_EVENT_COUNT]; // ring buffer
+    uint8_t event_index;
+    uint8_t event_count;
+} ThermalThrottleModule;
+
+void Thermal_throttle_init(void * pvParameters);
+
+/**
+ * @brief Step the throttle ladder on the hottest ASIC and VR temperatures.
+ *
+ * Escalates one level at a time while a temperature stays above its
+ * throttle limit, and recovers one level at a time once both stay below
+ * the limit minus a hysteresis. Leaving the pause restarts the system.
+ */
+void Thermal_throttle_update(void * pvParameters, float chip_temp, float vr_temp);
+
+/**
+ * @brief Lower a frequency and core voltage setting for the current level.
+ */
+void Thermal_throttle_apply(void * pvParameters, float * frequency, uint16_t * core_voltage);
+
+/**
+ * @brief Enter the pause right away, when the temperatures cannot be trusted.
+ */
+void Thermal_throttle_pause(void * pvParameters, float chip_temp, float vr_temp);
+
+bool Thermal_throttle_is_paused(void * pvParameters);
+
+const char * Thermal_throttle_get_level_string(throttle_level_t level);
+
+#endif /* THERMAL_THROTTLE_H_ */